@@ -13,6 +13,16 @@ class cnn{
   ConvLayer _conv;
   MaxPoolingLayer _pool;
 
+  /**
+   * @brief Converts a (channels, rows, cols) input to the layout of the layers
+  */
+  Tensor _to_layout(const Tensor& input) const;
+
+  /**
+   * @brief Feed forward of an input already in the layout of the layers
+  */
+  Tensor _feed_forward(const Tensor& input, _NetworkFeedData& feed_data);
+
   public:
   cnn(
     int input_channels = 1,
@@ -43,25 +53,34 @@ class cnn{
   */
   void init();
 
+  /**
+   * @brief Sets the layout of the convolutional and pooling layers, `channels_first` by default.
+   * The inputs are always (channels, rows, cols), they are converted once on the way in,
+   * the pooled features go to the fully connected layer in the layout of the layers
+   * @return reference to this object
+  */
+  cnn& layout(Layout layout);
+
   /**
    * @brief Forward pass of the network
-   * @param input the input matrix
+   * @param input the input tensor, shape: (input_channels, input_size, input_size)
   */
-  void forward(matrix3d_t& input);
+  void forward(const Tensor& input);
 
   /**
    * @brief Feed forward of the network
-   * @param input the input matrix
+   * @param input the input tensor, shape: (input_channels, input_size, input_size)
    * @param feed_data the feed data
+   * @return the pooled features (convolution, ReLU, max pooling), the input of the fully connected layer, in the layout of the layers
   */
-  void feed_forward(matrix3d_t& input, _NetworkFeedData& feed_data);
+  Tensor feed_forward(const Tensor& input, _NetworkFeedData& feed_data);
 
   /**
    * @brief Backpropagation of the network
-   * @param input the input matrix
+   * @param input the input tensor, shape: (input_channels, input_size, input_size)
    * @param target the target vector (expected output of the network)
   */
-  void backprop(const matrix3d_t& input, vector_t& target);
+  void backprop(const Tensor& input, vector_t& target);
 
   /**
    * @brief Applies the gradients to the weights
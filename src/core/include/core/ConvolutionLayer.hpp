@@ -4,28 +4,32 @@
 #include "activation.hpp"
 #include "utils.hpp"
 #include "types.hpp"
+#include "FFT.hpp"
+#include "Tensor.hpp"
+#include "MaxPool.hpp"
 
 START_NAMESPACE_NEURAL_NETWORK
 
+/**
+ * @brief Algorithm of the forward pass of the convolutional layer
+*/
+enum class ConvAlgorithm {
+  // chosen by the shape of the layer, see `ConvLayer::get_algorithm`
+  automatic,
+  // im2col + matrix product, any kernel size and stride
+  im2col,
+  // Winograd F(2x2, 3x3), 3x3 kernels with stride 1 only
+  winograd,
+  // products of the 2D spectra, stride 1 only, for the large kernels and images
+  fft
+};
+
 /**
  * @brief Convolutional layer with max pooling
 */
 class ConvLayer{
   public:
 
-  struct FeedData{
-    FeedData(ConvLayer& layer, int input_size){
-      int _output_size = layer.get_output_size(input_size);
-      _outputs.resize(layer._number_of_kernels, matrix_t(_output_size, vector_t(_output_size)));
-      _outputs.resize(layer._number_of_kernels, matrix_t(_output_size, vector_t(_output_size)));
-      _partial_dervis.resize(layer._number_of_kernels, matrix_t(_output_size, vector_t(_output_size)));
-    }
-
-    matrix3d_t _outputs;
-    matrix3d_t _weighted_sum;
-    matrix3d_t _partial_dervis;
-  };
-
   ConvLayer(
     int kernel_size = 3, 
     int number_of_kernels = 1, 
@@ -56,26 +60,90 @@ class ConvLayer{
   */
   void initialize();
 
+  /**
+   * @brief Sets the algorithm of the forward pass, `automatic` by default
+   * @return reference to this object
+  */
+  ConvLayer& algorithm(ConvAlgorithm algorithm);
+
+  /**
+   * @brief Sets the layout of the inputs, outputs and partial derivatives, `channels_first` by default
+   * @return reference to this object
+  */
+  ConvLayer& layout(Layout layout);
+
+  inline Layout get_layout() const {
+    return _layout;
+  }
+
+  /**
+   * @brief Returns the algorithm `forward` uses for the given input size in the `channels_first` layout, `automatic` picks Winograd
+   * for the 3x3 kernels with stride 1 and at least `WINOGRAD_MIN_CHANNELS` input channels, otherwise
+   * FFT if its estimated cost (see `FFT_COST` and `SPECTRUM_COST`) is lower than the im2col one
+   * @throw std::runtime_error if Winograd or FFT was set for a layer it can't compute
+  */
+  ConvAlgorithm get_algorithm(size_t input_size) const;
+
+  // With fewer channels the tile transforms cost more than the saved multiplications
+  static constexpr int WINOGRAD_MIN_CHANNELS = 3;
+
+  // Cost of the FFT path, relative to a multiply-add of im2col: per value of a transformed image and
+  // per level of the transform (log2 of the number of values), and per product of the spectra
+  static constexpr double FFT_COST = 3.0;
+  static constexpr double SPECTRUM_COST = 4.0;
+
   /**
    * @brief Forward pass of the convolutional layer
-   * @param input the input matrix
-   * @return the output matrix - size: (number_of_kernels, output_size, output_size), output_size = (input_size - kernel_size + 2 * padding) / stride + 1
+   * @param input the input tensor, shape: (input_channels, input_size, input_size),
+   * or (input_size, input_size, input_channels) in the `channels_last` layout
+   * @return the output tensor, shape: (number_of_kernels, output_size, output_size), output_size = (input_size - kernel_size + 2 * padding) / stride + 1,
+   * or (output_size, output_size, number_of_kernels) in the `channels_last` layout
+   * @throw std::runtime_error if the shape of the input doesn't match the layer
   */
-  matrix3d_t forward(const matrix3d_t& input);
+  Tensor forward(const Tensor& input);
 
   /**
-   * @brief Backward pass of the convolutional layer
-   * @param partial_dervis the partial derivatives
+   * @brief Fused forward pass of the convolution, ReLU and max pooling, `pool.forward(relu(forward(input)))`.
+   * The pooled rows are computed in bands, from only the convolution rows their windows read (im2col in the `channels_first`
+   * layout), so the full convolution output is never stored. If `get_algorithm` picks Winograd or FFT, the whole output is
+   * convolved with it first, and only the ReLU is fused into the pooling. `pool` keeps the indexes of the max values for its `backprop`,
+   * the partial derivatives of the pooled outputs <= 0 must be zeroed before it (the ReLU)
+   * @param input the input tensor, as in `forward`
+   * @param pool the pooling layer, with `number_of_kernels` channels and the layout of this layer
+   * @return the pooled outputs, as `pool.forward` returns them
+   * @throw std::runtime_error if the shape of the input or the pooling layer doesn't match this layer
+  */
+  Tensor forward_pooled(const Tensor& input, MaxPoolingLayer& pool);
+
+  /**
+   * @brief Backward pass of the convolutional layer, accumulates the gradient of the weights
+   * @param partial_dervis the partial derivatives of the outputs, in the shape of the output
+   * @param inputs the input of the forward pass
+  */
+  void backprop(const Tensor& partial_dervis, const Tensor& inputs);
+
+  /**
+   * @brief Reference forward pass, straight nested loops over the input (slow, used to check and benchmark `forward`),
+   * `channels_first` layout only
+  */
+  Tensor forward_direct(const Tensor& input);
+
+  /**
+   * @brief Reference backward pass, straight nested loops over the input (slow, used to check and benchmark `backprop`),
+   * `channels_first` layout only
+  */
+  void backprop_direct(const Tensor& partial_dervis, const Tensor& inputs);
+
+  /**
+   * @brief Applies the accumulated gradients and clears them
   */
-  void backprop(matrix3d_t& partial_dervis, matrix3d_t& inputs);
-  
   void apply_gradients(double learn_rate, size_t batch_size);
 
   /**
    * @brief Returns the output of the convolutional layer
    * @return the output of the convolutional layer
   */
-  inline size_t get_output_size(size_t input_size){
+  inline size_t get_output_size(size_t input_size) const {
     return (input_size - _kernel_size + 2 * _padding) / _stride + 1;
   }
 
@@ -90,8 +158,99 @@ class ConvLayer{
   // The number of channels (RGB = 3, Grayscale = 1, etc.)
   int _input_channels;
 
-  matrix3d_t _weights;
-  matrix3d_t _gradient_weights;
+  /**
+   * @brief Number of the weights of a single kernel (input_channels * kernel_size * kernel_size)
+  */
+  inline size_t get_patch_size() const {
+    return _input_channels * _kernel_size * _kernel_size;
+  }
+
+  // Weights of the kernels, packed row by row: (number_of_kernels, input_channels, kernel_size, kernel_size).
+  // Change them with `initialize` or `apply_gradients`, only these refresh the cached Winograd transforms, spectra
+  // and channels last weights
+  vector_t _weights;
+  vector_t _gradient_weights;
+
+  private:
+  ConvAlgorithm _algorithm = ConvAlgorithm::automatic;
+  Layout _layout = Layout::channels_first;
+
+  /**
+   * @brief Checks the shape of the input, the forward paths index the returned contiguous tensor directly
+   * @throw std::runtime_error if it isn't (input_channels, input_size, input_size), or (input_size, input_size, input_channels)
+   * in the `channels_last` layout
+  */
+  Tensor _contiguous_input(const Tensor& input) const;
+
+  Tensor _forward_im2col(const Tensor& input);
+  Tensor _forward_winograd(const Tensor& input);
+  Tensor _forward_fft(const Tensor& input);
+  Tensor _forward_channels_last(const Tensor& input);
+  void _backprop_channels_last(const Tensor& partial_dervis, const Tensor& inputs);
+
+  /**
+   * @brief Copies the weights into `_channels_last_weights`, if they changed since the last call
+  */
+  void _transpose_weights();
+
+  /**
+   * @brief Computes the Winograd transforms of the kernels (G g G^T), if the weights changed since the last call
+  */
+  void _transform_kernels();
+
+  /**
+   * @brief Computes the conjugated spectra of the kernels for the `size` x `size` transforms,
+   * if the weights or the size changed since the last call
+  */
+  void _transform_kernel_spectra(size_t size);
+
+  /**
+   * @brief im2col, packs the input patches into `_columns`: one row per weight of the kernel (channel, k, l),
+   * one column per output position, zeros in the padding. The convolution becomes a matrix product with `_weights`
+   * @param input contiguous (input_channels, input_size, input_size) tensor
+   * @return the output size
+  */
+  size_t _pack(const Tensor& input);
+
+  /**
+   * @brief `_pack` of the output rows [row_begin, row_end) only
+  */
+  void _pack_rows(const Tensor& input, int row_begin, int row_end);
+
+  /**
+   * @brief Channels last convolution of the output rows [row_begin, row_end) into the zeroed `band`
+   * (row_end - row_begin, output_size, number_of_kernels)
+  */
+  void _convolve_rows_channels_last(const Tensor& input, int row_begin, int row_end, real_number_t* band);
+
+  // Packed patches (get_patch_size(), output_size * output_size), reused between the calls
+  vector_t _columns;
+  // Convolution outputs of a band of `forward_pooled`
+  vector_t _band;
+
+  // Winograd buffers, 16 matrices each (one per element of the 4x4 tile):
+  // transformed kernels (number_of_kernels, input_channels), input tiles (input_channels, tiles),
+  // and their products (number_of_kernels, tiles)
+  vector_t _winograd_kernels;
+  vector_t _winograd_inputs;
+  vector_t _winograd_products;
+  bool _kernels_transformed = false;
+
+  // FFT buffers, spectra of the zero padded kernels (number_of_kernels, input_channels) and inputs (input_channels),
+  // the sum of their products for one kernel and its inverse transform
+  RealFFT2D _fft;
+  vector_t _fft_image;
+  std::vector<complex_t> _kernel_spectra;
+  std::vector<complex_t> _input_spectra;
+  std::vector<complex_t> _output_spectrum;
+  // Size of the transforms of the cached `_kernel_spectra`, 0 if the weights changed
+  size_t _spectra_size = 0;
+
+  // Channels last weights and the gradient buffer (kernel_size, kernel_size, input_channels, number_of_kernels),
+  // the kernels are the innermost dimension, so every input value updates a contiguous run of the outputs
+  vector_t _channels_last_weights;
+  vector_t _channels_last_gradient;
+  bool _weights_transposed = false;
 };
 
 END_NAMESPACE
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+#include "namespaces.hpp"
+
+START_NAMESPACE_NEURAL_NETWORK
+
+using complex_t = std::complex<double>;
+
+/**
+ * @brief a * b, without the inf/nan recovery of the `std::complex` operator (a library call per product)
+*/
+inline complex_t complex_multiply(complex_t a, complex_t b){
+    return complex_t(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+/**
+ * @brief Mixed radix (Cooley-Tukey) complex FFT plan of a fixed size.
+ *
+ * The size is factorized into radices 4, 2, 3, 5 and any remaining primes (computed with a generic O(p^2) butterfly),
+ * the twiddle factors are precomputed. The transforms are const and allocation-free, so a plan may be shared by threads.
+*/
+class FFT{
+    size_t _size;
+    std::vector<size_t> _factors;
+    std::vector<complex_t> _twiddles;          // e^(-2 pi i k / size)
+    std::vector<complex_t> _inverse_twiddles;  // e^(+2 pi i k / size)
+
+    void _transform(complex_t* out, const complex_t* in, size_t in_stride, size_t level, size_t size,
+                    const complex_t* twiddles) const;
+
+    public:
+    FFT() : FFT(1) {}
+    explicit FFT(size_t size);
+
+    inline size_t size() const {
+        return _size;
+    }
+
+    /// @brief out = DFT(in), both hold `size()` values, `in` and `out` must not overlap
+    void forward(const complex_t* in, complex_t* out) const;
+
+    /// @brief out = inverse DFT(in), not normalized (scaled by `size()`), `in` and `out` must not overlap
+    void inverse(const complex_t* in, complex_t* out) const;
+
+    /// @brief Smallest size >= `size`, that's even and has only 2, 3 and 5 as prime factors
+    static size_t good_size(size_t size);
+};
+
+/**
+ * @brief 2D FFT of the real `rows` x `cols` images (`cols` even), the spectrum has `rows` x (`cols` / 2 + 1) values,
+ * the rest follows from the conjugate symmetry.
+ *
+ * The rows are transformed with a half size complex FFT (the even and odd samples packed as the real and imaginary
+ * parts), then the columns with the complex one. Holds its own scratch memory, use one per thread.
+*/
+class RealFFT2D{
+    size_t _rows;
+    size_t _cols;
+    FFT _row_fft;                            // cols / 2
+    FFT _col_fft;                            // rows
+    std::vector<complex_t> _row_twiddles;    // e^(-2 pi i k / cols), k <= cols / 2
+    std::vector<complex_t> _scratch[2];
+
+    void _transform_columns(complex_t* spectrum, bool inverse);
+
+    public:
+    RealFFT2D() : RealFFT2D(2, 2) {}
+    RealFFT2D(size_t rows, size_t cols);
+
+    inline size_t rows() const {
+        return _rows;
+    }
+
+    inline size_t cols() const {
+        return _cols;
+    }
+
+    /// @brief Number of the complex values of the spectrum of an image
+    inline size_t spectrum_size() const {
+        return _rows * (_cols / 2 + 1);
+    }
+
+    /// @brief spectrum = DFT(image), image: `rows` x `cols` row-major, spectrum: `rows` x (`cols` / 2 + 1)
+    void forward(const double* image, complex_t* spectrum);
+
+    /// @brief image = inverse DFT(spectrum), normalized, the spectrum is overwritten
+    void inverse(complex_t* spectrum, double* image);
+};
+
+END_NAMESPACE
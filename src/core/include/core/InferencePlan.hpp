@@ -0,0 +1,116 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <data/data.hpp>
+
+#include "namespaces.hpp"
+#include "activation.hpp"
+
+START_NAMESPACE_NEURAL_NETWORK
+
+class ONeural;
+
+/**
+ * @brief Immutable, inference-only snapshot of the `ONeural` (see `ONeural::freeze()`).
+ *
+ * The weights and biases of all the layers are packed into a single contiguous float block,
+ * each layer's weights transposed (input-major), so the layer is computed as a sum of the input-scaled
+ * weight rows (vectorized, zero inputs are skipped). The bias is the initial value of the
+ * accumulator and the activation is applied in place, there is no dropout and no gradient buffer.
+ * `predict` uses only the preallocated scratch memory, it never allocates.
+ *
+ * Copies share the packed parameters, but each has its own scratch memory, so use one copy per thread.
+ *
+ * The batch overloads of `predict` and `classify` are const and may be called concurrently: they compute
+ * `TILE` samples at once (each weight row is loaded once per tile instead of once per sample, a small GEMM),
+ * with per call scratch memory, and large batches are sharded across a `ThreadPool`.
+*/
+class InferencePlan{
+    struct _Layer{
+        size_t inputs;
+        size_t outputs;
+        size_t offset;  // of the weights in the packed parameters, followed by the biases
+        ActivationType activation;
+    };
+
+    std::shared_ptr<const std::vector<float>> _parameters;
+    std::vector<_Layer> _layers;
+    std::vector<float> _scratch[2];
+
+    /// @brief Computes `count` <= `TILE` samples, `scratch` holds 2 * `TILE` * widest layer floats
+    void _predict_tile(const float* inputs, size_t count, float* out, float* scratch) const;
+
+    /// @brief Calls `work(begin, end)` for the tile aligned shards of [0, count)
+    template <class Work>
+    void _shard(size_t count, size_t threads, Work work) const;
+
+    public:
+    /// @brief Number of the samples computed together by the batch calls
+    static constexpr size_t TILE = 16;
+
+    /// @brief Smallest number of the samples given to a thread by the batch calls
+    static constexpr size_t MIN_SHARD = 16 * TILE;
+
+    InferencePlan() = default;
+
+    /// @brief Packs the current weights of the `network`, later changes of the network don't affect the plan
+    explicit InferencePlan(const ONeural& network);
+
+    InferencePlan(const InferencePlan& other);
+    InferencePlan& operator=(const InferencePlan& other);
+    InferencePlan(InferencePlan&&) = default;
+    InferencePlan& operator=(InferencePlan&&) = default;
+
+    /**
+     * @brief Feeds forward the network
+     * @param inputs `inputs()` values, normalized the same way as the training data
+     * @param out receives `outputs()` activations of the output layer
+    */
+    void predict(const float* inputs, float* out);
+
+    /// @brief `predict`, returns the index of the most activated output
+    size_t classify(const float* inputs);
+
+    /**
+     * @brief Feeds forward a batch of samples, thread safe
+     * @param inputs `count * inputs()` values, sample after sample
+     * @param count number of the samples
+     * @param out receives `count * outputs()` activations, sample after sample
+     * @param threads maximum number of the threads, 0 -> hardware concurrency, 1 -> the calling thread only
+    */
+    void predict(const float* inputs, size_t count, float* out, size_t threads = 0) const;
+
+    /**
+     * @brief Batch `predict`, writes the index of the most activated output of every sample, thread safe
+     * @param labels receives `count` labels
+    */
+    void classify(const float* inputs, size_t count, size_t* labels, size_t threads = 0) const;
+
+    /**
+     * @brief Part of the `test` samples classified correctly (batch `classify`), thread safe
+     * @throw std::runtime_error if a sample doesn't have `inputs()` values and `outputs()` expected values
+    */
+    real_number_t accuracy(const data::data_batch& test, size_t threads = 0) const;
+
+    /**
+     * @brief Part of the `test` samples classified correctly, the samples are dequantized in chunks, thread safe
+     * @throw std::runtime_error if the dataset doesn't have `inputs()` features and `outputs()` classes
+    */
+    real_number_t accuracy(const data::Dataset& test, size_t threads = 0) const;
+
+    inline size_t inputs() const {
+        return _layers.empty() ? 0 : _layers.front().inputs;
+    }
+
+    inline size_t outputs() const {
+        return _layers.empty() ? 0 : _layers.back().outputs;
+    }
+
+    inline bool empty() const {
+        return _layers.empty();
+    }
+};
+
+END_NAMESPACE
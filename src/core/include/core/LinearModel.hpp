@@ -39,6 +39,15 @@ class LinearModel
     */
     void batch_learn(data::data_batch* batch, double learning_rate);
 
+    /**
+     * @brief `batch_learn` on the rows [begin, end) of the contiguous table (ex. loaded from a CSV file),
+     * the target of the row is the expected output
+     * @param table learning data, must have as many features as the model has inputs
+     * @param learning_rate learning rate
+     * @throw std::runtime_error if the number of the features doesn't match the inputs
+    */
+    void batch_learn(const data::Table& table, double learning_rate, size_t begin = 0, size_t end = SIZE_MAX);
+
     /**
      * @brief Sets the inputs for the model
      * @param inputs input values
@@ -1,16 +1,26 @@
 #pragma once
 
 #include <stddef.h>
+#include <cstdint>
 #include <numeric>
 #include <limits>
+#include <vector>
 
 #include "types.hpp"
+#include "Tensor.hpp"
 
 
 START_NAMESPACE_NEURAL_NETWORK
 
 class MaxPoolingLayer{
+
+  // Runs the pooling of `forward_pooled` on its bands of the convolution outputs
+  friend class ConvLayer;
+
   public:
+  // Offset of a max value in the input
+  using index_t = std::uint32_t;
+
   MaxPoolingLayer(
     int kernel_size = 2, 
     int input_channels = 1, 
@@ -25,32 +35,46 @@ class MaxPoolingLayer{
     int padding = 0
   );
 
+  /**
+   * @brief Sets the layout of the inputs, outputs and partial derivatives, `channels_first` by default
+   * @return reference to this object
+  */
+  MaxPoolingLayer& layout(Layout layout);
+
+  inline Layout get_layout() const {
+    return _layout;
+  }
+
   /**
    * @brief Forward pass of the max pooling layer
-   * @param input the input matrix
-   * @return the output matrix, size = (input_channels, output_size, output_size), output_size = (input_size - kernel_size + 2 * padding) / stride + 1
+   * @param input the input tensor, shape: (input_channels, input_size, input_size),
+   * or (input_size, input_size, input_channels) in the `channels_last` layout
+   * @return the output tensor, shape: (input_channels, output_size, output_size), output_size = (input_size - kernel_size + 2 * padding) / stride + 1,
+   * or (output_size, output_size, input_channels) in the `channels_last` layout
+   * @throw std::runtime_error if the shape of the input doesn't match the layer
   */
-  matrix3d_t forward(const matrix3d_t& input);
+  Tensor forward(const Tensor& input);
 
   /**
    * @brief Backward pass of the max pooling layer
-   * @param output the output matrix
-   * @return the backward pass matrix, creates a matrix 
+   * @param partial_dervis the partial derivatives of the outputs, in the shape of the output
+   * @return the partial derivatives of the inputs, in the shape of the input
   */
-  matrix3d_t backprop(matrix3d_t& partial_dervis);
+  Tensor backprop(const Tensor& partial_dervis);
 
   
   /**
-   * @brief Returns the indexes of the max values in the input matrix
-   * @return the indexes of the max values in the input matrix, stored in format: [polling_index][0, 1] -> x, y position
+   * @brief Returns the indexes of the max values of the last forward pass
+   * @return the offsets of the max values in the (contiguous) input, one per output value of every channel,
+   * in the order of the outputs
   */
-  const matrix3d_t& get_max_indexes();
+  const std::vector<index_t>& get_max_indexes();
 
   /**
    * @brief Returns the output of the convolutional layer
    * @return the output of the convolutional layer
   */
-  inline size_t get_output_size(size_t input_size){
+  inline size_t get_output_size(size_t input_size) const {
     return (input_size - _kernel_size + 2 * _padding) / _stride + 1;
   }
 
@@ -61,8 +85,26 @@ class MaxPoolingLayer{
   int _input_size;
 
   // Used to store the indexes of the max values in the input matrix
-  matrix3d_t _max_indexes;
-  matrix3d_t _output;
+  std::vector<index_t> _max_indexes;
+
+  private:
+  Layout _layout = Layout::channels_first;
+
+  /**
+   * @brief Sets the input size and resets the indexes for a forward pass
+   * @return the output tensor, zeros
+  */
+  Tensor _start_forward(int input_size);
+
+  /**
+   * @brief Pools the output rows [row_begin, row_end) from a band of the contiguous input, its rows [band_begin, band_end)
+   * (all the channels, in the layout of the layer), the band has every input row these outputs need
+   * @param output the output tensor of `_start_forward`
+   * @param relu applies the ReLU to the max values, max(relu(x)) = relu(max(x)) so the indexes stay the same
+  */
+  void _pool_rows(
+    const real_number_t* band, int band_begin, int band_end, int row_begin, int row_end, real_number_t* output, bool relu
+  );
 };
 
 
@@ -8,6 +8,7 @@ Using only layer (without Neurons as an individual node)
 #pragma once
 
 #include <memory>
+#include <functional>
 #include <random>
 #include <cmath>
 #include <chrono>
@@ -121,7 +122,24 @@ class OLayer{
     /// @param expected expected activation values
     /// @warning first call `calc_activations`
     /// @return this pointer
-    OLayer* calc_output_gradient(vector_t&& expected, _FeedData& feed_data);
+    OLayer* calc_output_gradient(const vector_t& expected, _FeedData& feed_data);
+
+    /**
+     * @brief `calc_activations` of the first layer, consumes the quantized inputs directly,
+     * the real input `inputs[j] * scale + offset` is never stored (`feed_data._inputs` is not used)
+     * @param inputs `_inputs_size` quantized values
+     * @return activation values
+    */
+    vector_t& calc_activations(
+        _FeedData& feed_data, const uint8_t* inputs,
+        real_number_t scale, real_number_t offset
+    );
+
+    /// @brief `update_gradients` of the first layer, see the quantized `calc_activations`
+    void update_gradients(
+        _FeedData& feed_data, const uint8_t* inputs,
+        real_number_t scale, real_number_t offset
+    );
 
     /// @warning first call `calc_hidden_gradient` or `calc_output_gradient`
     /// @brief Updates the graidents: weight, bias values. Call this before applying them
@@ -137,7 +155,7 @@ class OLayer{
      * @param expected A vector of expected output values.
      * @return The calculated cost.
      */
-    real_number_t cost(vector_t&& expected, _FeedData& feed_data);
+    real_number_t cost(const vector_t& expected, _FeedData& feed_data);
 
 
     /**
@@ -160,6 +178,7 @@ class OLayer{
     bool operator!=(const OLayer& other);
 
     double _dropout_rate;
+    bool _training = false;
 
     size_t _neurons_size;
     size_t _inputs_size;
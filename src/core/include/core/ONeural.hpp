@@ -5,6 +5,7 @@
 
 #include <data/data.hpp>
 #include "OLayer.hpp"
+#include "InferencePlan.hpp"
 #include "thread.hpp"
 
 /*
@@ -26,7 +27,7 @@ struct _NetworkFeedData{
         }
         _layer_feed_data.emplace_back(output._inputs_size, output._neurons_size);
     }
-    _NetworkFeedData& setInputs(vector_t& inputs){
+    _NetworkFeedData& setInputs(const vector_t& inputs){
         _layer_feed_data[0]._inputs = inputs;
         return *this;
     }
@@ -45,21 +46,47 @@ class ONeural{
     
     @param data single data point
     @param context Neural network pointer
+    @param weight weight of the sample's gradient
+    @return cost of the sample
     */
-    static void _update_gradients(data::Data&& data, ONeural* context);
+    static real_number_t _update_gradients(const data::Data& data, ONeural* context, real_number_t weight = 1.0);
+
+    /// @brief `_update_gradients` of the quantized sample at `index`
+    static real_number_t _update_gradients(const data::Dataset& data, size_t index, ONeural* context, real_number_t weight = 1.0);
+
+    /*
+    Backward pass of already fed network, updates the gradients, `_cost` and `_loss`.
+    If `quantized` is not null, the first layer gradients are calculated directly from
+    the quantized inputs (`quantized[j] * scale + offset`). The gradients (and the sample's
+    contribution to `_loss`) are scaled by `weight`, returns the (unweighted) cost of the sample
+    */
+    static real_number_t _backward(
+        _NetworkFeedData& feed_data, const vector_t& expect, ONeural* context,
+        const uint8_t* quantized = nullptr, real_number_t scale = 1.0, real_number_t offset = 0.0,
+        real_number_t weight = 1.0
+    );
 
     /*
-    Creates for every `Data` instance in the `tranining_data` new thread,
+    Creates for every `Data` instance in the `tranining_data` (in range [begin, end)) new thread,
     and calls `_update_gradients(...)`
 
     @param training_data mini-batch data, shouldn't be too big (go for 16)
-    @param learn_rate learning rate, make it small, since the batch size is also small
+    @param begin index of the first sample
+    @param end one past the last sample
+    @param weights if not null, weight of the gradient of every sample in [begin, end)
+    @param losses if not null, receives the cost of every sample in [begin, end)
     */
-    void _learn_multithread(data_batch* training_data, double learn_rate);
+    void _learn_multithread(
+        const data_batch* training_data, size_t begin, size_t end,
+        const real_number_t* weights = nullptr, real_number_t* losses = nullptr
+    );
+    void _learn_multithread(
+        const data::Dataset* training_data, size_t begin, size_t end,
+        const real_number_t* weights = nullptr, real_number_t* losses = nullptr
+    );
 
-    size_t _accuracy_multithread(data_batch* mini_test);
     size_t _classify_feed(_NetworkFeedData&);
-    bool _correct_feed(_NetworkFeedData&, vector_t& expect);
+    bool _correct_feed(_NetworkFeedData&, const vector_t& expect);
 
     size_t _iterator;
 
@@ -116,7 +143,7 @@ class ONeural{
     /// calculated on the whole batch
     /// @param training_data training batch
     /// @param learn_rate learning rate
-    void learn(data_batch* training_data, double learn_rate = 0.4);
+    void learn(const data_batch* training_data, double learn_rate = 0.4);
 
     /// @brief Learns by mini batches given `whole_data`, divides the `whole_data` into smaller chunks
     /// with the size of `batch_size`, and calls `learn(data_batch* training_data, double learn_rate)`
@@ -124,7 +151,30 @@ class ONeural{
     /// @param whole_data whole training data
     /// @param learn_rate learning rate
     /// @param batch_size mini batch size
-    void batch_learn(data_batch* whole_data, double learn_rate = 0.4, size_t batch_size = 32UL);
+    void batch_learn(const data_batch* whole_data, double learn_rate = 0.4, size_t batch_size = 32UL);
+
+    /// @brief `learn` on quantized data, the inputs are dequantized inside the first layer
+    void learn(const data::Dataset* training_data, double learn_rate = 0.4);
+
+    /// @brief `batch_learn` on quantized data, the inputs are dequantized inside the first layer
+    void batch_learn(const data::Dataset* whole_data, double learn_rate = 0.4, size_t batch_size = 32UL);
+
+    /**
+     * @brief Learns the whole `training_data` with the gradient of every sample scaled by its weight
+     * (ex. importance sampling, weight = 1 / (N * probability of the sample)), applies the average gradient
+     * @param weights weight of every sample
+     * @param losses receives the (unweighted) cost of every sample, may be null
+    */
+    void learn(
+        const data_batch* training_data, const real_number_t* weights,
+        real_number_t* losses, double learn_rate = 0.4
+    );
+
+    /// @brief Weighted `learn` on quantized data
+    void learn(
+        const data::Dataset* training_data, const real_number_t* weights,
+        real_number_t* losses, double learn_rate = 0.4
+    );
 
     /// @brief Applies the gradients calculated by `train(...)` method
     /// @param learn_rate learning rate 
@@ -141,7 +191,10 @@ class ONeural{
     void raw_input(const vector_t& _raw_input);
 
     /// @brief feed forward the network, calculate activations on the layers
-    void feed_forward(_NetworkFeedData& feed_data, vector_t& inputs);
+    void feed_forward(_NetworkFeedData& feed_data, const vector_t& inputs);
+
+    /// @brief feed forward the network with the quantized sample `data[index]`
+    void feed_forward(_NetworkFeedData& feed_data, const data::Dataset& data, size_t index);
 
     /// @brief Calculates the outputs of the network
     /// @return activations of the output layer
@@ -154,12 +207,18 @@ class ONeural{
     /// @brief current cost of the network, outputs must be already calculated
     real_number_t cost();
 
-    /// @brief Tell wheter the network's guess was correct, outputs must be already calculated
+    /// @brief Feeds forward the network (once) and tells wheter the network's guess was correct
     bool correct();
 
-    /// @brief return the index of the most activated neuron, outputs must be already calculated
+    /// @brief Feeds forward the network (once) and returns the index of the most activated neuron
     size_t classify();
 
+    /**
+     * @brief Creates an immutable, inference-only plan of the current network (see `InferencePlan`),
+     * for low latency predictions. Later training doesn't change the plan, freeze the network again.
+    */
+    InferencePlan freeze() const;
+
     /**
      * @brief Get the input layer
     */
@@ -189,7 +248,9 @@ class ONeural{
     /// @return *this
     ONeural& operator=(const ONeural& other);
 
-    real_number_t accuracy(data_batch* test);
+    /// @brief Part of the `test` samples classified correctly, computed on the frozen network (`InferencePlan` batch calls)
+    real_number_t accuracy(const data_batch* test);
+    real_number_t accuracy(const data::Dataset* test);
 
     OLayer _output_layer;
     std::vector<OLayer> _hidden_layers;
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "namespaces.hpp"
+#include "InferencePlan.hpp"
+
+START_NAMESPACE_NEURAL_NETWORK
+
+class ONeural;
+
+/**
+ * @brief RCU style handle of the published network, shared by the trainer and any number of readers.
+ *
+ * The trainer `publish`es immutable snapshots of the network (`InferencePlan`) at chosen points, ex. after
+ * every epoch. Every reader thread registers its own `Reader`, which returns the latest snapshot: if nothing
+ * was published since the last call, that's a single atomic load (of the version), otherwise the reader copies
+ * the new plan (the copy shares the packed parameters), protected by its hazard pointer. The replaced
+ * snapshots are reclaimed by the next `publish` calls, once no reader is copying them, the parameters
+ * live as long as any reader's plan uses them.
+ *
+ * Neither side waits for the other: publishing never waits for the readers and reading never waits for
+ * the trainer (`publish` calls are serialized only among themselves).
+ *
+ * Usage:
+ * @code
+ * PublishedModel model;
+ * model.publish(network);                     // trainer thread
+ *
+ * PublishedModel::Reader reader(model);       // reader thread
+ * size_t guess = reader.plan().classify(pixels);
+ * @endcode
+*/
+class PublishedModel{
+    struct _Snapshot{
+        InferencePlan plan;
+        uint64_t version;
+    };
+
+    public:
+    /// @brief Maximum number of the readers registered at once
+    static constexpr size_t MAX_READERS = 64;
+
+    /// @brief Reading side of the `PublishedModel`, use one per thread
+    class Reader{
+        PublishedModel* _model;
+        size_t _slot;
+        uint64_t _version;
+        InferencePlan _plan;
+
+        public:
+        /// @throw std::runtime_error if there are already `MAX_READERS` readers
+        explicit Reader(PublishedModel& model);
+        ~Reader();
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        /// @brief The latest published plan, owned by this reader (empty if nothing was published yet)
+        InferencePlan& plan();
+
+        /// @brief Version of the last `plan()`, 0 if nothing was published yet
+        inline uint64_t version() const {
+            return _version;
+        }
+    };
+
+    PublishedModel();
+
+    /// @brief All of the readers must be destroyed before the model
+    ~PublishedModel();
+
+    PublishedModel(const PublishedModel&) = delete;
+    PublishedModel& operator=(const PublishedModel&) = delete;
+
+    /**
+     * @brief Publishes the frozen `network` (see `ONeural::freeze`), the readers see it on their next `plan()` call
+     * @return version of the published snapshot
+    */
+    uint64_t publish(const ONeural& network);
+
+    /// @brief Publishes the `plan`
+    uint64_t publish(InferencePlan plan);
+
+    /// @brief Version of the latest snapshot, 0 if nothing was published yet
+    inline uint64_t version() const {
+        return _version.load(std::memory_order_acquire);
+    }
+
+    private:
+    std::atomic<const _Snapshot*> _current;
+    std::atomic<uint64_t> _version;
+    std::array<std::atomic<const _Snapshot*>, MAX_READERS> _hazards;
+    std::array<std::atomic<bool>, MAX_READERS> _slots;
+
+    // publishing side only
+    std::mutex _publish_mutex;
+    std::vector<const _Snapshot*> _retired;
+
+    /// @brief Deletes the retired snapshots no reader is copying
+    void _reclaim();
+};
+
+END_NAMESPACE
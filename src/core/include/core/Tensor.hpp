@@ -0,0 +1,163 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "namespaces.hpp"
+#include "types.hpp"
+
+START_NAMESPACE_NEURAL_NETWORK
+
+/**
+ * @brief Order of the axes of an image
+*/
+enum class Layout {
+    // (channels, rows, cols), the channels are planes one after another
+    channels_first,
+    // (rows, cols, channels), the channels of a pixel are next to each other
+    channels_last
+};
+
+/**
+ * @brief N-dimensional array of real numbers in a single contiguous block, with a shape and strides.
+ *
+ * Copies and views (`operator[]`, `slice`, `reshape`, `flatten`) share the storage, they are O(1) and never copy
+ * the values, so writing through a view changes the viewed tensor. Use `clone` for an independent copy.
+ * `reshape` and `flatten` of a non-contiguous view (ex. a slice of an inner axis) copy it first.
+ *
+ * Usage:
+ * @code
+ * Tensor image({1, 28, 28}, pixels);   // copies the pixels, (channels, rows, cols)
+ * image(0, 3, 4) = 1.0;
+ * Tensor rows = image[0].slice(0, 10, 20); // rows 10..19 of the first channel, no copy
+ * vector_t inputs = image.flatten().to_vector();
+ * @endcode
+*/
+class Tensor{
+    public:
+    using shape_t = std::vector<size_t>;
+
+    Tensor() = default;
+
+    /// @brief Tensor of the given shape, filled with the `value`
+    explicit Tensor(shape_t shape, real_number_t value = 0.0);
+
+    /// @brief Tensor of the given shape, with a copy of the `values` (row-major)
+    /// @throw std::runtime_error if the number of the values doesn't match the shape
+    Tensor(shape_t shape, const vector_t& values);
+
+    inline size_t rank() const {
+        return _shape.size();
+    }
+
+    inline const shape_t& shape() const {
+        return _shape;
+    }
+
+    inline size_t dim(size_t axis) const {
+        return _shape[axis];
+    }
+
+    /// @brief Strides of the axes, in values
+    inline const shape_t& strides() const {
+        return _strides;
+    }
+
+    /// @brief Number of the values, 0 for the default constructed tensor
+    inline size_t size() const {
+        size_t size = 1;
+        for (size_t dim : _shape){
+            size *= dim;
+        }
+        return _storage ? size : 0;
+    }
+
+    inline bool empty() const {
+        return size() == 0;
+    }
+
+    /// @brief True if the values are stored row-major without gaps, so `data()` may be indexed directly
+    bool is_contiguous() const;
+
+    /// @brief Pointer to the first value
+    inline real_number_t* data(){
+        return _storage->data() + _offset;
+    }
+
+    inline const real_number_t* data() const {
+        return _storage->data() + _offset;
+    }
+
+    /// @brief Value at the index, one per axis
+    template <class... Index>
+    inline real_number_t& operator()(Index... index){
+        return (*_storage)[_index(index...)];
+    }
+
+    template <class... Index>
+    inline const real_number_t& operator()(Index... index) const {
+        return (*_storage)[_index(index...)];
+    }
+
+    /// @brief View of the `index`-th subtensor along the first axis, with one axis less
+    Tensor operator[](size_t index) const;
+
+    /// @brief View of the [begin, end) range of the `axis`
+    Tensor slice(size_t axis, size_t begin, size_t end) const;
+
+    /// @brief View with another shape of the same number of values
+    /// @throw std::runtime_error if the number of the values differs
+    Tensor reshape(shape_t shape) const;
+
+    /// @brief View with the reordered axes, the `i`-th axis of the view is the `axes[i]`-th one of this tensor
+    /// @throw std::runtime_error if `axes` isn't a permutation of the axes
+    Tensor permute(const shape_t& axes) const;
+
+    /// @brief One dimensional view of all the values
+    inline Tensor flatten() const {
+        return reshape({size()});
+    }
+
+    /// @brief Contiguous copy, with its own storage
+    Tensor clone() const;
+
+    /// @brief This tensor if it's contiguous, otherwise its `clone`
+    Tensor contiguous() const;
+
+    void fill(real_number_t value);
+
+    /// @brief Copy of the values (row-major)
+    vector_t to_vector() const;
+
+    private:
+    std::shared_ptr<vector_t> _storage;
+    size_t _offset = 0;
+    shape_t _shape;
+    shape_t _strides;
+
+    template <class... Index>
+    inline size_t _index(Index... index) const {
+        size_t axis = 0, offset = _offset;
+        ((offset += static_cast<size_t>(index) * _strides[axis++]), ...);
+        return offset;
+    }
+
+    /// @brief Calls `function(offset)` with the storage offset of every value, in the row-major order
+    template <class Function>
+    void _for_each_offset(Function function) const;
+
+    /// @brief Row-major strides of the `shape`
+    static shape_t _contiguous_strides(const shape_t& shape);
+};
+
+/**
+ * @brief Contiguous (rows, cols, channels) copy of a (channels, rows, cols) image
+*/
+Tensor to_channels_last(const Tensor& image);
+
+/**
+ * @brief Contiguous (channels, rows, cols) copy of a (rows, cols, channels) image
+*/
+Tensor to_channels_first(const Tensor& image);
+
+END_NAMESPACE
@@ -1,7 +1,12 @@
 #pragma once
 
 #include "ONeural.hpp"
+#include "LinearModel.hpp"
 #include "ConvolutionLayer.hpp"
 #include "MaxPool.hpp"
 #include "utils.hpp"
-#include "CNN.hpp"
\ No newline at end of file
+#include "CNN.hpp"
+#include "InferencePlan.hpp"
+#include "PublishedModel.hpp"
+#include "FFT.hpp"
+#include "Tensor.hpp"
\ No newline at end of file
@@ -50,8 +50,8 @@ cnn& cnn::build(
   (void)_pool.build(
     pooling_kernel_size,
     number_of_kernels,
-    stride,
-    padding
+    pooling_stride,
+    pooling_padding
   );
   size_t output_size = _pool.get_output_size(_conv.get_output_size(input_size));
 
@@ -69,39 +69,70 @@ void cnn::init()
   _FC.initialize();
 }
 
-void cnn::forward(matrix3d_t& input)
+cnn& cnn::layout(Layout layout)
+{
+  (void)_conv.layout(layout);
+  (void)_pool.layout(layout);
+  return *this;
+}
+
+Tensor cnn::_to_layout(const Tensor& input) const
+{
+  return _conv.get_layout() == Layout::channels_last ? to_channels_last(input) : input;
+}
+
+void cnn::forward(const Tensor& input)
 {
   _NetworkFeedData feed(_FC._output_layer, _FC._hidden_layers);
-  feed_forward(input, feed);
+  (void)feed_forward(input, feed);
 }
 
-void cnn::feed_forward(matrix3d_t& input, _NetworkFeedData& feed_data)
+Tensor cnn::feed_forward(const Tensor& input, _NetworkFeedData& feed_data)
 {
-  input = _conv.forward(input);
-  input = _pool.forward(input);
-  
-  auto flattened = flatten(input[0]);
+  return _feed_forward(_to_layout(input), feed_data);
+}
+
+Tensor cnn::_feed_forward(const Tensor& input, _NetworkFeedData& feed_data)
+{
+  // convolution, ReLU and max pooling in one pass, see `ConvLayer::forward_pooled`
+  Tensor pooled = _conv.forward_pooled(input, _pool);
+
+  // every channel of the features, row-major in the layout of the layers
+  auto flattened = pooled.flatten().to_vector();
   _FC.feed_forward(feed_data, flattened);
+  return pooled;
 }
 
-void cnn::backprop(const matrix3d_t& input, vector_t& target)
+void cnn::backprop(const Tensor& input, vector_t& target)
 {
-  auto ref = input;
+  const Tensor converted = _to_layout(input);
   _NetworkFeedData feed(_FC._output_layer, _FC._hidden_layers);
-  feed_forward(ref, feed);
+  Tensor pooled = _feed_forward(converted, feed);
 
   _FC.backprop(feed, target);
   
-  auto pool_output_size = _pool.get_output_size(_conv.get_output_size(ref[0].size()));
-  matrix3d_t prev_partial_dervis = reshape(
-    feed._layer_feed_data[0]._partial_derivatives, 
-    _pool._input_channels, 
-    pool_output_size, 
-    pool_output_size
-  );
-  
-  prev_partial_dervis = _pool.backprop(prev_partial_dervis);
-  _conv.backprop(prev_partial_dervis, ref);
+  // d(cost)/d(features) = weights^T * partial derivatives of the first fully connected layer
+  const OLayer& first = _FC._hidden_layers.empty() ? _FC._output_layer : _FC._hidden_layers[0];
+  const vector_t& partial_dervis = feed._layer_feed_data[0]._partial_derivatives;
+  Tensor prev_partial_dervis(pooled.shape());
+  real_number_t* features = prev_partial_dervis.data();
+  for(size_t neuron = 0; neuron < first._neurons_size; ++neuron)
+  {
+    const real_number_t* weights = first._weights.data() + neuron * first._inputs_size;
+    for(size_t i = 0; i < first._inputs_size; ++i)
+    {
+      features[i] += weights[i] * partial_dervis[neuron];
+    }
+  }
+
+  // the ReLU, the pooled value is the activation of the max convolution output
+  const real_number_t* activations = pooled.data();
+  for(size_t i = 0; i < pooled.size(); ++i)
+  {
+    features[i] = activations[i] > 0.0 ? features[i] : 0.0;
+  }
+
+  _conv.backprop(_pool.backprop(prev_partial_dervis), converted);
 }
 
 void cnn::apply(double learning_rate, size_t batch_size)
@@ -1,5 +1,7 @@
 #include <core/ConvolutionLayer.hpp>
 
+#include <stdexcept>
+
 START_NAMESPACE_NEURAL_NETWORK
 
 ConvLayer::ConvLayer(int kernel_size, int number_of_kernels, int input_channels, int stride, int padding)
@@ -15,50 +17,805 @@ ConvLayer& ConvLayer::build(int kernel_size, int number_of_kernels, int input_ch
   _stride = stride;
   _padding = padding;
 
-  _weights.resize(number_of_kernels, matrix_t(kernel_size, vector_t(kernel_size)));
-  _gradient_weights.resize(number_of_kernels, matrix_t(kernel_size, vector_t(kernel_size)));
+  _weights.assign(number_of_kernels * get_patch_size(), 0.0);
+  _gradient_weights.assign(number_of_kernels * get_patch_size(), 0.0);
+  _kernels_transformed = false;
+  _spectra_size = 0;
+  _weights_transposed = false;
 
   return *this;
 }
 
 void ConvLayer::initialize()
 {
-  for(auto& kernel : _weights)
+  randomize(&_weights, get_patch_size());
+  _kernels_transformed = false;
+  _spectra_size = 0;
+  _weights_transposed = false;
+}
+
+ConvLayer& ConvLayer::algorithm(ConvAlgorithm algorithm)
+{
+  _algorithm = algorithm;
+  return *this;
+}
+
+ConvLayer& ConvLayer::layout(Layout layout)
+{
+  _layout = layout;
+  return *this;
+}
+
+ConvAlgorithm ConvLayer::get_algorithm(size_t input_size) const
+{
+  const bool winograd = _kernel_size == 3 && _stride == 1;
+  if(_algorithm == ConvAlgorithm::automatic)
+  {
+    if(winograd && _input_channels >= WINOGRAD_MIN_CHANNELS)
+    {
+      return ConvAlgorithm::winograd;
+    }
+    if(_stride != 1)
+    {
+      return ConvAlgorithm::im2col;
+    }
+
+    const double output_size = get_output_size(input_size);
+    const double size = FFT::good_size(input_size + 2 * _padding);
+    const double im2col = double(_number_of_kernels) * _input_channels * output_size * output_size * _kernel_size * _kernel_size;
+    const double fft = (_number_of_kernels + _input_channels) * size * size * std::log2(size * size) * FFT_COST +
+                       double(_number_of_kernels) * _input_channels * size * (size / 2 + 1) * SPECTRUM_COST;
+    return fft < im2col ? ConvAlgorithm::fft : ConvAlgorithm::im2col;
+  }
+  if(_algorithm == ConvAlgorithm::winograd && !winograd)
+  {
+    throw std::runtime_error("ConvLayer: Winograd convolution needs a 3x3 kernel with stride 1");
+  }
+  if(_algorithm == ConvAlgorithm::fft && _stride != 1)
+  {
+    throw std::runtime_error("ConvLayer: FFT convolution needs stride 1");
+  }
+  return _algorithm;
+}
+
+Tensor ConvLayer::_contiguous_input(const Tensor& input) const
+{
+  if(_layout == Layout::channels_last)
+  {
+    if(input.rank() != 3 || input.dim(2) != size_t(_input_channels) || input.dim(0) != input.dim(1))
+    {
+      throw std::runtime_error("ConvLayer: the input must be a (input_size, input_size, input_channels) tensor");
+    }
+  }
+  else if(input.rank() != 3 || input.dim(0) != size_t(_input_channels) || input.dim(1) != input.dim(2))
+  {
+    throw std::runtime_error("ConvLayer: the input must be a (input_channels, input_size, input_size) tensor");
+  }
+  return input.contiguous();
+}
+
+size_t ConvLayer::_pack(const Tensor& input)
+{
+  const size_t output_size = get_output_size(input.dim(1));
+  _pack_rows(input, 0, output_size);
+  return output_size;
+}
+
+void ConvLayer::_pack_rows(const Tensor& input, int row_begin, int row_end)
+{
+  const int input_size = input.dim(1);
+  const int output_size = get_output_size(input_size);
+  const size_t positions = (row_end - row_begin) * output_size;
+  _columns.resize(get_patch_size() * positions);
+
+  real_number_t* column = _columns.data();
+  for(int channel = 0; channel < _input_channels; ++channel)
+  {
+    for(int k = 0; k < _kernel_size; ++k)
+    {
+      for(int l = 0; l < _kernel_size; ++l)
+      {
+        // output columns [j_begin, j_end) read inside of the input row, the rest is padding
+        const int offset = l - _padding;
+        const int j_begin = std::min(output_size, offset < 0 ? (-offset + _stride - 1) / _stride : 0);
+        const int last = input_size - 1 - offset;
+        const int j_end = last < 0 ? j_begin : std::max(j_begin, std::min(output_size, last / _stride + 1));
+
+        for(int i = row_begin; i < row_end; ++i, column += output_size)
+        {
+          const int x = i * _stride - _padding + k;
+          if(x < 0 || x >= input_size)
+          {
+            std::fill(column, column + output_size, 0.0);
+            continue;
+          }
+          const real_number_t* row = input.data() + (channel * input_size + x) * input_size;
+          std::fill(column, column + j_begin, 0.0);
+          for(int j = j_begin; j < j_end; ++j)
+          {
+            column[j] = row[j * _stride + offset];
+          }
+          std::fill(column + j_end, column + output_size, 0.0);
+        }
+      }
+    }
+  }
+}
+
+namespace {
+  // Kernels computed at once, every packed patch row is loaded once per block
+  constexpr size_t KERNEL_BLOCK = 4;
+  // Convolution outputs of a band of `forward_pooled` (128 KB)
+  constexpr int BAND_VALUES = 16384;
+
+  /**
+   * @brief out (kernels, positions) = weights (kernels, patch) * columns (patch, positions)
+  */
+  void multiply(
+    const real_number_t* weights, const real_number_t* columns, real_number_t* out,
+    size_t kernels, size_t patch, size_t positions
+  )
+  {
+    std::fill(out, out + kernels * positions, 0.0);
+
+    size_t kernel = 0;
+    for(; kernel + KERNEL_BLOCK <= kernels; kernel += KERNEL_BLOCK)
+    {
+      const real_number_t* w = weights + kernel * patch;
+      real_number_t* o0 = out + kernel * positions;
+      real_number_t* o1 = o0 + positions;
+      real_number_t* o2 = o1 + positions;
+      real_number_t* o3 = o2 + positions;
+
+      for(size_t r = 0; r < patch; ++r)
+      {
+        const real_number_t w0 = w[r], w1 = w[patch + r], w2 = w[2 * patch + r], w3 = w[3 * patch + r];
+        const real_number_t* c = columns + r * positions;
+        for(size_t p = 0; p < positions; ++p)
+        {
+          o0[p] += w0 * c[p];
+          o1[p] += w1 * c[p];
+          o2[p] += w2 * c[p];
+          o3[p] += w3 * c[p];
+        }
+      }
+    }
+
+    for(; kernel < kernels; ++kernel)
+    {
+      real_number_t* o = out + kernel * positions;
+      for(size_t r = 0; r < patch; ++r)
+      {
+        const real_number_t w = weights[kernel * patch + r];
+        const real_number_t* c = columns + r * positions;
+        for(size_t p = 0; p < positions; ++p)
+        {
+          o[p] += w * c[p];
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief gradient (kernels, patch) += partial_dervis (kernels, positions) * columns^T (positions, patch)
+  */
+  void multiply_transposed(
+    const real_number_t* partial_dervis, const real_number_t* columns, real_number_t* gradient,
+    size_t kernels, size_t patch, size_t positions
+  )
+  {
+    size_t kernel = 0;
+    for(; kernel + KERNEL_BLOCK <= kernels; kernel += KERNEL_BLOCK)
+    {
+      const real_number_t* d0 = partial_dervis + kernel * positions;
+      const real_number_t* d1 = d0 + positions;
+      const real_number_t* d2 = d1 + positions;
+      const real_number_t* d3 = d2 + positions;
+      real_number_t* g = gradient + kernel * patch;
+
+      for(size_t r = 0; r < patch; ++r)
+      {
+        const real_number_t* c = columns + r * positions;
+        real_number_t s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        for(size_t p = 0; p < positions; ++p)
+        {
+          s0 += d0[p] * c[p];
+          s1 += d1[p] * c[p];
+          s2 += d2[p] * c[p];
+          s3 += d3[p] * c[p];
+        }
+        g[r] += s0;
+        g[patch + r] += s1;
+        g[2 * patch + r] += s2;
+        g[3 * patch + r] += s3;
+      }
+    }
+
+    for(; kernel < kernels; ++kernel)
+    {
+      const real_number_t* d = partial_dervis + kernel * positions;
+      for(size_t r = 0; r < patch; ++r)
+      {
+        const real_number_t* c = columns + r * positions;
+        real_number_t sum = 0.0;
+        for(size_t p = 0; p < positions; ++p)
+        {
+          sum += d[p] * c[p];
+        }
+        gradient[kernel * patch + r] += sum;
+      }
+    }
+  }
+
+  // Winograd F(2x2, 3x3): 2x2 output tile from a 4x4 input tile, Y = A^T [(G g G^T) * (B^T d B)] A
+  constexpr int TILE_OUTPUT = 2;
+  constexpr int TILE_INPUT = 4;
+  constexpr size_t TILE_ELEMENTS = TILE_INPUT * TILE_INPUT;
+  // Tiles transformed at once
+  constexpr size_t TILE_BLOCK = 256;
+
+  /**
+   * @brief u = G g G^T, g: 3x3 kernel, u: 4x4
+  */
+  void transform_kernel(const real_number_t* g, real_number_t* u)
   {
-    for(auto& weights : kernel)
+    real_number_t t[4][3];
+    for(int j = 0; j < 3; ++j)
     {
-      randomize(&weights, _kernel_size);
+      t[0][j] = g[j];
+      t[1][j] = 0.5 * (g[j] + g[3 + j] + g[6 + j]);
+      t[2][j] = 0.5 * (g[j] - g[3 + j] + g[6 + j]);
+      t[3][j] = g[6 + j];
+    }
+    for(int i = 0; i < 4; ++i)
+    {
+      u[4 * i + 0] = t[i][0];
+      u[4 * i + 1] = 0.5 * (t[i][0] + t[i][1] + t[i][2]);
+      u[4 * i + 2] = 0.5 * (t[i][0] - t[i][1] + t[i][2]);
+      u[4 * i + 3] = t[i][2];
     }
   }
 
-  // _weights[0] = {
-  //   // {0.25, 0, -0.25},
-  //   // {0.5, 0, -0.5},
-  //   // {0.25, 0, -0.25}
+  /**
+   * @brief v = B^T d B, d and v: 4x4
+  */
+  void transform_input(const real_number_t (&d)[4][4], real_number_t (&v)[4][4])
+  {
+    real_number_t t[4][4];
+    for(int j = 0; j < 4; ++j)
+    {
+      t[0][j] = d[0][j] - d[2][j];
+      t[1][j] = d[1][j] + d[2][j];
+      t[2][j] = d[2][j] - d[1][j];
+      t[3][j] = d[1][j] - d[3][j];
+    }
+    for(int i = 0; i < 4; ++i)
+    {
+      v[i][0] = t[i][0] - t[i][2];
+      v[i][1] = t[i][1] + t[i][2];
+      v[i][2] = t[i][2] - t[i][1];
+      v[i][3] = t[i][1] - t[i][3];
+    }
+  }
 
-  //   // {0.25, 0.5, 0.25},
-  //   // {0, 0, 0},
-  //   // {-0.25, -0.5, -0.25}
+  /**
+   * @brief y = A^T m A, m: 4x4, y: 2x2
+  */
+  void transform_output(const real_number_t (&m)[4][4], real_number_t (&y)[2][2])
+  {
+    real_number_t t[2][4];
+    for(int j = 0; j < 4; ++j)
+    {
+      t[0][j] = m[0][j] + m[1][j] + m[2][j];
+      t[1][j] = m[1][j] - m[2][j] - m[3][j];
+    }
+    for(int i = 0; i < 2; ++i)
+    {
+      y[i][0] = t[i][0] + t[i][1] + t[i][2];
+      y[i][1] = t[i][1] - t[i][2] - t[i][3];
+    }
+  }
+}
 
-  //   {0, 0, 0},
-  //   {0, 1, 0},
-  //   {0, 0, 0},
+Tensor ConvLayer::forward(const Tensor& input)
+{
+  const Tensor contiguous = _contiguous_input(input);
+  if(_layout == Layout::channels_last)
+  {
+    return _forward_channels_last(contiguous);
+  }
+  switch(get_algorithm(contiguous.dim(1)))
+  {
+    case ConvAlgorithm::winograd:
+      return _forward_winograd(contiguous);
+    case ConvAlgorithm::fft:
+      return _forward_fft(contiguous);
+    default:
+      return _forward_im2col(contiguous);
+  }
+}
 
-  // };
+Tensor ConvLayer::_forward_im2col(const Tensor& input)
+{
+  const size_t output_size = _pack(input);
+  const size_t positions = output_size * output_size;
 
-  //  Gaussian kernel
-  // for (int x = -1; x < 2; x++){
-  //       for (int y = -1; y < 2; y++){
-  //           _weights[0][x+1][y+1] = exp(-(x*x + y*y) / 2.0) / (2 * M_PI);
-  //       }
-  //   }
+  // the (kernels, positions) product is already the row-major output
+  Tensor output({size_t(_number_of_kernels), output_size, output_size});
+  multiply(_weights.data(), _columns.data(), output.data(), _number_of_kernels, get_patch_size(), positions);
+  return output;
 }
 
-matrix3d_t ConvLayer::forward(const matrix3d_t& input)
+void ConvLayer::_transform_kernels()
 {
-  int input_size = input[_input_channels - 1].size();
+  if(_kernels_transformed)
+  {
+    return;
+  }
+
+  const size_t kernels = _number_of_kernels, channels = _input_channels;
+  _winograd_kernels.resize(TILE_ELEMENTS * kernels * channels);
+
+  real_number_t u[TILE_ELEMENTS];
+  for(size_t kernel = 0; kernel < kernels; ++kernel)
+  {
+    for(size_t channel = 0; channel < channels; ++channel)
+    {
+      transform_kernel(_weights.data() + (kernel * channels + channel) * 9, u);
+      for(size_t e = 0; e < TILE_ELEMENTS; ++e)
+      {
+        _winograd_kernels[(e * kernels + kernel) * channels + channel] = u[e];
+      }
+    }
+  }
+  _kernels_transformed = true;
+}
+
+Tensor ConvLayer::_forward_winograd(const Tensor& input)
+{
+  _transform_kernels();
+
+  const int input_size = input.dim(1);
+  const int output_size = get_output_size(input_size);
+  const int tiles_per_row = (output_size + TILE_OUTPUT - 1) / TILE_OUTPUT;
+  const size_t tiles = tiles_per_row * tiles_per_row;
+  const size_t kernels = _number_of_kernels, channels = _input_channels;
+
+  _winograd_inputs.resize(TILE_ELEMENTS * channels * TILE_BLOCK);
+  _winograd_products.resize(TILE_ELEMENTS * kernels * TILE_BLOCK);
+  Tensor output({kernels, size_t(output_size), size_t(output_size)});
+  const real_number_t* in = input.data();
+  real_number_t* out = output.data();
+
+  // a block of the tiles at once, so the transformed tiles stay in the cache
+  for(size_t first = 0; first < tiles; first += TILE_BLOCK)
+  {
+    const size_t block = std::min(TILE_BLOCK, tiles - first);
+
+    // transformed input tiles, the tiles overlap by 2 pixels, zeros in the padding
+    real_number_t d[4][4], v[4][4];
+    for(size_t channel = 0; channel < channels; ++channel)
+    {
+      for(size_t tile = 0; tile < block; ++tile)
+      {
+        const int x0 = (first + tile) / tiles_per_row * TILE_OUTPUT - _padding;
+        const int y0 = (first + tile) % tiles_per_row * TILE_OUTPUT - _padding;
+        const bool inside = x0 >= 0 && y0 >= 0 && x0 + TILE_INPUT <= input_size && y0 + TILE_INPUT <= input_size;
+        for(int i = 0; i < TILE_INPUT; ++i)
+        {
+          for(int j = 0; j < TILE_INPUT; ++j)
+          {
+            const int x = x0 + i, y = y0 + j;
+            d[i][j] = inside || (x >= 0 && x < input_size && y >= 0 && y < input_size) ? in[(channel * input_size + x) * input_size + y] : 0.0;
+          }
+        }
+        transform_input(d, v);
+
+        for(size_t e = 0; e < TILE_ELEMENTS; ++e)
+        {
+          _winograd_inputs[(e * channels + channel) * block + tile] = v[e / 4][e % 4];
+        }
+      }
+    }
+
+    // one product per tile element, summed over the channels: (kernels, channels) * (channels, block)
+    for(size_t e = 0; e < TILE_ELEMENTS; ++e)
+    {
+      multiply(
+        _winograd_kernels.data() + e * kernels * channels,
+        _winograd_inputs.data() + e * channels * block,
+        _winograd_products.data() + e * kernels * block,
+        kernels, channels, block
+      );
+    }
+
+    real_number_t m[4][4], y[2][2];
+    for(size_t kernel = 0; kernel < kernels; ++kernel)
+    {
+      for(size_t tile = 0; tile < block; ++tile)
+      {
+        for(size_t e = 0; e < TILE_ELEMENTS; ++e)
+        {
+          m[e / 4][e % 4] = _winograd_products[(e * kernels + kernel) * block + tile];
+        }
+        transform_output(m, y);
+
+        // the last tile may stick out of an odd sized output
+        const int x0 = (first + tile) / tiles_per_row * TILE_OUTPUT;
+        const int y0 = (first + tile) % tiles_per_row * TILE_OUTPUT;
+        for(int i = 0; i < TILE_OUTPUT && x0 + i < output_size; ++i)
+        {
+          for(int j = 0; j < TILE_OUTPUT && y0 + j < output_size; ++j)
+          {
+            out[(kernel * output_size + x0 + i) * output_size + y0 + j] = y[i][j];
+          }
+        }
+      }
+    }
+  }
+  return output;
+}
+
+void ConvLayer::_transform_kernel_spectra(size_t size)
+{
+  if(_spectra_size == size)
+  {
+    return;
+  }
+
+  const size_t kernels = _number_of_kernels, channels = _input_channels, patch = _kernel_size * _kernel_size;
+  const size_t spectrum = _fft.spectrum_size();
+  _kernel_spectra.resize(kernels * channels * spectrum);
+
+  // the output is the cross-correlation with the kernel, so the products use its conjugated spectrum
+  std::fill(_fft_image.begin(), _fft_image.end(), 0.0);
+  for(size_t kernel = 0; kernel < kernels; ++kernel)
+  {
+    for(size_t channel = 0; channel < channels; ++channel)
+    {
+      const real_number_t* weights = _weights.data() + (kernel * channels + channel) * patch;
+      for(int k = 0; k < _kernel_size; ++k)
+      {
+        std::copy(weights + k * _kernel_size, weights + (k + 1) * _kernel_size, _fft_image.begin() + k * size);
+      }
+
+      complex_t* out = _kernel_spectra.data() + (kernel * channels + channel) * spectrum;
+      _fft.forward(_fft_image.data(), out);
+      for(size_t i = 0; i < spectrum; ++i)
+      {
+        out[i] = std::conj(out[i]);
+      }
+    }
+  }
+  // clears the kernels for the inputs
+  std::fill(_fft_image.begin(), _fft_image.end(), 0.0);
+  _spectra_size = size;
+}
+
+Tensor ConvLayer::_forward_fft(const Tensor& input)
+{
+  const int input_size = input.dim(1);
+  const int output_size = get_output_size(input_size);
+  const size_t kernels = _number_of_kernels, channels = _input_channels;
+
+  // the padded input fits in the transform, so the circular correlation doesn't wrap around
+  const size_t size = FFT::good_size(input_size + 2 * _padding);
+  if(_fft.rows() != size || _fft_image.size() != size * size)
+  {
+    _fft = RealFFT2D(size, size);
+    _fft_image.assign(size * size, 0.0);
+    _spectra_size = 0;
+  }
+  _transform_kernel_spectra(size);
+
+  // every channel is transformed once, the padding stays zero
+  const size_t spectrum = _fft.spectrum_size();
+  _input_spectra.resize(channels * spectrum);
+  for(size_t channel = 0; channel < channels; ++channel)
+  {
+    const real_number_t* image = input.data() + channel * input_size * input_size;
+    for(int i = 0; i < input_size; ++i)
+    {
+      std::copy(image + i * input_size, image + (i + 1) * input_size, _fft_image.begin() + (i + _padding) * size + _padding);
+    }
+    _fft.forward(_fft_image.data(), _input_spectra.data() + channel * spectrum);
+  }
+
+  // and every kernel is transformed back once, after summing the products over the channels
+  Tensor output({kernels, size_t(output_size), size_t(output_size)});
+  _output_spectrum.resize(spectrum);
+  for(size_t kernel = 0; kernel < kernels; ++kernel)
+  {
+    std::fill(_output_spectrum.begin(), _output_spectrum.end(), complex_t(0.0));
+    for(size_t channel = 0; channel < channels; ++channel)
+    {
+      const complex_t* x = _input_spectra.data() + channel * spectrum;
+      const complex_t* w = _kernel_spectra.data() + (kernel * channels + channel) * spectrum;
+      for(size_t i = 0; i < spectrum; ++i)
+      {
+        _output_spectrum[i] += complex_multiply(x[i], w[i]);
+      }
+    }
+
+    _fft.inverse(_output_spectrum.data(), _fft_image.data());
+    real_number_t* out = output.data() + kernel * output_size * output_size;
+    for(int i = 0; i < output_size; ++i)
+    {
+      std::copy(_fft_image.begin() + i * size, _fft_image.begin() + i * size + output_size, out + i * output_size);
+    }
+  }
+
+  // the next input is copied into a zero padded image again
+  std::fill(_fft_image.begin(), _fft_image.end(), 0.0);
+  return output;
+}
+
+void ConvLayer::backprop(const Tensor& partial_dervis, const Tensor& inputs)
+{
+  if(_layout == Layout::channels_last)
+  {
+    _backprop_channels_last(partial_dervis, _contiguous_input(inputs));
+    return;
+  }
+  const size_t output_size = _pack(_contiguous_input(inputs));
+  const size_t positions = output_size * output_size;
+  if(partial_dervis.size() != _number_of_kernels * positions)
+  {
+    throw std::runtime_error("ConvLayer: the partial derivatives must match the output of the layer");
+  }
+
+  // (number_of_kernels, output_size, output_size) row-major is the packed (kernels, positions) matrix
+  const Tensor partial = partial_dervis.contiguous();
+  multiply_transposed(
+    partial.data(), _columns.data(), _gradient_weights.data(),
+    _number_of_kernels, get_patch_size(), positions
+  );
+}
+
+Tensor ConvLayer::forward_pooled(const Tensor& input, MaxPoolingLayer& pool)
+{
+  const Tensor contiguous = _contiguous_input(input);
+  if(pool.get_layout() != _layout || pool._input_channels != _number_of_kernels)
+  {
+    throw std::runtime_error("ConvLayer: the pooling layer must match the layout and the kernels of the convolution");
+  }
+
+  const bool channels_last = _layout == Layout::channels_last;
+  const int output_size = get_output_size(contiguous.dim(channels_last ? 0 : 1));
+  Tensor pooled = pool._start_forward(output_size);
+  const int pooled_size = pool.get_output_size(output_size);
+  if(channels_last)
+  {
+    _transpose_weights();
+  }
+  else
+  {
+    // Winograd and FFT transform whole tiles (or the whole image), so the full output is convolved,
+    // only the ReLU is fused into the pooling
+    const ConvAlgorithm algorithm = get_algorithm(contiguous.dim(1));
+    if(algorithm != ConvAlgorithm::im2col)
+    {
+      const Tensor convolved = algorithm == ConvAlgorithm::winograd ? _forward_winograd(contiguous) : _forward_fft(contiguous);
+      pool._pool_rows(convolved.data(), 0, output_size, 0, pooled_size, pooled.data(), true);
+      return pooled;
+    }
+  }
+
+  // bands of the pooled rows, the convolution computes only the rows their windows read,
+  // so the outputs in flight stay in the cache instead of the whole (number_of_kernels, output_size, output_size)
+  const int band = std::max<int>(1, BAND_VALUES / (_number_of_kernels * output_size * pool._stride));
+  for(int row_begin = 0; row_begin < pooled_size; row_begin += band)
+  {
+    const int row_end = std::min(pooled_size, row_begin + band);
+    const int first = std::max(0, row_begin * pool._stride - pool._padding);
+    const int last = std::min(output_size, (row_end - 1) * pool._stride - pool._padding + pool._kernel_size);
+    if(first >= last)
+    {
+      // the windows are in the padding, the pool fills the lowest value
+      pool._pool_rows(nullptr, first, first, row_begin, row_end, pooled.data(), true);
+      continue;
+    }
+
+    const size_t positions = (last - first) * output_size;
+    _band.assign(_number_of_kernels * positions, 0.0);
+    if(channels_last)
+    {
+      _convolve_rows_channels_last(contiguous, first, last, _band.data());
+    }
+    else
+    {
+      _pack_rows(contiguous, first, last);
+      multiply(_weights.data(), _columns.data(), _band.data(), _number_of_kernels, get_patch_size(), positions);
+    }
+    pool._pool_rows(_band.data(), first, last, row_begin, row_end, pooled.data(), true);
+  }
+  return pooled;
+}
+
+void ConvLayer::_transpose_weights()
+{
+  if(_weights_transposed)
+  {
+    return;
+  }
+
+  const size_t kernels = _number_of_kernels, channels = _input_channels, patch = _kernel_size * _kernel_size;
+  _channels_last_weights.resize(kernels * get_patch_size());
+  for(size_t kernel = 0; kernel < kernels; ++kernel)
+  {
+    for(size_t channel = 0; channel < channels; ++channel)
+    {
+      for(size_t e = 0; e < patch; ++e)
+      {
+        _channels_last_weights[(e * channels + channel) * kernels + kernel] = _weights[(kernel * channels + channel) * patch + e];
+      }
+    }
+  }
+  _weights_transposed = true;
+}
+
+Tensor ConvLayer::_forward_channels_last(const Tensor& input)
+{
+  _transpose_weights();
+
+  const size_t output_size = get_output_size(input.dim(0));
+  Tensor output({output_size, output_size, size_t(_number_of_kernels)});
+  _convolve_rows_channels_last(input, 0, output_size, output.data());
+  return output;
+}
+
+void ConvLayer::_convolve_rows_channels_last(const Tensor& input, int row_begin, int row_end, real_number_t* band)
+{
+  const int input_size = input.dim(0);
+  const int output_size = get_output_size(input_size);
+  const size_t kernels = _number_of_kernels, channels = _input_channels;
+  const size_t row_size = input_size * channels, weights_row = _kernel_size * channels * kernels;
+
+  const real_number_t* in = input.data();
+  real_number_t* out = band - row_begin * output_size * kernels;
+
+  for(int i = row_begin; i < row_end; ++i)
+  {
+    for(int k = 0; k < _kernel_size; ++k)
+    {
+      const int x = i * _stride - _padding + k;
+      if(x < 0 || x >= input_size)
+      {
+        continue;
+      }
+      for(int j = 0; j < output_size; ++j)
+      {
+        // the kernel columns [l_begin, l_end) read inside of the row, their channels are one contiguous run
+        const int y = j * _stride - _padding;
+        const int l_begin = std::max(0, -y), l_end = std::min(_kernel_size, input_size - y);
+        if(l_begin >= l_end)
+        {
+          continue;
+        }
+        const real_number_t* a = in + x * row_size + (y + l_begin) * channels;
+        const real_number_t* w = _channels_last_weights.data() + k * weights_row + l_begin * channels * kernels;
+        const size_t span = (l_end - l_begin) * channels;
+        real_number_t* o = out + (i * output_size + j) * kernels;
+
+        // o (kernels) += a (span) * w (span, kernels), the inner loops over the kernels are vectorized
+        size_t r = 0;
+        for(; r + 4 <= span; r += 4)
+        {
+          const real_number_t a0 = a[r], a1 = a[r + 1], a2 = a[r + 2], a3 = a[r + 3];
+          const real_number_t* w0 = w + r * kernels;
+          const real_number_t* w1 = w0 + kernels;
+          const real_number_t* w2 = w1 + kernels;
+          const real_number_t* w3 = w2 + kernels;
+          for(size_t c = 0; c < kernels; ++c)
+          {
+            o[c] += a0 * w0[c] + a1 * w1[c] + a2 * w2[c] + a3 * w3[c];
+          }
+        }
+        for(; r < span; ++r)
+        {
+          const real_number_t a0 = a[r];
+          const real_number_t* w0 = w + r * kernels;
+          for(size_t c = 0; c < kernels; ++c)
+          {
+            o[c] += a0 * w0[c];
+          }
+        }
+      }
+    }
+  }
+}
+
+void ConvLayer::_backprop_channels_last(const Tensor& partial_dervis, const Tensor& inputs)
+{
+  const int input_size = inputs.dim(0);
+  const int output_size = get_output_size(input_size);
+  const size_t kernels = _number_of_kernels, channels = _input_channels, patch = _kernel_size * _kernel_size;
+  const size_t row_size = input_size * channels, weights_row = _kernel_size * channels * kernels;
+  if(partial_dervis.size() != size_t(output_size * output_size) * kernels)
+  {
+    throw std::runtime_error("ConvLayer: the partial derivatives must match the output of the layer");
+  }
+
+  const Tensor partial = partial_dervis.contiguous();
+  const real_number_t* in = inputs.data();
+  _channels_last_gradient.assign(kernels * get_patch_size(), 0.0);
+
+  for(int i = 0; i < output_size; ++i)
+  {
+    for(int k = 0; k < _kernel_size; ++k)
+    {
+      const int x = i * _stride - _padding + k;
+      if(x < 0 || x >= input_size)
+      {
+        continue;
+      }
+      const real_number_t* row = in + x * row_size;
+      real_number_t* g = _channels_last_gradient.data() + k * weights_row;
+      for(int j = 0; j < output_size;)
+      {
+        const int y = j * _stride - _padding;
+        const real_number_t* d = partial.data() + (i * output_size + j) * kernels;
+
+        // 4 outputs with the whole kernel inside of the row update the gradient rows at once,
+        // g (kernel_size * channels, kernels) += a_n (kernel_size * channels) * d_n (kernels)
+        if(j + 4 <= output_size && y >= 0 && y + 3 * _stride + _kernel_size <= input_size)
+        {
+          const size_t span = _kernel_size * channels, step = _stride * channels;
+          const real_number_t* a = row + y * channels;
+          const real_number_t* d1 = d + kernels;
+          const real_number_t* d2 = d1 + kernels;
+          const real_number_t* d3 = d2 + kernels;
+          for(size_t r = 0; r < span; ++r)
+          {
+            const real_number_t a0 = a[r], a1 = a[r + step], a2 = a[r + 2 * step], a3 = a[r + 3 * step];
+            real_number_t* g0 = g + r * kernels;
+            for(size_t c = 0; c < kernels; ++c)
+            {
+              g0[c] += a0 * d[c] + a1 * d1[c] + a2 * d2[c] + a3 * d3[c];
+            }
+          }
+          j += 4;
+          continue;
+        }
+
+        const int l_begin = std::max(0, -y), l_end = std::min(_kernel_size, input_size - y);
+        const real_number_t* a = row + (y + l_begin) * channels;
+        const size_t begin = l_begin * channels, span = std::max(0, l_end - l_begin) * channels;
+        for(size_t r = 0; r < span; ++r)
+        {
+          const real_number_t a0 = a[r];
+          real_number_t* g0 = g + (begin + r) * kernels;
+          for(size_t c = 0; c < kernels; ++c)
+          {
+            g0[c] += a0 * d[c];
+          }
+        }
+        ++j;
+      }
+    }
+  }
+
+  for(size_t kernel = 0; kernel < kernels; ++kernel)
+  {
+    for(size_t channel = 0; channel < channels; ++channel)
+    {
+      for(size_t e = 0; e < patch; ++e)
+      {
+        _gradient_weights[(kernel * channels + channel) * patch + e] += _channels_last_gradient[(e * channels + channel) * kernels + kernel];
+      }
+    }
+  }
+}
+
+Tensor ConvLayer::forward_direct(const Tensor& input)
+{
+  if(input.rank() != 3 || input.dim(0) != size_t(_input_channels) || input.dim(1) != input.dim(2))
+  {
+    throw std::runtime_error("ConvLayer: the input must be a (input_channels, input_size, input_size) tensor");
+  }
+  int input_size = input.dim(1);
   int output_size = get_output_size(input_size);
-  matrix3d_t output(_number_of_kernels, matrix_t(output_size, vector_t(output_size, 0.0)));
+  Tensor output({size_t(_number_of_kernels), size_t(output_size), size_t(output_size)});
 
   for(int kernel = 0; kernel < _number_of_kernels; ++kernel)
   {
@@ -77,45 +834,50 @@ matrix3d_t ConvLayer::forward(const matrix3d_t& input)
               int y = j * _stride - _padding + l;
               if(x >= 0 && x < input_size && y >= 0 && y < input_size)
               {
-                sum += ReLU::activation(input[channel][x][y] * _weights[kernel][k][l]);
+                sum += input(channel, x, y) * _weights[((kernel * _input_channels + channel) * _kernel_size + k) * _kernel_size + l];
               }
             }
           }
         }
-        output[kernel][i][j] = sum;
+        output(kernel, i, j) = sum;
       }
     }
   }
   return output;
 }
 
-void ConvLayer::backprop(matrix3d_t& partial_dervis, matrix3d_t& inputs)
+void ConvLayer::backprop_direct(const Tensor& partial_dervis, const Tensor& inputs)
 {
-  int input_size = inputs[_input_channels - 1].size();
+  if(inputs.rank() != 3 || inputs.dim(0) != size_t(_input_channels) || inputs.dim(1) != inputs.dim(2))
+  {
+    throw std::runtime_error("ConvLayer: the input must be a (input_channels, input_size, input_size) tensor");
+  }
+  int input_size = inputs.dim(1);
+  int output_size = get_output_size(input_size);
 
   for(int kernel = 0; kernel < _number_of_kernels; ++kernel)
   {
-    for(int i = 0; i < _kernel_size; ++i)
+    for(int channel = 0; channel < _input_channels; ++channel)
     {
-      for(int j = 0; j < _kernel_size; ++j)
+      for(int k = 0; k < _kernel_size; ++k)
       {
-        double sum = 0.0;
-        for(int channel = 0; channel < _input_channels; ++channel)
+        for(int l = 0; l < _kernel_size; ++l)
         {
-          for(int k = 0; k < input_size; ++k)
+          double sum = 0.0;
+          for(int i = 0; i < output_size; ++i)
           {
-            for(int l = 0; l < input_size; ++l)
+            for(int j = 0; j < output_size; ++j)
             {
-              int x = k - i + _padding;
-              int y = l - j + _padding;
+              int x = i * _stride - _padding + k;
+              int y = j * _stride - _padding + l;
               if(x >= 0 && x < input_size && y >= 0 && y < input_size)
               {
-                sum += inputs[channel][k][l] * partial_dervis[kernel][x][y];
+                sum += inputs(channel, x, y) * partial_dervis(kernel, i, j);
               }
             }
           }
+          _gradient_weights[((kernel * _input_channels + channel) * _kernel_size + k) * _kernel_size + l] += sum;
         }
-        _gradient_weights[kernel][i][j] = sum;
       }
     }
   }
@@ -123,16 +885,14 @@ void ConvLayer::backprop(matrix3d_t& partial_dervis, matrix3d_t& inputs)
 
 void ConvLayer::apply_gradients(double learn_rate, size_t batch_size)
 {
-  for(int kernel = 0; kernel < _number_of_kernels; ++kernel)
+  for(size_t i = 0; i < _weights.size(); ++i)
   {
-    for(int i = 0; i < _kernel_size; ++i)
-    {
-      for(int j = 0; j < _kernel_size; ++j)
-      {
-        _weights[kernel][i][j] -= learn_rate * _gradient_weights[kernel][i][j] / batch_size;
-      }
-    }
+    _weights[i] -= learn_rate * _gradient_weights[i] / batch_size;
   }
+  std::fill(_gradient_weights.begin(), _gradient_weights.end(), 0.0);
+  _kernels_transformed = false;
+  _spectra_size = 0;
+  _weights_transposed = false;
 }
 
 END_NAMESPACE
\ No newline at end of file
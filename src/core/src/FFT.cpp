@@ -0,0 +1,234 @@
+#include <core/FFT.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+START_NAMESPACE_NEURAL_NETWORK
+
+namespace {
+    // Radices with the generic butterfly up to this size keep the values on the stack
+    constexpr size_t MAX_STACK_RADIX = 8;
+    // Columns transformed together by `RealFFT2D`
+    constexpr size_t COLUMN_BLOCK = 8;
+
+    std::vector<size_t> factorize(size_t size){
+        std::vector<size_t> factors;
+        while (size % 4 == 0){
+            factors.push_back(4);
+            size /= 4;
+        }
+        for (size_t p = 2; size > 1; p += (p == 2 ? 1 : 2)){
+            if (p * p > size){
+                p = size;
+            }
+            while (size % p == 0){
+                factors.push_back(p);
+                size /= p;
+            }
+        }
+        return factors;
+    }
+
+    std::vector<complex_t> twiddles(size_t size, double sign){
+        std::vector<complex_t> result(size);
+        for (size_t k = 0; k < size; k++){
+            result[k] = std::polar(1.0, sign * 2.0 * M_PI * k / size);
+        }
+        return result;
+    }
+}
+
+FFT::FFT(size_t size): _size(size), _factors(factorize(size)),
+    _twiddles(twiddles(size, -1.0)), _inverse_twiddles(twiddles(size, 1.0)) {
+    if (size == 0){
+        throw std::runtime_error("FFT: the size must be positive");
+    }
+}
+
+void FFT::forward(const complex_t* in, complex_t* out) const {
+    if (_factors.empty()){
+        out[0] = in[0];
+        return;
+    }
+    _transform(out, in, 1, 0, _size, _twiddles.data());
+}
+
+void FFT::inverse(const complex_t* in, complex_t* out) const {
+    if (_factors.empty()){
+        out[0] = in[0];
+        return;
+    }
+    _transform(out, in, 1, 0, _size, _inverse_twiddles.data());
+}
+
+void FFT::_transform(complex_t* out, const complex_t* in, size_t in_stride, size_t level, size_t size,
+                     const complex_t* tw) const {
+    // decimation in time: `p` interleaved sub-sequences of size `m`, transformed into consecutive blocks of `out`
+    const size_t p = _factors[level], m = size / p;
+    if (m == 1){
+        for (size_t q = 0; q < p; q++){
+            out[q] = in[q * in_stride];
+        }
+    } else {
+        for (size_t q = 0; q < p; q++){
+            _transform(out + q * m, in + q * in_stride, in_stride * p, level + 1, m, tw);
+        }
+    }
+
+    // w_size^x = w_(_size)^(x * step)
+    const size_t step = _size / size;
+    if (p == 2){
+        for (size_t k = 0; k < m; k++){
+            complex_t t = complex_multiply(out[k + m], tw[k * step]);
+            out[k + m] = out[k] - t;
+            out[k] += t;
+        }
+    } else if (p == 4){
+        // -i for the forward transform, +i for the inverse
+        const complex_t rotation = tw[_size / 4];
+        for (size_t k = 0; k < m; k++){
+            complex_t a0 = out[k];
+            complex_t a1 = complex_multiply(out[k + m], tw[k * step]);
+            complex_t a2 = complex_multiply(out[k + 2 * m], tw[2 * k * step]);
+            complex_t a3 = complex_multiply(out[k + 3 * m], tw[3 * k * step]);
+            complex_t b0 = a0 + a2, b1 = a0 - a2, b2 = a1 + a3, b3 = complex_multiply(a1 - a3, rotation);
+            out[k] = b0 + b2;
+            out[k + m] = b1 + b3;
+            out[k + 2 * m] = b0 - b2;
+            out[k + 3 * m] = b1 - b3;
+        }
+    } else if (p == 3){
+        // w_3 = -1/2 -+ i sqrt(3)/2
+        const double sine = tw[_size / 3].imag();
+        for (size_t k = 0; k < m; k++){
+            complex_t a0 = out[k];
+            complex_t a1 = complex_multiply(out[k + m], tw[k * step]);
+            complex_t a2 = complex_multiply(out[k + 2 * m], tw[2 * k * step]);
+            complex_t sum = a1 + a2, difference = a1 - a2;
+            complex_t t = a0 - 0.5 * sum;
+            complex_t rotated(-sine * difference.imag(), sine * difference.real());
+            out[k] = a0 + sum;
+            out[k + m] = t + rotated;
+            out[k + 2 * m] = t - rotated;
+        }
+    } else {
+        complex_t stack[MAX_STACK_RADIX];
+        std::vector<complex_t> heap(p > MAX_STACK_RADIX ? p : 0);
+        complex_t* a = p > MAX_STACK_RADIX ? heap.data() : stack;
+
+        // w_p^(u q) = w_(_size)^((u q mod p) * root)
+        const size_t root = _size / p;
+        for (size_t k = 0; k < m; k++){
+            for (size_t q = 0; q < p; q++){
+                a[q] = complex_multiply(out[k + q * m], tw[q * k * step]);
+            }
+            for (size_t u = 0; u < p; u++){
+                complex_t sum = a[0];
+                for (size_t q = 1, index = u * root; q < p; q++){
+                    sum += complex_multiply(a[q], tw[index]);
+                    index += u * root;
+                    if (index >= _size){
+                        index -= _size;
+                    }
+                }
+                out[k + u * m] = sum;
+            }
+        }
+    }
+}
+
+size_t FFT::good_size(size_t size){
+    for (size_t n = std::max<size_t>(2, size + size % 2);; n += 2){
+        size_t rest = n;
+        for (size_t p : {2, 3, 5}){
+            while (rest % p == 0){
+                rest /= p;
+            }
+        }
+        if (rest == 1){
+            return n;
+        }
+    }
+}
+
+RealFFT2D::RealFFT2D(size_t rows, size_t cols): _rows(rows), _cols(cols),
+    _row_fft(std::max<size_t>(1, cols / 2)), _col_fft(std::max<size_t>(1, rows)) {
+    if (cols == 0 || cols % 2 != 0 || rows == 0){
+        throw std::runtime_error("RealFFT2D: the number of columns must be even and positive");
+    }
+    _row_twiddles = twiddles(cols, -1.0);
+    _row_twiddles.resize(cols / 2 + 1);
+    _row_twiddles[cols / 2] = -1.0;
+    _scratch[0].resize(std::max(cols / 2, COLUMN_BLOCK * rows));
+    _scratch[1].resize(COLUMN_BLOCK * rows);
+}
+
+void RealFFT2D::_transform_columns(complex_t* spectrum, bool inverse){
+    const size_t width = _cols / 2 + 1;
+    complex_t* columns = _scratch[0].data();
+    complex_t* transformed = _scratch[1].data();
+
+    // a block of the columns is gathered at once, every row is read and written in whole cache lines
+    for (size_t first = 0; first < width; first += COLUMN_BLOCK){
+        const size_t block = std::min(COLUMN_BLOCK, width - first);
+        for (size_t r = 0; r < _rows; r++){
+            for (size_t c = 0; c < block; c++){
+                columns[c * _rows + r] = spectrum[r * width + first + c];
+            }
+        }
+        for (size_t c = 0; c < block; c++){
+            if (inverse){
+                _col_fft.inverse(columns + c * _rows, transformed + c * _rows);
+            } else {
+                _col_fft.forward(columns + c * _rows, transformed + c * _rows);
+            }
+        }
+        for (size_t r = 0; r < _rows; r++){
+            for (size_t c = 0; c < block; c++){
+                spectrum[r * width + first + c] = transformed[c * _rows + r];
+            }
+        }
+    }
+}
+
+void RealFFT2D::forward(const double* image, complex_t* spectrum){
+    const size_t half = _cols / 2, width = half + 1;
+    complex_t* z = _scratch[0].data();
+
+    for (size_t r = 0; r < _rows; r++){
+        // the even and odd samples as the real and imaginary parts, then split the two spectra
+        _row_fft.forward(reinterpret_cast<const complex_t*>(image + r * _cols), z);
+        complex_t* x = spectrum + r * width;
+        for (size_t k = 0; k <= half; k++){
+            complex_t zk = z[k % half], zc = std::conj(z[(half - k) % half]);
+            complex_t even = 0.5 * (zk + zc);
+            complex_t odd = complex_multiply(complex_t(0.0, -0.5), zk - zc);
+            x[k] = even + complex_multiply(_row_twiddles[k], odd);
+        }
+    }
+
+    _transform_columns(spectrum, false);
+}
+
+void RealFFT2D::inverse(complex_t* spectrum, double* image){
+    const size_t half = _cols / 2, width = half + 1;
+
+    _transform_columns(spectrum, true);
+
+    // both inverse transforms are unnormalized
+    const double scale = 0.5 / (_rows * half);
+    complex_t* z = _scratch[0].data();
+    for (size_t r = 0; r < _rows; r++){
+        const complex_t* x = spectrum + r * width;
+        for (size_t k = 0; k < half; k++){
+            complex_t xk = x[k], xc = std::conj(x[half - k]);
+            complex_t even = xk + xc;
+            complex_t odd = complex_multiply(xk - xc, std::conj(_row_twiddles[k]));
+            z[k] = scale * (even + complex_t(-odd.imag(), odd.real()));
+        }
+        _row_fft.inverse(z, reinterpret_cast<complex_t*>(image + r * _cols));
+    }
+}
+
+END_NAMESPACE
@@ -0,0 +1,327 @@
+#include <core/InferencePlan.hpp>
+#include <core/ONeural.hpp>
+#include <core/thread.hpp>
+
+#include <stdexcept>
+#include <string>
+
+START_NAMESPACE_NEURAL_NETWORK
+
+namespace {
+    // Same functions as in `activation.hpp`, computed in place
+    void activate(ActivationType type, float* values, size_t size){
+        switch (type)
+        {
+        case ActivationType::sigmoid:
+            for (size_t i = 0; i < size; i++){
+                values[i] = 1.0f / (1.0f + std::exp(-values[i]));
+            }
+            break;
+        case ActivationType::relu:
+            for (size_t i = 0; i < size; i++){
+                values[i] = std::max(0.0f, values[i]);
+            }
+            break;
+        case ActivationType::softmax:{
+            float max = *std::max_element(values, values + size);
+            float sum = 0.0f;
+            for (size_t i = 0; i < size; i++){
+                values[i] = std::exp(values[i] - max);
+                sum += values[i];
+            }
+            for (size_t i = 0; i < size; i++){
+                values[i] /= sum;
+            }
+            break;
+        }
+        case ActivationType::silu:
+            for (size_t i = 0; i < size; i++){
+                values[i] = values[i] / (1.0f + std::exp(-values[i]));
+            }
+            break;
+        case ActivationType::selu:
+            for (size_t i = 0; i < size; i++){
+                constexpr float alpha = 1.67326f, gamma = 1.0507f;
+                values[i] = values[i] > 0.0f ? gamma * values[i] : gamma * alpha * (std::exp(values[i]) - 1.0f);
+            }
+            break;
+        case ActivationType::prelu:
+            for (size_t i = 0; i < size; i++){
+                values[i] = values[i] < 0.0f ? 10e-2f * values[i] : values[i];
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Outputs accumulated together by `dense_block`, fit in the (SSE) registers
+    constexpr size_t BLOCK = 32;
+
+    // Part of the nonzero inputs from which the tile is computed as the dense GEMM
+    constexpr size_t DENSE_NUMERATOR = 3, DENSE_DENOMINATOR = 5;
+
+    /// y = biases + sum(x[j] * weights[j]), every weight row has `outputs` values, zero inputs are skipped
+    inline void sparse_sum(const float* x, const float* weights, const float* biases, size_t inputs, size_t outputs, float* y){
+        std::copy(biases, biases + outputs, y);
+        for (size_t j = 0; j < inputs; j++){
+            const float xj = x[j];
+            if (xj == 0.0f){
+                continue;
+            }
+            const float* row = weights + j * outputs;
+            for (size_t i = 0; i < outputs; i++){
+                y[i] += xj * row[i];
+            }
+        }
+    }
+
+    /// `sparse_sum` of the `size` <= `BLOCK` outputs, without the memory traffic of the outputs and the branches
+    inline void dense_block(const float* x, const float* weights, const float* biases, size_t inputs, size_t stride, size_t size, float* y){
+        float acc[BLOCK];
+        if (size == BLOCK){
+            std::copy(biases, biases + BLOCK, acc);
+            for (size_t j = 0; j < inputs; j++){
+                const float xj = x[j];
+                const float* row = weights + j * stride;
+                for (size_t i = 0; i < BLOCK; i++){
+                    acc[i] += xj * row[i];
+                }
+            }
+        } else {
+            std::copy(biases, biases + size, acc);
+            for (size_t j = 0; j < inputs; j++){
+                const float xj = x[j];
+                const float* row = weights + j * stride;
+                for (size_t i = 0; i < size; i++){
+                    acc[i] += xj * row[i];
+                }
+            }
+        }
+        std::copy(acc, acc + size, y);
+    }
+}
+
+InferencePlan::InferencePlan(const ONeural& network){
+    std::vector<const OLayer*> layers;
+    for (const auto& layer : network._hidden_layers){
+        layers.push_back(&layer);
+    }
+    layers.push_back(&network._output_layer);
+
+    size_t total = 0, widest = 0;
+    for (const OLayer* layer : layers){
+        _layers.push_back({layer->_inputs_size, layer->_neurons_size, total, layer->_activ_type});
+        total += (layer->_inputs_size + 1) * layer->_neurons_size;
+        widest = std::max({widest, layer->_inputs_size, layer->_neurons_size});
+    }
+
+    auto parameters = std::make_shared<std::vector<float>>(total);
+    for (size_t l = 0; l < layers.size(); l++){
+        const OLayer& layer = *layers[l];
+        float* weights = parameters->data() + _layers[l].offset;
+        float* biases = weights + layer._inputs_size * layer._neurons_size;
+
+        // input-major: the weights of the input j to all of the neurons are contiguous
+        for (size_t i = 0; i < layer._neurons_size; i++){
+            for (size_t j = 0; j < layer._inputs_size; j++){
+                weights[j * layer._neurons_size + i] = static_cast<float>(layer._weights[i * layer._inputs_size + j]);
+            }
+            biases[i] = static_cast<float>(layer._biases[i]);
+        }
+    }
+    _parameters = parameters;
+    _scratch[0].resize(widest);
+    _scratch[1].resize(widest);
+}
+
+InferencePlan::InferencePlan(const InferencePlan& other):
+    _parameters(other._parameters), _layers(other._layers)
+{
+    _scratch[0].resize(other._scratch[0].size());
+    _scratch[1].resize(other._scratch[1].size());
+}
+
+InferencePlan& InferencePlan::operator=(const InferencePlan& other){
+    _parameters = other._parameters;
+    _layers = other._layers;
+    _scratch[0].resize(other._scratch[0].size());
+    _scratch[1].resize(other._scratch[1].size());
+    return *this;
+}
+
+void InferencePlan::predict(const float* inputs, float* out){
+    const float* x = inputs;
+
+    for (size_t l = 0; l < _layers.size(); l++){
+        const _Layer& layer = _layers[l];
+        const float* weights = _parameters->data() + layer.offset;
+        const float* biases = weights + layer.inputs * layer.outputs;
+        float* y = l + 1 == _layers.size() ? out : _scratch[l % 2].data();
+
+        // y = bias + sum(x[j] * weights[j])
+        sparse_sum(x, weights, biases, layer.inputs, layer.outputs, y);
+        activate(layer.activation, y, layer.outputs);
+        x = y;
+    }
+}
+
+size_t InferencePlan::classify(const float* inputs){
+    // the scratch buffer the last layer doesn't read from
+    float* out = _scratch[(_layers.size() + 1) % 2].data();
+    predict(inputs, out);
+    return std::max_element(out, out + outputs()) - out;
+}
+
+void InferencePlan::_predict_tile(const float* inputs, size_t count, float* out, float* scratch) const {
+    const size_t widest = _scratch[0].size();
+    const float* x = inputs;
+
+    for (size_t l = 0; l < _layers.size(); l++){
+        const _Layer& layer = _layers[l];
+        const float* weights = _parameters->data() + layer.offset;
+        const float* biases = weights + layer.inputs * layer.outputs;
+        float* y = l + 1 == _layers.size() ? out : scratch + (l % 2) * TILE * widest;
+
+        const size_t values = count * layer.inputs;
+        const size_t nonzero = values - std::count(x, x + values, 0.0f);
+        if (nonzero * DENSE_DENOMINATOR >= values * DENSE_NUMERATOR){
+            // dense inputs: GEMM, a block of the outputs is accumulated in the registers over all of the inputs
+            for (size_t i = 0; i < layer.outputs; i += BLOCK){
+                for (size_t s = 0; s < count; s++){
+                    dense_block(
+                        x + s * layer.inputs, weights + i, biases + i, layer.inputs, layer.outputs,
+                        std::min(BLOCK, layer.outputs - i), y + s * layer.outputs + i
+                    );
+                }
+            }
+        } else {
+            // sparse inputs (blank pixels, inactive relu): the sum of the weight rows of the nonzero inputs
+            for (size_t s = 0; s < count; s++){
+                sparse_sum(x + s * layer.inputs, weights, biases, layer.inputs, layer.outputs, y + s * layer.outputs);
+            }
+        }
+        for (size_t s = 0; s < count; s++){
+            activate(layer.activation, y + s * layer.outputs, layer.outputs);
+        }
+        x = y;
+    }
+}
+
+template <class Work>
+void InferencePlan::_shard(size_t count, size_t threads, Work work) const {
+    if (threads == 0){
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    const size_t shards = std::min(threads, (count + MIN_SHARD - 1) / MIN_SHARD);
+    if (shards <= 1){
+        work(0, count);
+        return;
+    }
+
+    // whole tiles per shard, the calling thread takes the first one
+    const size_t tiles = (count + TILE - 1) / TILE;
+    const size_t shard = (tiles + shards - 1) / shards * TILE;
+    ThreadPool pool(shards - 1);
+    for (size_t begin = shard; begin < count; begin += shard){
+        const size_t end = std::min(count, begin + shard);
+        pool.enqueue([&work, begin, end](){ work(begin, end); });
+    }
+    work(0, std::min(count, shard));
+    pool.execute();
+}
+
+void InferencePlan::predict(const float* inputs, size_t count, float* out, size_t threads) const {
+    if (empty()){
+        return;
+    }
+    const size_t in = _layers.front().inputs, n = _layers.back().outputs;
+    _shard(count, threads, [&](size_t begin, size_t end){
+        std::vector<float> scratch(2 * TILE * _scratch[0].size());
+        for (size_t s = begin; s < end; s += TILE){
+            _predict_tile(inputs + s * in, std::min(TILE, end - s), out + s * n, scratch.data());
+        }
+    });
+}
+
+void InferencePlan::classify(const float* inputs, size_t count, size_t* labels, size_t threads) const {
+    if (empty()){
+        return;
+    }
+    const size_t in = _layers.front().inputs, n = _layers.back().outputs;
+    _shard(count, threads, [&](size_t begin, size_t end){
+        std::vector<float> scratch(2 * TILE * _scratch[0].size());
+        std::vector<float> out(TILE * n);
+        for (size_t s = begin; s < end; s += TILE){
+            const size_t tile = std::min(TILE, end - s);
+            _predict_tile(inputs + s * in, tile, out.data(), scratch.data());
+            for (size_t t = 0; t < tile; t++){
+                const float* y = out.data() + t * n;
+                labels[s + t] = std::max_element(y, y + n) - y;
+            }
+        }
+    });
+}
+
+real_number_t InferencePlan::accuracy(const data::data_batch& test, size_t threads) const {
+    if (test.empty() || empty()){
+        return 0.0;
+    }
+    const size_t features = inputs();
+
+    std::vector<float> samples(test.size() * features);
+    for (size_t i = 0; i < test.size(); i++){
+        const vector_t& input = test[i].input;
+        if (input.size() != features || test[i].expect.size() != outputs()){
+            throw std::runtime_error(
+                "InferencePlan: the sample " + std::to_string(i) + " doesn't match the plan (" +
+                std::to_string(features) + " inputs, " + std::to_string(outputs()) + " outputs)"
+            );
+        }
+        std::copy(input.begin(), input.begin() + features, samples.begin() + i * features);
+    }
+    std::vector<size_t> labels(test.size());
+    classify(samples.data(), test.size(), labels.data(), threads);
+
+    size_t correct_count = 0;
+    for (size_t i = 0; i < test.size(); i++){
+        correct_count += test[i].expect[labels[i]] == 1;
+    }
+    return static_cast<real_number_t>(correct_count) / static_cast<real_number_t>(test.size());
+}
+
+real_number_t InferencePlan::accuracy(const data::Dataset& test, size_t threads) const {
+    // dequantized in chunks, the dataset may be much larger than the memory
+    constexpr size_t chunk = 1 << 13;
+
+    if (test.empty() || empty()){
+        return 0.0;
+    }
+    if (test.features() != inputs() || test.classes() != outputs()){
+        throw std::runtime_error(
+            "InferencePlan: the dataset (" + std::to_string(test.features()) + " features, " +
+            std::to_string(test.classes()) + " classes) doesn't match the plan (" +
+            std::to_string(inputs()) + " inputs, " + std::to_string(outputs()) + " outputs)"
+        );
+    }
+    const size_t features = test.features();
+    const float scale = static_cast<float>(test.scale()), offset = static_cast<float>(test.offset());
+
+    std::vector<float> samples(std::min(chunk, test.size()) * features);
+    std::vector<size_t> labels(std::min(chunk, test.size()));
+    size_t correct_count = 0;
+    for (size_t begin = 0; begin < test.size(); begin += chunk){
+        const size_t count = std::min(chunk, test.size() - begin);
+        const uint8_t* quantized = test.sample(begin);
+        for (size_t i = 0; i < count * features; i++){
+            samples[i] = quantized[i] * scale + offset;
+        }
+        classify(samples.data(), count, labels.data(), threads);
+        for (size_t i = 0; i < count; i++){
+            correct_count += labels[i] == test.label(begin + i);
+        }
+    }
+    return static_cast<real_number_t>(correct_count) / static_cast<real_number_t>(test.size());
+}
+
+END_NAMESPACE
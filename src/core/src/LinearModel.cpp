@@ -1,5 +1,8 @@
 #include <core/LinearModel.hpp>
 
+#include <stdexcept>
+#include <string>
+
 START_NAMESPACE_NEURAL_NETWORK
 
 
@@ -45,6 +48,33 @@ void LinearModel::batch_learn(data::data_batch* batch, double learning_rate)
   apply(learning_rate, batch->size());
 }
 
+void LinearModel::batch_learn(const data::Table& table, double learning_rate, size_t begin, size_t end)
+{
+  const size_t inputs = _weights.size();
+  if (table.features() != inputs)
+  {
+    throw std::runtime_error(
+      "LinearModel: the table has " + std::to_string(table.features()) + " features, the model " + std::to_string(inputs) + " inputs"
+    );
+  }
+
+  end = std::min(end, table.size());
+  if (begin >= end)
+    return;
+
+  for (size_t i = begin; i < end; i++)
+  {
+    const real_number_t* row = table.sample(i);
+    _output = std::inner_product(row, row + inputs, _weights.begin(), _bias);
+    _partial_derviative = (_output - table.targets[i]) * 2;
+
+    _gradient_bias += _partial_derviative;
+    for (size_t j = 0; j < inputs; j++)
+      _gradient_weights[j] += row[j] * _partial_derviative;
+  }
+  apply(learning_rate, end - begin);
+}
+
 real_number_t LinearModel::cost(real_number_t expected_output)
 {
   auto diff = expected_output - _output;
@@ -1,5 +1,8 @@
 #include <core/MaxPool.hpp>
 
+#include <algorithm>
+#include <stdexcept>
+
 START_NAMESPACE_NEURAL_NETWORK
 
 MaxPoolingLayer::MaxPoolingLayer(int kernel_size, int input_channels, int stride, int padding)
@@ -17,20 +20,105 @@ MaxPoolingLayer& MaxPoolingLayer::build(int kernel_size, int input_channels, int
   return *this;
 }
 
-matrix3d_t MaxPoolingLayer::forward(const matrix3d_t& input)
+MaxPoolingLayer& MaxPoolingLayer::layout(Layout layout)
+{
+  _layout = layout;
+  return *this;
+}
+
+Tensor MaxPoolingLayer::forward(const Tensor& input)
+{
+  if(_layout == Layout::channels_last)
+  {
+    if(input.rank() != 3 || input.dim(2) != size_t(_input_channels) || input.dim(0) != input.dim(1))
+    {
+      throw std::runtime_error("MaxPoolingLayer: the input must be a (input_size, input_size, input_channels) tensor");
+    }
+  }
+  else if(input.rank() != 3 || input.dim(0) != size_t(_input_channels) || input.dim(1) != input.dim(2))
+  {
+    throw std::runtime_error("MaxPoolingLayer: the input must be a (input_channels, input_size, input_size) tensor");
+  }
+
+  const Tensor contiguous = input.contiguous();
+  const int input_size = input.dim(1);
+  Tensor output = _start_forward(input_size);
+  _pool_rows(contiguous.data(), 0, input_size, 0, get_output_size(input_size), output.data(), false);
+  return output;
+}
+
+Tensor MaxPoolingLayer::_start_forward(int input_size)
+{
+  _input_size = input_size;
+  const size_t output_size = get_output_size(input_size), channels = _input_channels;
+  _max_indexes.assign(channels * output_size * output_size, 0);
+  if(_layout == Layout::channels_last)
+  {
+    return Tensor({output_size, output_size, channels});
+  }
+  return Tensor({channels, output_size, output_size});
+}
+
+void MaxPoolingLayer::_pool_rows(
+  const real_number_t* band, int band_begin, int band_end, int row_begin, int row_end, real_number_t* output, bool relu
+)
 {
-  _input_size = input[_input_channels - 1].size();
-  int output_size = get_output_size(_input_size);
-  matrix3d_t output(_input_channels, matrix_t(output_size, vector_t(output_size, 0.0)));
-  _max_indexes = matrix3d_t(output_size, matrix_t(output_size, vector_t(2, 0))); // 2 -> x, y position
+  const int output_size = get_output_size(_input_size);
+  const int band_rows = band_end - band_begin;
+  const real_number_t lowest = -std::numeric_limits<real_number_t>::max();
+
+  if(_layout == Layout::channels_last)
+  {
+    const size_t channels = _input_channels;
+    for(int i = row_begin; i < row_end; ++i)
+    {
+      for(int j = 0; j < output_size; ++j)
+      {
+        real_number_t* o = output + (i * output_size + j) * channels;
+        index_t* indexes = _max_indexes.data() + (i * output_size + j) * channels;
+        std::fill(o, o + channels, lowest);
+        for(int k = 0; k < _kernel_size; ++k)
+        {
+          for(int l = 0; l < _kernel_size; ++l)
+          {
+            int x = i * _stride + k - _padding;
+            int y = j * _stride + l - _padding;
+            if(x < 0 || x >= _input_size || y < 0 || y >= _input_size)
+            {
+              continue;
+            }
+            // all the channels of the pixel at once, branch-free so the loop is vectorized
+            const index_t offset = (x * _input_size + y) * channels;
+            const real_number_t* a = band + ((x - band_begin) * _input_size + y) * channels;
+            for(size_t c = 0; c < channels; ++c)
+            {
+              const bool greater = a[c] > o[c];
+              indexes[c] = greater ? index_t(offset + c) : indexes[c];
+              o[c] = greater ? a[c] : o[c];
+            }
+          }
+        }
+        if(relu)
+        {
+          for(size_t c = 0; c < channels; ++c)
+          {
+            o[c] = std::max(o[c], 0.0);
+          }
+        }
+      }
+    }
+    return;
+  }
 
   for(int channel = 0; channel < _input_channels; ++channel)
   {
-    for(int i = 0; i < output_size; ++i)
+    const real_number_t* plane = band + channel * band_rows * _input_size;
+    for(int i = row_begin; i < row_end; ++i)
     {
       for(int j = 0; j < output_size; ++j)
       {
-        real_number_t max_value = -std::numeric_limits<real_number_t>::max();
+        real_number_t max_value = lowest;
+        index_t max_index = 0;
         for(int k = 0; k < _kernel_size; ++k)
         {
           for(int l = 0; l < _kernel_size; ++l)
@@ -39,45 +127,47 @@ matrix3d_t MaxPoolingLayer::forward(const matrix3d_t& input)
             int y = j * _stride + l - _padding;
             if(x >= 0 && x < _input_size && y >= 0 && y < _input_size)
             {
-              if (input[channel][x][y] > max_value)
+              const real_number_t value = plane[(x - band_begin) * _input_size + y];
+              if (value > max_value)
               {
-                max_value = input[channel][x][y];
-                _max_indexes[i][j][0] = x;
-                _max_indexes[i][j][1] = y;
+                max_value = value;
+                max_index = (channel * _input_size + x) * _input_size + y;
               }
             }
           }
         }
-        output[channel][i][j] = max_value;
+        const size_t position = (channel * output_size + i) * output_size + j;
+        output[position] = relu ? std::max(max_value, 0.0) : max_value;
+        _max_indexes[position] = max_index;
       }
     }
   }
-
-  return output;
 }
 
-matrix3d_t MaxPoolingLayer::backprop(matrix3d_t& partial_dervis)
+Tensor MaxPoolingLayer::backprop(const Tensor& partial_dervis)
 {
-  int output_size = partial_dervis[0].size();
-  matrix3d_t input(_input_channels, matrix_t(_input_size, vector_t(_input_size, 0.0)));
+  if(partial_dervis.size() != _max_indexes.size())
+  {
+    throw std::runtime_error("MaxPoolingLayer: the partial derivatives must match the output of the layer");
+  }
+  const Tensor partial = partial_dervis.contiguous();
+  Tensor input = _layout == Layout::channels_last ?
+    Tensor({size_t(_input_size), size_t(_input_size), size_t(_input_channels)}) :
+    Tensor({size_t(_input_channels), size_t(_input_size), size_t(_input_size)});
 
-  for(int channel = 0; channel < _input_channels; ++channel)
+  // the indexes follow the order of the outputs in both layouts,
+  // overlapping windows may share the max value, so the derivatives are summed
+  real_number_t* in = input.data();
+  for(size_t i = 0; i < _max_indexes.size(); ++i)
   {
-    for(int i = 0; i < output_size; ++i)
-    {
-      for(int j = 0; j < output_size; ++j)
-      {
-        input[channel][_max_indexes[i][j][0]][_max_indexes[i][j][1]] = partial_dervis[channel][i][j];
-      }
-    }
+    in[_max_indexes[i]] += partial.data()[i];
   }
-  
   return input;
 }
 
-const matrix3d_t& MaxPoolingLayer::get_max_indexes()
+const std::vector<MaxPoolingLayer::index_t>& MaxPoolingLayer::get_max_indexes()
 {
   return _max_indexes;
 }
 
-END_NAMESPACE
\ No newline at end of file
+END_NAMESPACE
@@ -81,6 +81,7 @@ OLayer& OLayer::initialize(){
 }
 
 void OLayer::training_mode(bool mode){
+    _training = mode;
     if (mode){
         _calc_outputs_function = _calc_outputs_training;
     } else {
@@ -170,6 +171,55 @@ vector_t& OLayer::calc_activations(_FeedData& feed_data){
     return _calc_outputs_function(this, feed_data);
 }
 
+vector_t& OLayer::calc_activations(
+    _FeedData& feed_data, const uint8_t* inputs,
+    real_number_t scale, real_number_t offset
+){
+    // weighted_input = sum(weight * (q * scale + offset)) + bias
+    //                = scale * sum(weight * q) + offset * sum(weight) + bias
+    // the inputs are widened while loading, 1 byte per input is read instead of 8
+    std::mt19937 gen;
+    std::bernoulli_distribution dist(1.0 - _dropout_rate);
+    if (_training){
+        gen.seed(std::random_device()());
+    }
+
+    for (size_t i = 0; i < _neurons_size; i++){
+        const real_number_t* weights = &_weights[i * _inputs_size];
+
+        // independent accumulators, so the additions don't wait for each other
+        real_number_t dot[4] = {0.0, 0.0, 0.0, 0.0};
+        size_t j = 0;
+        for (; j + 4 <= _inputs_size; j += 4){
+            dot[0] += weights[j] * inputs[j];
+            dot[1] += weights[j + 1] * inputs[j + 1];
+            dot[2] += weights[j + 2] * inputs[j + 2];
+            dot[3] += weights[j + 3] * inputs[j + 3];
+        }
+        for (; j < _inputs_size; j++){
+            dot[0] += weights[j] * inputs[j];
+        }
+
+        real_number_t weighted = scale * ((dot[0] + dot[1]) + (dot[2] + dot[3]));
+        if (offset != 0.0){
+            real_number_t sum = 0.0;
+            for (j = 0; j < _inputs_size; j++){
+                sum += weights[j];
+            }
+            weighted += offset * sum;
+        }
+
+        // same as `_calc_outputs_training`, the mask is applied to the bias (and the gradient)
+        if (_training){
+            feed_data._dropout_mask[i] = dist(gen);
+        }
+        feed_data._weighted_inputs[i] = weighted + _biases[i] * feed_data._dropout_mask[i];
+    }
+
+    feed_data._activations = _activation_function(feed_data._weighted_inputs);
+    return feed_data._activations;
+}
+
 OLayer* OLayer::calc_hidden_gradient(OLayer* prev_layer, _FeedData& feed_data, vector_t& _prev_partial_derivatives){
     // Outputs should be already calculated: `feed_data._activations`
     // The `prev_layer` is the next layer in the network,
@@ -260,7 +310,7 @@ OLayer* OLayer::calc_hidden_gradient(OLayer* prev_layer, _FeedData& feed_data, v
 }
 
 
-OLayer* OLayer::calc_output_gradient(vector_t&& expected, _FeedData& feed_data){
+OLayer* OLayer::calc_output_gradient(const vector_t& expected, _FeedData& feed_data){
     // Outputs should be already calculated: `feed_data._activations`
 
     double error_deriv;
@@ -309,6 +359,25 @@ void OLayer::update_gradients(_FeedData& feed_data){
     }
 }
 
+void OLayer::update_gradients(
+    _FeedData& feed_data, const uint8_t* inputs,
+    real_number_t scale, real_number_t offset
+){
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (size_t i = 0; i < _neurons_size; i++){
+        // gradient_weight += partial_derivative * (q * scale + offset)
+        real_number_t partial_derivative = feed_data._partial_derivatives[i];
+        real_number_t a = partial_derivative * scale, b = partial_derivative * offset;
+        real_number_t* gradients = &_gradient_weights[i * _inputs_size];
+
+        for (size_t j = 0; j < _inputs_size; j++){
+            gradients[j] += a * inputs[j] + b;
+        }
+        _gradient_biases[i] += partial_derivative;
+    }
+}
+
 void OLayer::apply_gradients(double learn_rate, size_t batch_size) {
     /*
     
@@ -366,7 +435,7 @@ void OLayer::apply_gradients(double learn_rate, size_t batch_size) {
     }
 }
 
-real_number_t OLayer::cost(vector_t&& expected, _FeedData& feed_data) {
+real_number_t OLayer::cost(const vector_t& expected, _FeedData& feed_data) {
     real_number_t cost = 0.0;
 
     for (size_t i = 0; i < _neurons_size; ++i) {
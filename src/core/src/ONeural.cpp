@@ -67,30 +67,64 @@ void ONeural::training_mode(bool mode){
     }
 }
 
-void ONeural::_update_gradients(data::Data&& data, ONeural* context){
+real_number_t ONeural::_update_gradients(const data::Data& data, ONeural* context, real_number_t weight){
     // This function is made to be thread-safe, it's a static method, because
     // I'm using it in `std::thread` to achieve parallelism
 
     _NetworkFeedData feed_data(context->_output_layer, context->_hidden_layers);
     context->feed_forward(feed_data, data.input);
+    return _backward(feed_data, data.expect, context, nullptr, 1.0, 0.0, weight);
+}
+
+real_number_t ONeural::_update_gradients(const data::Dataset& data, size_t index, ONeural* context, real_number_t weight){
+    _NetworkFeedData feed_data(context->_output_layer, context->_hidden_layers);
+    context->feed_forward(feed_data, data, index);
+
+    vector_t expect(data.classes());
+    data.expect(index, expect.data());
+    return _backward(feed_data, expect, context, data.sample(index), data.scale(), data.offset(), weight);
+}
+
+real_number_t ONeural::_backward(
+    _NetworkFeedData& feed_data, const vector_t& expect, ONeural* context,
+    const uint8_t* quantized, real_number_t scale, real_number_t offset,
+    real_number_t weight
+){
+    // the first layer reads the quantized inputs, if there are any
+    auto update = [&](OLayer& layer, _FeedData& feed, bool first){
+        if (first && quantized != nullptr){
+            layer.update_gradients(feed, quantized, scale, offset);
+        } else {
+            layer.update_gradients(feed);
+        }
+    };
 
     _FeedData *prev_layer_feed = &feed_data._layer_feed_data.back();
 
     OLayer* prev_layer = context->_output_layer.calc_output_gradient(
-        std::forward<vector_t>(data.expect),
+        expect,
         *prev_layer_feed
     );
 
-    context->_output_layer.update_gradients(*prev_layer_feed);
+    // the backpropagation is linear in the output partial derivatives,
+    // so scaling them scales the gradients of all the layers
+    if (weight != 1.0){
+        for (auto& partial_derivative : prev_layer_feed->_partial_derivatives){
+            partial_derivative *= weight;
+        }
+    }
+
+    update(context->_output_layer, *prev_layer_feed, context->_hidden_layers.empty());
     
+    real_number_t cost = context->_output_layer.cost(
+        expect,
+        *prev_layer_feed
+    );
     {
         // Lock the `_cost` and `_loss` when modifying them
         std::lock_guard<std::mutex> lock(context->_mutex);
-        context->_cost = context->_output_layer.cost(
-            std::forward<vector_t>(data.expect),
-            *prev_layer_feed
-        );
-        context->_loss += context->_cost;
+        context->_cost = cost;
+        context->_loss += weight * cost;
     }
 
 
@@ -103,9 +137,10 @@ void ONeural::_update_gradients(data::Data&& data, ONeural* context){
         _hidden_layer = &context->_hidden_layers[i];
 
         prev_layer = _hidden_layer->calc_hidden_gradient(prev_layer, *_hidden_feed, prev_layer_feed->_partial_derivatives);
-        _hidden_layer->update_gradients(*_hidden_feed);
+        update(*_hidden_layer, *_hidden_feed, i == 0);
         prev_layer_feed = _hidden_feed;
     }
+    return cost;
 }
 
 void ONeural::backprop(_NetworkFeedData& feed, vector_t& targets){
@@ -144,44 +179,102 @@ void ONeural::learn(data::Data& data, double learn_rate){
     apply(learn_rate, 1);
 }
 
-void ONeural::_learn_multithread(data_batch* mini_batch, double learn_rate){
+void ONeural::_learn_multithread(
+    const data_batch* mini_batch, size_t begin, size_t end,
+    const real_number_t* weights, real_number_t* losses
+){
     ThreadPool pool(std::thread::hardware_concurrency());
 
-    for (size_t i = 0; i < mini_batch->size(); i++){
+    for (size_t i = begin; i < end; i++){
         pool.enqueue(
-            [this, mini_batch, i, learn_rate](){
-                _update_gradients(
-                    std::forward<data::Data>(mini_batch->at(i)), 
-                    this
-                );
+            [this, mini_batch, i, begin, weights, losses](){
+                // `_update_gradients` only reads the data point, so it's safe to share it
+                real_number_t cost = _update_gradients(mini_batch->at(i), this, weights ? weights[i - begin] : 1.0);
+                if (losses != nullptr){
+                    losses[i - begin] = cost;
+                }
             }
         );
     }
 }
 
-void ONeural::learn(data_batch* training_data, double learn_rate){
+void ONeural::_learn_multithread(
+    const data::Dataset* mini_batch, size_t begin, size_t end,
+    const real_number_t* weights, real_number_t* losses
+){
+    ThreadPool pool(std::thread::hardware_concurrency());
+
+    for (size_t i = begin; i < end; i++){
+        pool.enqueue(
+            [this, mini_batch, i, begin, weights, losses](){
+                real_number_t cost = _update_gradients(*mini_batch, i, this, weights ? weights[i - begin] : 1.0);
+                if (losses != nullptr){
+                    losses[i - begin] = cost;
+                }
+            }
+        );
+    }
+}
+
+void ONeural::learn(const data_batch* training_data, double learn_rate){
     // // traning_data should be a copy of the original data, thread safe
     // for (auto& data : *training_data){
     //     _update_gradients(std::forward<data::Data>(data), this);
     // }
     // apply(learn_rate, training_data->size());
 
-    _learn_multithread(training_data, learn_rate);
+    _learn_multithread(training_data, 0, training_data->size());
     apply(learn_rate, training_data->size());
 }
 
-void ONeural::batch_learn(data_batch* whole_data, double learn_rate, size_t batch_size){
+void ONeural::batch_learn(const data_batch* whole_data, double learn_rate, size_t batch_size){
     // divide the data into batch sized chunk
     // end_itr is the end of the batch, prevents from going out of range
+    size_t begin_itr = _iterator * batch_size;
+    size_t end_itr = std::min((_iterator + 1) * batch_size, whole_data->size());
+
+    // learn directly from the `whole_data`, without copying the batch
+    _loss = 0;
+    _learn_multithread(whole_data, begin_itr, end_itr);
+    apply(learn_rate, end_itr - begin_itr);
+    
+    _iterator = (end_itr != whole_data->size()) ? _iterator + 1 : 0;
+}
+
+void ONeural::learn(const data::Dataset* training_data, double learn_rate){
+    _learn_multithread(training_data, 0, training_data->size());
+    apply(learn_rate, training_data->size());
+}
+
+void ONeural::batch_learn(const data::Dataset* whole_data, double learn_rate, size_t batch_size){
+    size_t begin_itr = _iterator * batch_size;
     size_t end_itr = std::min((_iterator + 1) * batch_size, whole_data->size());
 
     _loss = 0;
-    data_batch batch(whole_data->begin() + _iterator * batch_size, whole_data->begin() + end_itr);
-    learn(&batch, learn_rate);
+    _learn_multithread(whole_data, begin_itr, end_itr);
+    apply(learn_rate, end_itr - begin_itr);
     
     _iterator = (end_itr != whole_data->size()) ? _iterator + 1 : 0;
 }
 
+void ONeural::learn(
+    const data_batch* training_data, const real_number_t* weights,
+    real_number_t* losses, double learn_rate
+){
+    _loss = 0;
+    _learn_multithread(training_data, 0, training_data->size(), weights, losses);
+    apply(learn_rate, training_data->size());
+}
+
+void ONeural::learn(
+    const data::Dataset* training_data, const real_number_t* weights,
+    real_number_t* losses, double learn_rate
+){
+    _loss = 0;
+    _learn_multithread(training_data, 0, training_data->size(), weights, losses);
+    apply(learn_rate, training_data->size());
+}
+
 void ONeural::apply(double learn_rate, size_t batch_size){
     for(auto& layer : _hidden_layers){
         layer.apply_gradients(learn_rate, batch_size);
@@ -189,7 +282,7 @@ void ONeural::apply(double learn_rate, size_t batch_size){
     _output_layer.apply_gradients(learn_rate, batch_size);
 }
 
-void ONeural::feed_forward(_NetworkFeedData& feed_data, vector_t& inputs){
+void ONeural::feed_forward(_NetworkFeedData& feed_data, const vector_t& inputs){
     (void)feed_data.setInputs(inputs);
 
     for (size_t i = 0; i < _hidden_layers.size(); i++){
@@ -198,6 +291,23 @@ void ONeural::feed_forward(_NetworkFeedData& feed_data, vector_t& inputs){
     _output_layer.calc_activations(feed_data._layer_feed_data.back());
 }
 
+void ONeural::feed_forward(_NetworkFeedData& feed_data, const data::Dataset& data, size_t index){
+    const uint8_t* inputs = data.sample(index);
+
+    if (_hidden_layers.empty()){
+        _output_layer.calc_activations(feed_data._layer_feed_data.back(), inputs, data.scale(), data.offset());
+        return;
+    }
+
+    feed_data._layer_feed_data[1]._inputs = _hidden_layers[0].calc_activations(
+        feed_data._layer_feed_data[0], inputs, data.scale(), data.offset()
+    );
+    for (size_t i = 1; i < _hidden_layers.size(); i++){
+        feed_data._layer_feed_data[i+1]._inputs = _hidden_layers[i].calc_activations(feed_data._layer_feed_data[i]);
+    }
+    _output_layer.calc_activations(feed_data._layer_feed_data.back());
+}
+
 vector_t ONeural::outputs(){
     _NetworkFeedData feed_data(_output_layer, _hidden_layers);
     feed_forward(feed_data, _input.input);
@@ -222,79 +332,46 @@ real_number_t ONeural::cost(){
 }
 
 size_t ONeural::_classify_feed(_NetworkFeedData& feed_data){
-    auto outputLayer = feed_data._layer_feed_data.back();
+    auto& outputLayer = feed_data._layer_feed_data.back();
     auto maxElementIterator = std::max_element(
         outputLayer._activations.begin(), outputLayer._activations.end()
     );
     return std::distance(outputLayer._activations.begin(), maxElementIterator);
 }
 
-bool ONeural::_correct_feed(_NetworkFeedData& feed_data, vector_t& expected){
+bool ONeural::_correct_feed(_NetworkFeedData& feed_data, const vector_t& expected){
     return expected[_classify_feed(feed_data)] == 1;
 }
 
 size_t ONeural::classify(){
+    // single forward pass, without copying the outputs into another feed
     _NetworkFeedData feed(_output_layer, _hidden_layers);
-    feed._layer_feed_data.back()._activations = outputs();
+    feed_forward(feed, _input.input);
+    _outputs = feed._layer_feed_data.back()._activations;
     return _classify_feed(feed);
 }
 
 bool ONeural::correct(){
     _NetworkFeedData feed(_output_layer, _hidden_layers);
-    feed._layer_feed_data.back()._activations = outputs();
+    feed_forward(feed, _input.input);
+    _outputs = feed._layer_feed_data.back()._activations;
     return _correct_feed(feed, _input.expect);
 }
 
+InferencePlan ONeural::freeze() const {
+    return InferencePlan(*this);
+}
+
 const std::vector<size_t>& ONeural::structure(){
     return _structure;
 }
 
-size_t ONeural::_accuracy_multithread(data_batch* mini_test){
-    ThreadPool pool(std::thread::hardware_concurrency());
-
-    std::mutex mutex;
-    size_t correct_count = 0;
-    for (size_t i = 0; i < mini_test->size(); i++){
-        pool.enqueue(
-            [this, mini_test, i, &correct_count, &mutex](){
-                _NetworkFeedData feed(_output_layer, _hidden_layers);
-                feed_forward(feed, mini_test->at(i).input);
-                if (_correct_feed(feed, mini_test->at(i).expect)){
-                    std::lock_guard<std::mutex> lock(mutex);
-                    correct_count++;
-                }
-            }
-        );
-    }
-    pool.execute();
-
-    return correct_count;
+real_number_t ONeural::accuracy(const data_batch* test){
+    return freeze().accuracy(*test);
 }
 
-real_number_t ONeural::accuracy(data_batch* test){
-    constexpr size_t batch_size = 32;
-    
-    size_t correct_count = 0, begin_itr = 0, end_itr = 0,
-            mini_batch_count = test->size() / batch_size,
-            remainder = test->size() % batch_size;
-    
-    // divide the data into batch sized chunk
-    for (size_t i = 0; i < mini_batch_count; i++){
-        begin_itr = i * batch_size;
-        end_itr = begin_itr + batch_size;
-        // This is correct, because in the end, the `_accuracy_multithread(...)` function
-        // waits for all the threads to finish, so it's safe to store this data in the stack
-        data_batch mini_batch(test->begin() + begin_itr, test->begin() + end_itr);
-        correct_count += _accuracy_multithread(&mini_batch);
-    }
-
-    // Handle the remainder
-    if (remainder != 0){
-        data_batch mini_batch(test->begin() + end_itr, test->end());
-        correct_count += _accuracy_multithread(&mini_batch);
-    }
-
-    return static_cast<real_number_t>(correct_count) / static_cast<real_number_t>(test->size());
+real_number_t ONeural::accuracy(const data::Dataset* test){
+    return freeze().accuracy(*test);
 }
 
 void ONeural::activations(
@@ -0,0 +1,101 @@
+#include <core/PublishedModel.hpp>
+#include <core/ONeural.hpp>
+
+#include <stdexcept>
+
+START_NAMESPACE_NEURAL_NETWORK
+
+PublishedModel::PublishedModel(): _current(nullptr), _version(0){
+    for (size_t i = 0; i < MAX_READERS; i++){
+        _hazards[i].store(nullptr);
+        _slots[i].store(false);
+    }
+}
+
+PublishedModel::~PublishedModel(){
+    delete _current.load();
+    for (const _Snapshot* snapshot : _retired){
+        delete snapshot;
+    }
+}
+
+uint64_t PublishedModel::publish(const ONeural& network){
+    return publish(network.freeze());
+}
+
+uint64_t PublishedModel::publish(InferencePlan plan){
+    std::lock_guard<std::mutex> lock(_publish_mutex);
+
+    uint64_t version = _version.load(std::memory_order_relaxed) + 1;
+    const _Snapshot* previous = _current.exchange(new _Snapshot{std::move(plan), version});
+    _version.store(version, std::memory_order_release);
+
+    if (previous != nullptr){
+        _retired.push_back(previous);
+    }
+    _reclaim();
+    return version;
+}
+
+void PublishedModel::_reclaim(){
+    auto copied = [this](const _Snapshot* snapshot){
+        for (const auto& hazard : _hazards){
+            if (hazard.load() == snapshot){
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // the snapshots that are still being copied stay retired until the next publish
+    size_t kept = 0;
+    for (const _Snapshot* snapshot : _retired){
+        if (copied(snapshot)){
+            _retired[kept++] = snapshot;
+        } else {
+            delete snapshot;
+        }
+    }
+    _retired.resize(kept);
+}
+
+PublishedModel::Reader::Reader(PublishedModel& model): _model(&model), _slot(MAX_READERS), _version(0){
+    for (size_t i = 0; i < MAX_READERS; i++){
+        bool expected = false;
+        if (model._slots[i].compare_exchange_strong(expected, true)){
+            _slot = i;
+            break;
+        }
+    }
+    if (_slot == MAX_READERS){
+        throw std::runtime_error("PublishedModel: too many readers");
+    }
+}
+
+PublishedModel::Reader::~Reader(){
+    _model->_hazards[_slot].store(nullptr);
+    _model->_slots[_slot].store(false, std::memory_order_release);
+}
+
+InferencePlan& PublishedModel::Reader::plan(){
+    if (_model->_version.load(std::memory_order_acquire) == _version){
+        return _plan;
+    }
+
+    // hazard pointer: the snapshot can't be deleted once it's marked, and it's still the current one
+    auto& hazard = _model->_hazards[_slot];
+    const _Snapshot* snapshot;
+    do {
+        snapshot = _model->_current.load();
+        hazard.store(snapshot);
+    } while (snapshot != _model->_current.load());
+
+    if (snapshot != nullptr){
+        _plan = snapshot->plan;
+        _version = snapshot->version;
+    }
+    hazard.store(nullptr, std::memory_order_release);
+    return _plan;
+}
+
+END_NAMESPACE
@@ -0,0 +1,167 @@
+#include <core/Tensor.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+START_NAMESPACE_NEURAL_NETWORK
+
+namespace {
+    size_t count(const Tensor::shape_t& shape){
+        size_t size = 1;
+        for (size_t dim : shape){
+            size *= dim;
+        }
+        return size;
+    }
+}
+
+Tensor::Tensor(shape_t shape, real_number_t value):
+    _storage(std::make_shared<vector_t>(count(shape), value)), _shape(std::move(shape)) {
+    _strides = _contiguous_strides(_shape);
+}
+
+Tensor::Tensor(shape_t shape, const vector_t& values):
+    _storage(std::make_shared<vector_t>(values)), _shape(std::move(shape)) {
+    if (values.size() != count(_shape)){
+        throw std::runtime_error("Tensor: the number of the values doesn't match the shape");
+    }
+    _strides = _contiguous_strides(_shape);
+}
+
+Tensor::shape_t Tensor::_contiguous_strides(const shape_t& shape){
+    shape_t strides(shape.size());
+    size_t stride = 1;
+    for (size_t axis = shape.size(); axis-- > 0;){
+        strides[axis] = stride;
+        stride *= shape[axis];
+    }
+    return strides;
+}
+
+bool Tensor::is_contiguous() const {
+    return _strides == _contiguous_strides(_shape);
+}
+
+Tensor Tensor::operator[](size_t index) const {
+    if (_shape.empty() || index >= _shape[0]){
+        throw std::runtime_error("Tensor: index out of range");
+    }
+    Tensor view(*this);
+    view._offset += index * _strides[0];
+    view._shape.erase(view._shape.begin());
+    view._strides.erase(view._strides.begin());
+    return view;
+}
+
+Tensor Tensor::slice(size_t axis, size_t begin, size_t end) const {
+    if (axis >= _shape.size() || begin > end || end > _shape[axis]){
+        throw std::runtime_error("Tensor: slice out of range");
+    }
+    Tensor view(*this);
+    view._offset += begin * _strides[axis];
+    view._shape[axis] = end - begin;
+    return view;
+}
+
+Tensor Tensor::reshape(shape_t shape) const {
+    if (count(shape) != size()){
+        throw std::runtime_error("Tensor: reshape changes the number of the values");
+    }
+    Tensor view = contiguous();
+    view._shape = std::move(shape);
+    view._strides = _contiguous_strides(view._shape);
+    return view;
+}
+
+Tensor Tensor::permute(const shape_t& axes) const {
+    std::vector<bool> seen(_shape.size(), false);
+    if (axes.size() != _shape.size()){
+        throw std::runtime_error("Tensor: permute needs every axis once");
+    }
+    Tensor view(*this);
+    for (size_t i = 0; i < axes.size(); i++){
+        if (axes[i] >= _shape.size() || seen[axes[i]]){
+            throw std::runtime_error("Tensor: permute needs every axis once");
+        }
+        seen[axes[i]] = true;
+        view._shape[i] = _shape[axes[i]];
+        view._strides[i] = _strides[axes[i]];
+    }
+    return view;
+}
+
+template <class Function>
+void Tensor::_for_each_offset(Function function) const {
+    if (empty()){
+        return;
+    }
+    if (_shape.empty()){
+        function(_offset);
+        return;
+    }
+    // walks the values in the row-major order, the last axis is the innermost loop
+    shape_t index(_shape.size(), 0);
+    const size_t last = _shape.size() - 1, inner = _shape[last], stride = _strides[last];
+    for (size_t n = size(); n > 0; n -= inner){
+        size_t offset = _offset;
+        for (size_t axis = 0; axis < last; axis++){
+            offset += index[axis] * _strides[axis];
+        }
+        for (size_t i = 0; i < inner; i++){
+            function(offset + i * stride);
+        }
+        for (size_t axis = last; axis-- > 0;){
+            if (++index[axis] < _shape[axis]){
+                break;
+            }
+            index[axis] = 0;
+        }
+    }
+}
+
+Tensor Tensor::clone() const {
+    Tensor copy(_shape);
+    if (empty()){
+        return copy;
+    }
+    if (is_contiguous()){
+        std::copy(data(), data() + size(), copy.data());
+    } else {
+        real_number_t* out = copy.data();
+        _for_each_offset([&](size_t offset){ *out++ = (*_storage)[offset]; });
+    }
+    return copy;
+}
+
+Tensor Tensor::contiguous() const {
+    return is_contiguous() ? *this : clone();
+}
+
+void Tensor::fill(real_number_t value){
+    if (empty()){
+        return;
+    }
+    if (is_contiguous()){
+        std::fill(data(), data() + size(), value);
+    } else {
+        _for_each_offset([&](size_t offset){ (*_storage)[offset] = value; });
+    }
+}
+
+vector_t Tensor::to_vector() const {
+    if (empty()){
+        return {};
+    }
+    Tensor values = contiguous();
+    return vector_t(values.data(), values.data() + values.size());
+}
+
+Tensor to_channels_last(const Tensor& image){
+    return image.permute({1, 2, 0}).clone();
+}
+
+Tensor to_channels_first(const Tensor& image){
+    return image.permute({2, 0, 1}).clone();
+}
+
+END_NAMESPACE
@@ -64,8 +64,9 @@ namespace selu{
             auto x = args[i];
             if (x > 0){
                 result[i] = gamma * x;
+            } else {
+                result[i] = gamma * alpha * (exp(x) - 1);
             }
-            result[i] = gamma * alpha * (exp(x) - 1);
         }
         return result;
     }
@@ -78,8 +79,9 @@ namespace selu{
             auto x = args[i];
             if (x > 0){
                 result[i] = gamma;
+            } else {
+                result[i] = gamma * alpha * exp(x);
             }
-            result[i] = gamma * alpha * exp(x);
         }
         return result;
     }
@@ -96,8 +98,9 @@ namespace prelu
             auto x = args[i];
             if (x < 0){
                 result[i] = aplha*x;
+            } else {
+                result[i] = x;
             }
-            result[i] = x;
         }
         return result;
     }
@@ -108,8 +111,9 @@ namespace prelu
             auto x = activations[i];
             if (x < 0){
                 result[i] = aplha;
+            } else {
+                result[i] = 1;
             }
-            result[i] = 1;
         }
         return result;
     }
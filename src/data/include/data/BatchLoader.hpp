@@ -0,0 +1,185 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <chrono>
+
+#include "Data.hpp"
+#include "Permutation.hpp"
+#include "Dataset.hpp"
+#include "Sampler.hpp"
+
+START_NAMESPACE_DATA
+
+/**
+ * @brief Background mini-batch loader.
+ *
+ * Assembles the next `prefetch` mini batches on `workers` separate threads, while the network learns
+ * the current one. The order of the samples is given by the `Sampler` (shuffled by default), each batch is gathered into one of the
+ * preallocated staging buffers and passed through the optional `stage` callback
+ * (normalization, augmentation, ...). The buffers are reused for the whole training, the
+ * source data is never modified. Batches are handed out in order, regardless of which worker
+ * prepared them.
+ *
+ * The source is either a `data_batch` (batches are returned by `next()`) or a quantized `Dataset`
+ * (batches stay quantized, they are returned by `next_quantized()`).
+ *
+ * Usage:
+ *      loader.start(seed);
+ *      while(auto batch = loader.next()){
+ *          network.learn(batch, ...);
+ *      }
+*/
+class BatchLoader{
+    public:
+    /**
+     * @brief Called by the loader thread on every gathered batch, may modify it
+     * @param batch the mini batch
+     * @param indexes `source` indexes of the samples in the batch
+     * @param seed seed of the epoch, use `sample_seed(seed, indexes[i])` to get deterministic randomness
+    */
+    typedef std::function<void(data_batch& batch, const std::vector<size_t>& indexes, uint64_t seed)> stage_t;
+
+    /// @brief `stage_t` of the quantized batches
+    typedef std::function<void(QuantizedBatch& batch, const std::vector<size_t>& indexes, uint64_t seed)> quantized_stage_t;
+
+    BatchLoader();
+
+    /// @brief Calls `prepare(...)` internally
+    BatchLoader(const data_batch* source, size_t batch_size, size_t prefetch = 2, size_t workers = 1);
+    ~BatchLoader();
+
+    BatchLoader(const BatchLoader&) = delete;
+    BatchLoader& operator=(const BatchLoader&) = delete;
+
+    /**
+     * @brief Sets up the loader, stops the running epoch and resets the sampler (shuffled) and
+     * `drop_last` (true) to the defaults
+     * @param source the dataset, must outlive the loader (or the next `prepare` call)
+     * @param batch_size size of the mini batch, see `drop_last`
+     * @param prefetch number of staging buffers, (prefetch - 1) batches may be ready ahead of the consumer
+     * @param workers number of loader threads, each prepares whole batches
+     * @return *this
+    */
+    BatchLoader& prepare(const data_batch* source, size_t batch_size, size_t prefetch = 2, size_t workers = 1);
+
+    /// @brief Sets up the loader on a quantized dataset, see `prepare` above
+    BatchLoader& prepare(const Dataset* source, size_t batch_size, size_t prefetch = 2, size_t workers = 1);
+
+    /// @brief Sets the stage callback, run on every batch before it's handed to the consumer,
+    /// must be thread safe if there is more than 1 worker
+    BatchLoader& stage(stage_t stage);
+
+    /// @brief Sets the stage callback of the quantized batches
+    BatchLoader& stage_quantized(quantized_stage_t stage);
+
+    /**
+     * @brief Sets the order of the samples, call it after `prepare`
+     * @param sampler sampler over the source, must outlive the loader, nullptr -> shuffled order
+     * @return *this
+    */
+    BatchLoader& sampler(Sampler* sampler);
+
+    /// @brief Whether the last, incomplete batch should be skipped (default: true)
+    BatchLoader& drop_last(bool drop = true);
+
+    /**
+     * @brief Starts new epoch, with new order of the samples
+     * @param seed seed of the sampler
+    */
+    void start(uint64_t seed);
+
+    /**
+     * @brief Waits for the next ready batch, the previously returned batch is released (don't use it anymore)
+     * @return pointer to the batch or nullptr if the epoch is over
+    */
+    const data_batch* next();
+
+    /**
+     * @brief `next()` of the loader prepared on a `Dataset`
+     * @return view of the quantized batch or nullptr if the epoch is over
+    */
+    const Dataset* next_quantized();
+
+    /**
+     * @brief Source indexes of the samples in the batch returned by the last `next()` (or `next_quantized()`),
+     * valid until the next call
+    */
+    const std::vector<size_t>& indexes() const;
+
+    /// @brief Stops the loader threads, discards the prefetched batches
+    void stop();
+
+    /// @brief Number of batches in one epoch
+    inline size_t batches() const {
+        return _total;
+    }
+
+    /// @brief How many times `next()` had to wait for the loader, since last `start(...)`
+    inline size_t stalls() const {
+        return _stalls;
+    }
+
+    /// @brief Total time spent waiting in `next()` since last `start(...)`, in milliseconds
+    inline double stall_time() const {
+        return std::chrono::duration<double, std::milli>(_stall_time).count();
+    }
+
+    private:
+    struct _Slot{
+        data_batch batch;
+        QuantizedBatch quantized;
+        Dataset view;
+        std::vector<size_t> indexes;
+        size_t number = 0;
+        bool ready = false;
+    };
+
+    void _produce();
+
+    void _count_batches();
+
+    // Waits for the next batch, nullptr if the epoch is over
+    _Slot* _next_slot();
+
+    inline size_t _source_size() const {
+        return _source != nullptr ? _source->size() : (_dataset != nullptr ? _dataset->size() : 0);
+    }
+
+    inline Sampler& _order() {
+        return _sampler != nullptr ? *_sampler : _shuffled;
+    }
+
+    const data_batch* _source;
+    const Dataset* _dataset;
+    size_t _batch_size;
+    size_t _workers_count;
+    bool _drop_last;
+    uint64_t _seed;
+    stage_t _stage;
+    quantized_stage_t _quantized_stage;
+    Sampler* _sampler;
+    ShuffledSampler _shuffled;
+    std::vector<_Slot> _slots;
+    _Slot* _current;
+
+    // Batch counters: claimed by the producer, handed to the consumer, released by the consumer
+    size_t _total;
+    size_t _claimed;
+    size_t _consumed;
+    size_t _released;
+    bool _stop;
+
+    size_t _stalls;
+    std::chrono::nanoseconds _stall_time;
+
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _produced;
+    std::condition_variable _freed;
+};
+
+END_NAMESPACE
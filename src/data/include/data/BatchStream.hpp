@@ -0,0 +1,59 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "Dataset.hpp"
+
+START_NAMESPACE_DATA
+
+/**
+ * @brief Source of quantized mini batches, which doesn't have to hold the whole dataset in memory
+ * (ex. `ShardStream`). Every epoch visits all the samples once, in a random order.
+ *
+ * Usage:
+ *      stream.start(seed, batch_size, stage);
+ *      while(auto batch = stream.next()){
+ *          network.batch_learn(batch, ...);
+ *      }
+ *      stream.stop();
+*/
+class BatchStream{
+    public:
+    /**
+     * @brief Called on every assembled batch, may modify it
+     * @param indexes dataset indexes of the samples in the batch
+     * @param seed seed of the epoch, see `sample_seed`
+    */
+    typedef std::function<void(QuantizedBatch& batch, const std::vector<size_t>& indexes, uint64_t seed)> stage_t;
+
+    virtual ~BatchStream() = default;
+
+    /// @brief Number of samples in one epoch
+    virtual size_t size() const = 0;
+
+    /**
+     * @brief Starts new epoch
+     * @param seed seed of the shuffle
+     * @param batch_size size of the mini batch, the last incomplete batch is skipped
+     * @param stage optional callback, run on every batch
+    */
+    virtual void start(uint64_t seed, size_t batch_size, stage_t stage = stage_t()) = 0;
+
+    /**
+     * @brief Returns the next batch, the previously returned one is released
+     * @return view of the batch or nullptr if the epoch is over
+    */
+    virtual const Dataset* next() = 0;
+
+    /// @brief Ends the epoch, stops the background work
+    virtual void stop() = 0;
+
+    /// @brief How many times `next()` had to wait for the data, since last `start(...)`
+    virtual size_t stalls() const = 0;
+
+    /// @brief Total time spent waiting in `next()` since last `start(...)`, in milliseconds
+    virtual double stall_time() const = 0;
+};
+
+END_NAMESPACE
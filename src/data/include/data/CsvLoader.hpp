@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Table.hpp"
+
+START_NAMESPACE_DATA
+
+/// @brief Statistics of the last `CsvLoader` run
+struct CsvStats{
+    size_t rows = 0;
+    size_t bytes = 0;
+    double seconds = 0.0;
+
+    inline double megabytes_per_second() const {
+        return seconds > 0.0 ? bytes / seconds / (1 << 20) : 0.0;
+    }
+};
+
+/**
+ * @brief Loader of numeric CSV files into a `Table`.
+ *
+ *      CsvLoader loader;
+ *      auto table = loader.load("points.csv")
+ *          .header(true)
+ *          .label("class", 2)
+ *          .normalize(NormalizationType::min_max)
+ *          .get_table();
+ *
+ * The file is memory mapped and split into chunks at line boundaries, the chunks are parsed
+ * in parallel (`std::from_chars`) straight into the contiguous table. Empty lines are skipped,
+ * every other line must have all of the selected columns.
+*/
+class CsvLoader{
+    std::string _path;
+    char _delimiter;
+    bool _header;
+    size_t _threads;
+    std::vector<size_t> _feature_indexes;
+    std::vector<std::string> _feature_names;
+    size_t _label_index;
+    std::string _label_name;
+    size_t _classes;
+    NormalizationType _normalization;
+    std::vector<std::string> _columns;
+    CsvStats _stats;
+
+    public:
+    /// @brief Column index meaning 'not set'
+    static constexpr size_t NO_COLUMN = static_cast<size_t>(-1);
+
+    CsvLoader();
+
+    CsvLoader& load(const std::string& path);
+
+    /// @brief Separator of the fields (default ',')
+    CsvLoader& delimiter(char delimiter);
+
+    /// @brief Whether the first line holds the names of the columns (default false)
+    CsvLoader& header(bool header);
+
+    /// @brief Number of parsing threads, 0 -> hardware concurrency
+    CsvLoader& threads(size_t threads);
+
+    /// @brief Feature columns, by index. If not set, all columns except the label are the features
+    CsvLoader& features(const std::vector<size_t>& columns);
+
+    /// @brief Feature columns, by name (needs the header)
+    CsvLoader& features(const std::vector<std::string>& columns);
+
+    /**
+     * @brief Target column, by index (default: the last column)
+     * @param classes number of the classes, the values of the column are the class labels,
+     * 0 -> the column is a real valued (regression) target
+    */
+    CsvLoader& label(size_t column, size_t classes = 0);
+
+    /// @brief Target column, by name (needs the header)
+    CsvLoader& label(const std::string& column, size_t classes = 0);
+
+    /// @brief Normalization of every feature column (default none)
+    CsvLoader& normalize(NormalizationType normalization);
+
+    /**
+     * @brief Parses the file
+     * @throw std::runtime_error if the file can't be opened, a column doesn't exist, a value
+     * isn't a number or a class label is out of range
+    */
+    Table get_table();
+
+    /// @brief Names of the columns, read from the header by the last `get_table` call
+    inline const std::vector<std::string>& columns() const {
+        return _columns;
+    }
+
+    /// @brief Statistics of the last `get_table` call
+    inline const CsvStats& stats() const {
+        return _stats;
+    }
+};
+
+END_NAMESPACE
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Data.hpp"
+#include "Permutation.hpp"
+
+START_NAMESPACE_DATA
+
+/**
+ * @brief Read-only, contiguous dataset.
+ *
+ * Holds `size()` samples, each one is `rows() * cols()` uint8 values stored one after another,
+ * and a class label per sample. The real value of a feature is `q * scale() + offset()`, it's computed
+ * only when needed (`dequantize`, `at`), so the dataset may be a view of a memory mapped file.
+ * Copies are cheap, they share the underlying storage.
+*/
+class Dataset{
+    // Keeps the memory (mapped file, buffer...) alive
+    std::shared_ptr<const void> _storage;
+    const uint8_t* _samples;
+    const uint16_t* _labels;
+
+    size_t _size;
+    size_t _rows;
+    size_t _cols;
+    size_t _classes;
+    real_number_t _scale;
+    real_number_t _offset;
+
+    public:
+    Dataset();
+
+    /**
+     * @param storage owner of the `samples` and `labels` memory
+     * @param samples `size * rows * cols` quantized values
+     * @param labels `size` class labels
+     * @param classes number of the classes
+     * @param scale, offset dequantization parameters: value = q * scale + offset
+    */
+    Dataset(
+        std::shared_ptr<const void> storage,
+        const uint8_t* samples, const uint16_t* labels,
+        size_t size, size_t rows, size_t cols, size_t classes,
+        real_number_t scale = 1.0 / 255.0, real_number_t offset = 0.0
+    );
+
+    inline size_t size() const { return _size; }
+    inline size_t rows() const { return _rows; }
+    inline size_t cols() const { return _cols; }
+    inline size_t classes() const { return _classes; }
+    inline real_number_t scale() const { return _scale; }
+    inline real_number_t offset() const { return _offset; }
+    inline bool empty() const { return _size == 0; }
+
+    /// @brief Number of features of a single sample (rows * cols)
+    inline size_t features() const { return _rows * _cols; }
+
+    /// @brief Pointer to the whole, contiguous block of the quantized samples
+    inline const uint8_t* samples() const { return _samples; }
+
+    /// @brief Pointer to all of the labels
+    inline const uint16_t* labels() const { return _labels; }
+
+    /// @brief Quantized values of the sample at `index`
+    inline const uint8_t* sample(size_t index) const {
+        return _samples + index * features();
+    }
+
+    /// @brief Class label of the sample at `index`
+    inline size_t label(size_t index) const {
+        return _labels[index];
+    }
+
+    /**
+     * @brief Writes real values of the sample at `index` into `out` (`features()` values)
+    */
+    void dequantize(size_t index, real_number_t* out) const;
+
+    /**
+     * @brief Writes expected output of the sample at `index` into `out` (`classes()` values),
+     * one-hot encoded label
+    */
+    void expect(size_t index, real_number_t* out) const;
+
+    /// @brief Writes dequantized sample at `index` into `out`, reuses its capacity
+    void at(size_t index, Data& out) const;
+
+    /**
+     * @brief Creates a dataset owning the given buffers
+     * @param samples `labels.size() * rows * cols` quantized values
+    */
+    static Dataset owned(
+        std::vector<uint8_t>&& samples, std::vector<uint16_t>&& labels,
+        size_t rows, size_t cols, size_t classes,
+        real_number_t scale = 1.0 / 255.0, real_number_t offset = 0.0
+    );
+
+    /// @brief Zero-copy view of the samples [begin, end)
+    Dataset slice(size_t begin, size_t end) const;
+
+    /// @brief Dequantizes the whole dataset, caller owns the returned batch
+    data_batch* to_batch() const;
+};
+
+/**
+ * @brief Owned, resizable block of quantized samples, with the same layout as the `Dataset`.
+ * Used as a staging buffer of the mini batches (gathered, augmented), `view()` exposes it as a `Dataset`.
+*/
+class QuantizedBatch{
+    public:
+    QuantizedBatch() = default;
+
+    /**
+     * @brief Resizes the buffers to `size` samples (keeps the capacity), copies the
+     * shape, scale and offset of the `like` dataset
+     * @return *this
+    */
+    QuantizedBatch& resize(size_t size, const Dataset& like);
+
+    /// @brief Non-owning dataset view of the batch, valid until the next `resize`
+    Dataset view() const;
+
+    inline size_t size() const { return labels.size(); }
+    inline size_t features() const { return rows * cols; }
+
+    inline uint8_t* sample(size_t index) {
+        return samples.data() + index * features();
+    }
+
+    std::vector<uint8_t> samples;
+    std::vector<uint16_t> labels;
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t classes = 0;
+    real_number_t scale = 1.0;
+    real_number_t offset = 0.0;
+};
+
+/**
+ * @brief Copies samples `order(begin)`, ..., `order(end - 1)` of the `source` into `staging`,
+ * quantized values are copied as they are (no conversion), see `gather` for `data_batch`
+*/
+void gather(
+    const Dataset& source,
+    const IndexPermutation& order,
+    size_t begin, size_t end,
+    QuantizedBatch& staging
+);
+
+/// @brief Copies samples `indexes[0]`, ..., `indexes[n - 1]` of the `source` into `staging`
+void gather(
+    const Dataset& source,
+    const std::vector<size_t>& indexes,
+    QuantizedBatch& staging
+);
+
+END_NAMESPACE
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "Dataset.hpp"
+
+START_NAMESPACE_DATA
+
+/**
+ * @brief Hash of the `size` bytes (64-bit FNV-1a over 8 byte words, the tail byte by byte),
+ * may be chained by passing the previous hash as the `seed`
+*/
+uint64_t content_hash(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ULL);
+
+/**
+ * @brief Hash of the content of all the files (in order)
+ * @throw std::runtime_error if any of the files can't be opened
+*/
+uint64_t content_hash(const std::vector<std::string>& paths, uint64_t seed = 0xcbf29ce484222325ULL);
+
+/**
+ * @brief Binary cache of a preprocessed `Dataset`.
+ *
+ * The file holds a header (shape, quantization, hash of the source) followed by the samples and
+ * the labels, both aligned to 64 bytes, so the cached dataset is used straight from the memory
+ * mapped file, without any parsing. The `key` stored in the header identifies the source and the
+ * preprocessing (ex. hash of the source files mixed with the target size), the cache is valid
+ * only if the keys match.
+ *
+ * Usage:
+ *      auto key = content_hash(source_files, variant_seed);
+ *      auto dataset = DatasetCache::load_or_build("set.cache", key, [&](){ return build(); });
+*/
+class DatasetCache{
+    public:
+    /// @brief Version of the file format, files with different version are rebuilt
+    static constexpr uint32_t version = 1;
+
+    /**
+     * @brief Writes the `dataset` to `path` (through a temporary file, so a crash never
+     * leaves a partially written cache)
+     * @throw std::runtime_error if the file can't be written
+    */
+    static void write(const std::string& path, const Dataset& dataset, uint64_t key);
+
+    /**
+     * @brief Maps the cache at `path`
+     * @param key expected key of the cache
+     * @param dataset output, set only if the cache is valid
+     * @param reason optional output, why the cache couldn't be read
+     * @return false if the file doesn't exist, it's invalid or the key doesn't match
+    */
+    static bool read(const std::string& path, uint64_t key, Dataset& dataset, std::string* reason = nullptr);
+
+    /**
+     * @brief Reads the cache, if it's missing or stale, builds the dataset with `build` and writes the cache.
+     * Failure to write the cache is not an error, the built dataset is returned anyway
+    */
+    static Dataset load_or_build(
+        const std::string& path, uint64_t key,
+        const std::function<Dataset()>& build
+    );
+};
+
+END_NAMESPACE
@@ -2,25 +2,90 @@
 
 
 #include <fstream>
+#include <string>
+#include <vector>
 
 #include "Data.hpp"
+#include "Dataset.hpp"
 
 START_NAMESPACE_DATA
 
+/// @brief Statistics of the last `DoodlesLoader` run
+struct DoodlesStats{
+    size_t drawings = 0;
+    size_t bytes = 0;
+    double seconds = 0.0;
 
+    inline double drawings_per_second() const {
+        return seconds > 0.0 ? drawings / seconds : 0.0;
+    }
+};
+
+/**
+ * @brief Loader of the Quick Draw binary files (https://github.com/googlecreativelab/quickdraw-dataset),
+ * one file per category, each holds the simplified drawings (coordinates in [0, 255]) as records:
+ *      key_id (8 bytes), country_code (2), recognized (1), timestamp (4), n_strokes (2),
+ *      n_strokes times: n_points (2), x (n_points bytes), y (n_points bytes)
+ *
+ * The file is memory mapped, the records are split into chunks rasterized in parallel:
+ * every stroke is drawn with anti-aliased (Wu's) lines straight into a `size` x `size` uint8 image.
+*/
 class DoodlesLoader
 {
     std::string _path;
+    size_t _threads;
+    DoodlesStats _stats;
+
+    Dataset _load(
+        const std::vector<std::string>& paths,
+        const std::vector<size_t>& labels,
+        size_t classes, size_t size, size_t limit
+    );
+
 public:
-    DoodlesLoader() = default;
+    /// @brief Size of the Quick Draw canvas
+    static constexpr size_t CANVAS_SIZE = 256;
+
+    DoodlesLoader();
     ~DoodlesLoader() = default;
 
     DoodlesLoader& load(const std::string& path);
+
+    /// @brief Number of parsing threads, 0 -> hardware concurrency
+    DoodlesLoader& threads(size_t threads);
+
+    /**
+     * @brief Parses and rasterizes all the drawings of the file
+     * @param label category of the drawings
+     * @param classes total number of the categories
+     * @param size width and height of the images
+     * @throw std::runtime_error if the file can't be opened or it's malformed
+    */
+    Dataset get_dataset(size_t label, size_t classes, size_t size = 28);
+
+    /**
+     * @brief Loads several category files into one dataset, the label of the drawing is the index of its file
+     * @param limit maximum number of drawings per category (0 -> all)
+    */
+    Dataset get_dataset(const std::vector<std::string>& paths, size_t size = 28, size_t limit = 0);
+
+    /// @brief Statistics of the last `get_dataset` call
+    inline const DoodlesStats& stats() const {
+        return _stats;
+    }
+
+    /// @brief All drawings of the file, normalized to [0, 1], (28 x 28)
     matrix_t* get_images();
     matrix_t* get_labels();
 
     data_batch* merge_data(matrix_t* images, matrix_t* labels);
 };
 
+/**
+ * @brief Draws an anti-aliased line (Wu's algorithm) on the `size` x `size` image,
+ * pixels keep the maximum of their value and the line's coverage
+*/
+void draw_line(uint8_t* image, size_t size, float x0, float y0, float x1, float y1);
+
 
-END_NAMESPACE
\ No newline at end of file
+END_NAMESPACE
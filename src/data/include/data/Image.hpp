@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "namespaces.hpp"
+
+START_NAMESPACE_DATA
+
+/// @brief Grayscale, 8-bit image, pixels stored row by row
+struct Image{
+    size_t rows = 0;
+    size_t cols = 0;
+    std::vector<uint8_t> pixels;
+};
+
+/**
+ * @brief Decodes the netpbm image (PGM: P2, P5 or PPM: P3, P6) into `image`, reuses its memory.
+ * Color images are converted to grayscale, values are rescaled from [0, maxval] to [0, 255]
+ * @param data content of the file
+ * @param size size of the file in bytes
+ * @throw std::runtime_error if the image is not a valid PGM/PPM file
+*/
+void decode_netpbm(const uint8_t* data, size_t size, Image& image);
+
+/**
+ * @brief Resizes every image to `new_rows` x `new_cols`. If the size is divided by an integer factor
+ * (ex. 28x28 -> 14x14) the pixels are averaged over the blocks, otherwise they are sampled bilinearly.
+ * @param src source images, `rows * cols` values each
+ * @param dst destination images, `new_rows * new_cols` values each
+*/
+void resize(
+    const uint8_t* src,
+    uint8_t* dst,
+    size_t count, size_t rows, size_t cols,
+    size_t new_rows, size_t new_cols
+);
+
+END_NAMESPACE
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "Dataset.hpp"
+#include "Image.hpp"
+
+START_NAMESPACE_DATA
+
+/**
+ * @brief Loads labeled images stored as a class-per-directory tree:
+ *      root/
+ *          cat/ 001.pgm 002.ppm ...
+ *          dog/ 001.pgm ...
+ *
+ * The classes are the subdirectories, sorted by name (the label is the index of the class).
+ * The netpbm files (.pgm, .ppm, .pnm) are decoded in parallel, converted to grayscale, resized to
+ * `rows` x `cols` and written straight into the contiguous dataset. Every thread holds only
+ * the image it's decoding, so the memory used while loading is the dataset itself plus
+ * a single image per thread.
+*/
+class ImageFolderLoader{
+    std::string _root;
+    size_t _rows;
+    size_t _cols;
+    size_t _threads;
+    std::vector<std::string> _classes;
+    std::atomic<size_t> _loaded;
+    std::atomic<size_t> _total;
+
+    public:
+    ImageFolderLoader();
+
+    /// @brief Sets the root directory
+    ImageFolderLoader& load(const std::string& root);
+
+    /// @brief Size of the output images (default 28 x 28)
+    ImageFolderLoader& size(size_t rows, size_t cols);
+
+    /// @brief Number of decoding threads, 0 -> hardware concurrency
+    ImageFolderLoader& threads(size_t threads);
+
+    /**
+     * @brief Walks the tree and decodes all the images
+     * @throw std::runtime_error if the root doesn't exist or any image is invalid
+    */
+    Dataset get_dataset();
+
+    /// @brief Names of the classes found by the last `get_dataset` call, index is the label
+    inline const std::vector<std::string>& classes() const {
+        return _classes;
+    }
+
+    /// @brief Number of the images decoded so far, may be read from any thread while loading
+    inline size_t progress() const {
+        return _loaded.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Number of the images to decode (known after the tree is walked)
+    inline size_t total() const {
+        return _total.load(std::memory_order_relaxed);
+    }
+};
+
+END_NAMESPACE
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "namespaces.hpp"
+
+START_NAMESPACE_DATA
+
+/**
+ * @brief Read-only, memory mapped file. The file's content is available through `data()`
+ * without copying it, pages are loaded by the OS on first access.
+ * On platforms without `mmap` the file is read into memory.
+*/
+class MappedFile{
+    const uint8_t* _data;
+    size_t _size;
+    bool _mapped;
+
+    void _close();
+
+    public:
+    MappedFile();
+
+    /// @brief Calls `open(path)` internally
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other);
+    MappedFile& operator=(MappedFile&& other);
+
+    /**
+     * @brief Maps the whole file into memory (closes the previous one)
+     * @throw std::runtime_error if the file can't be opened or mapped
+     * @return *this
+    */
+    MappedFile& open(const std::string& path);
+
+    /// @brief Pointer to the file's content, valid as long as this object lives
+    inline const uint8_t* data() const {
+        return _data;
+    }
+
+    /// @brief Size of the file in bytes
+    inline size_t size() const {
+        return _size;
+    }
+};
+
+END_NAMESPACE
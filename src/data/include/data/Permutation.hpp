@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <stddef.h>
+
+#include "Data.hpp"
+
+START_NAMESPACE_DATA
+
+/**
+ * @brief Stateless, bijective permutation of the indexes [0, size).
+ *
+ * Used to visit the dataset in a random order without touching the samples
+ * themselves: `order(i)` returns the index of the i-th sample in the shuffled order.
+ * Internally it's a small Feistel network over the nearest power of 2 (>= size),
+ * indexes outside the range are 'cycle walked' back into it, so no index array
+ * is ever allocated and the object may be freely shared between threads.
+*/
+class IndexPermutation{
+    static constexpr int _rounds = 4;
+
+    size_t _size;
+    int _half_bits;
+    uint64_t _half_mask;
+    uint64_t _keys[_rounds];
+
+    uint64_t _feistel(uint64_t index) const;
+
+    public:
+    IndexPermutation();
+
+    /// @brief Calls `reseed(size, seed)` internally
+    IndexPermutation(size_t size, uint64_t seed);
+
+    /**
+     * @brief Creates new permutation of [0, size), the same seed gives the same order
+     * @param size number of indexes
+     * @param seed seed of the permutation
+     * @return *this
+    */
+    IndexPermutation& reseed(size_t size, uint64_t seed);
+
+    /// @brief Returns the index at `position` in the permuted order
+    size_t operator()(size_t position) const;
+
+    /// @brief Number of indexes in the permutation
+    inline size_t size() const {
+        return _size;
+    }
+};
+
+/**
+ * @brief Derives the seed of a single sample from the `seed` (of an epoch) and the sample's index,
+ * so the randomness of the sample doesn't depend on which thread (or when) processes it
+*/
+uint64_t sample_seed(uint64_t seed, size_t index);
+
+/**
+ * @brief Copies samples `order(begin)`, ..., `order(end - 1)` of the `source` into `staging`,
+ * reuses the memory already held by the `staging` batch, so after the first call no allocation is made.
+ * @param source the dataset, it's not modified
+ * @param order permutation of the `source` indexes
+ * @param begin first position (in the permuted order)
+ * @param end one past the last position, clamped to the `source` size
+ * @param staging output batch, resized to `end - begin`
+*/
+void gather(
+    const data_batch& source,
+    const IndexPermutation& order,
+    size_t begin, size_t end,
+    data_batch& staging
+);
+
+/// @brief Copies samples `indexes[0]`, ..., `indexes[n - 1]` of the `source` into `staging`, see `gather` above
+void gather(
+    const data_batch& source,
+    const std::vector<size_t>& indexes,
+    data_batch& staging
+);
+
+END_NAMESPACE
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Data.hpp"
+#include "Permutation.hpp"
+#include "Dataset.hpp"
+
+START_NAMESPACE_DATA
+
+/**
+ * @brief Order in which the samples are visited during an epoch.
+ *
+ * `start(seed)` prepares the order of a new epoch, then `sampler(position)` returns the index
+ * of the sample at `position` in [0, size()). The samples are never copied, only their indexes are
+ * computed. After `start` the sampler is read-only, so it may be used by many threads at once
+ * (ex. the `BatchLoader` workers).
+*/
+class Sampler{
+    public:
+    virtual ~Sampler() = default;
+
+    /// @brief Prepares the order of the new epoch, the same seed gives the same order
+    virtual void start(uint64_t seed) = 0;
+
+    /// @brief Number of the samples visited in one epoch
+    virtual size_t size() const = 0;
+
+    /// @brief Index of the sample at `position` in the epoch order
+    virtual size_t operator()(size_t position) const = 0;
+};
+
+enum class SamplerType{
+    /// @brief Samples in the order of the dataset
+    sequential,
+    /// @brief Random permutation of the dataset, every epoch
+    shuffled,
+    /// @brief Shuffled, every mini batch holds the classes in the same proportions as the whole dataset
+    stratified,
+    /// @brief Classes visited according to their weights (equal by default), minority classes are oversampled
+    weighted,
+    /// @brief Samples drawn proportionally to their last loss, see `ImportanceSampler`
+    importance
+};
+
+/// @brief Visits the samples in the order of the dataset
+class SequentialSampler: public Sampler{
+    size_t _size;
+
+    public:
+    explicit SequentialSampler(size_t size = 0): _size(size) {}
+
+    void start(uint64_t) override {}
+    size_t size() const override { return _size; }
+    size_t operator()(size_t position) const override { return position; }
+};
+
+/// @brief Visits the samples in a random order (`IndexPermutation`), different every epoch
+class ShuffledSampler: public Sampler{
+    size_t _size;
+    IndexPermutation _order;
+
+    public:
+    explicit ShuffledSampler(size_t size = 0): _size(size) {}
+
+    void start(uint64_t seed) override { _order.reseed(_size, seed); }
+    size_t size() const override { return _size; }
+    size_t operator()(size_t position) const override { return _order(position); }
+};
+
+/**
+ * @brief Sampler drawing every class `visits[c]` times per epoch, the visits of the classes are spread evenly
+ * over the epoch: any window of consecutive positions (ex. a mini batch) holds every class within +-1 of
+ * its rounded share `window * visits[c] / size()`. The samples of each class are shuffled with their own `IndexPermutation`,
+ * if the class is visited more times than it has samples, it's repeated in the next (shuffled) cycles.
+*/
+class ClassSampler: public Sampler{
+    protected:
+    // sample indexes grouped by the class, the class c is [_class_begin[c], _class_begin[c + 1])
+    std::vector<size_t> _by_class;
+    std::vector<size_t> _class_begin;
+    std::vector<size_t> _visits;
+    std::vector<size_t> _order;
+    size_t _epoch_size = 0;
+
+    /// @brief Groups the indexes by their `labels`
+    void _group(const uint16_t* labels, size_t size, size_t classes);
+
+    inline size_t _class_size(size_t c) const {
+        return _class_begin[c + 1] - _class_begin[c];
+    }
+
+    public:
+    void start(uint64_t seed) override;
+    size_t size() const override { return _epoch_size; }
+    size_t operator()(size_t position) const override { return _order[position]; }
+
+    /// @brief Number of the classes
+    inline size_t classes() const {
+        return _visits.size();
+    }
+
+    /// @brief How many samples of the class `c` are visited in one epoch
+    inline size_t visits(size_t c) const {
+        return _visits[c];
+    }
+};
+
+/// @brief Shuffled order, with each class spread evenly over the epoch (every sample visited once)
+class StratifiedSampler: public ClassSampler{
+    public:
+    /**
+     * @param labels class labels of the samples
+     * @param size number of the samples
+     * @param classes number of the classes
+    */
+    StratifiedSampler(const uint16_t* labels, size_t size, size_t classes);
+};
+
+/// @brief Each class visited proportionally to its weight, the epoch has as many visits as the dataset has samples
+class WeightedSampler: public ClassSampler{
+    public:
+    /**
+     * @param labels class labels of the samples
+     * @param size number of the samples
+     * @param classes number of the classes
+     * @param weights weight of every class, empty -> all classes equally often (class-balanced),
+     * classes without any sample are never visited
+    */
+    WeightedSampler(
+        const uint16_t* labels, size_t size, size_t classes,
+        const std::vector<double>& weights = {}
+    );
+};
+
+/**
+ * @brief Importance sampler, visits the samples proportionally to their loss, so the well learned
+ * (low loss) ones are mostly skipped.
+ *
+ * Keeps an estimate of the loss of every sample, updated by the trainer (`update`) with the costs of the
+ * forward pass. On `start` the probability of the sample is
+ *      p[i] = (1 - uniform) * loss[i] / sum(loss) + uniform / N
+ * (the uniform part makes sure the stale estimates get refreshed), and `fraction * N` positions are drawn
+ * with systematic sampling (every sample appears floor or ceil of its expected count times), in a shuffled order.
+ * With `fraction` 1 (ex. the warmup) the draws are uniform instead: every sample is visited exactly once, with weight 1.
+ * To keep the gradient unbiased, the gradient of the sample must be scaled by `weight(index) = 1 / (N * p[index])`.
+*/
+class ImportanceSampler: public Sampler{
+    std::vector<float> _losses;
+    std::vector<float> _probabilities;
+    std::vector<size_t> _order;
+    std::vector<size_t> _drawn;
+    double _fraction;
+    double _uniform;
+
+    public:
+    /**
+     * @param size number of the samples
+     * @param fraction part of the dataset visited in one epoch, (0, 1]
+     * @param uniform part of the probability spread uniformly over all samples, (0, 1]
+     * @param initial_loss loss estimate of the not yet seen samples
+    */
+    explicit ImportanceSampler(size_t size = 0, double fraction = 0.3, double uniform = 0.2, float initial_loss = 1.0f);
+
+    /// @brief Sets the part of the dataset visited in the next epochs, ex. 1 in the first epoch, to see every sample
+    ImportanceSampler& fraction(double fraction);
+
+    /// @brief Sets the loss estimate of the sample at `index`, must not be called concurrently with `start`
+    inline void update(size_t index, float loss){
+        _losses[index] = loss;
+    }
+
+    /// @brief Weight of the gradient of the sample at `index`, in the current epoch
+    inline real_number_t weight(size_t index) const {
+        return 1.0 / (_losses.size() * static_cast<double>(_probabilities[index]));
+    }
+
+    /// @brief Loss estimate of the sample at `index`
+    inline float loss(size_t index) const {
+        return _losses[index];
+    }
+
+    void start(uint64_t seed) override;
+    size_t size() const override;
+    size_t operator()(size_t position) const override { return _order[position]; }
+};
+
+/// @brief Class labels of the batch samples, the index of the largest expected output
+std::vector<uint16_t> class_labels(const data_batch& batch);
+
+/**
+ * @brief Creates the sampler of the given type over the `dataset`
+ * @param weights class weights of the `SamplerType::weighted` sampler
+*/
+std::unique_ptr<Sampler> make_sampler(SamplerType type, const Dataset& dataset, const std::vector<double>& weights = {});
+
+/// @brief Creates the sampler of the given type over the `batch`
+std::unique_ptr<Sampler> make_sampler(SamplerType type, const data_batch& batch, const std::vector<double>& weights = {});
+
+END_NAMESPACE
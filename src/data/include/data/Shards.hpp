@@ -0,0 +1,246 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+#include <stdint.h>
+
+#include "BatchStream.hpp"
+#include "DatasetCache.hpp"
+
+START_NAMESPACE_DATA
+
+/// @brief Name of the file describing the sharded dataset, stored next to the shards
+constexpr char SHARDS_MANIFEST_FILE_NAME[] = "manifest.txt";
+
+/**
+ * @brief Writes a dataset, sample by sample, as a directory of shards.
+ *
+ * Every shard holds up to `shard_size` samples in the `DatasetCache` format (so it's used straight
+ * from the memory mapped file), the `manifest.txt` lists the shards with the shape of the samples.
+ * Only the current shard is kept in memory, so datasets larger than RAM may be written.
+*/
+class ShardWriter{
+    std::string _directory;
+    size_t _shard_size;
+    size_t _total;
+    QuantizedBatch _buffer;
+    Dataset _layout;
+    std::vector<std::pair<std::string, size_t>> _shards;
+    bool _finished;
+
+    void _flush();
+
+    public:
+    /**
+     * @param directory existing directory of the shards
+     * @param shard_size maximum number of samples in a single shard
+    */
+    ShardWriter(
+        const std::string& directory,
+        size_t rows, size_t cols, size_t classes,
+        size_t shard_size = 65536,
+        real_number_t scale = 1.0 / 255.0, real_number_t offset = 0.0
+    );
+
+    /// @brief Calls `finish()`
+    ~ShardWriter();
+
+    ShardWriter(const ShardWriter&) = delete;
+    ShardWriter& operator=(const ShardWriter&) = delete;
+
+    /**
+     * @brief Appends a sample
+     * @param sample `rows * cols` quantized values
+     * @param label class of the sample
+     * @return *this
+    */
+    ShardWriter& add(const uint8_t* sample, size_t label);
+
+    /// @brief Appends all samples of the `dataset`, must have the same shape
+    ShardWriter& add(const Dataset& dataset);
+
+    /// @brief Number of the samples written so far
+    inline size_t size() const {
+        return _total;
+    }
+
+    /**
+     * @brief Writes the last shard and the manifest, no sample may be added afterwards
+     * @throw std::runtime_error if the files can't be written
+    */
+    void finish();
+};
+
+/**
+ * @brief Streams mini batches from the sharded dataset (see `ShardWriter`).
+ *
+ * Each epoch loads the shards in a random order. A background thread maps the next shards and reads them
+ * into memory, at most `memory_budget` bytes of shards are resident at once (but always at least one shard).
+ * The batches are drawn from a window of up to half of the budget, while the other half is read ahead:
+ * every sample is picked uniformly among the samples left in the window, so the batches mix all of its
+ * shards (ex. written class by class) as if the window was shuffled as a whole. Consumed shards are unmapped,
+ * once the window is empty the read ahead shards become the next one. The budget should hold several
+ * shards for a good mix.
+ *
+ * Like the `BatchLoader`, the batches are gathered and passed through the stage on a background thread,
+ * up to `prefetch` batches ahead of the consumer, so `next()` only hands over a ready batch.
+*/
+class ShardStream: public BatchStream{
+    struct _Shard{
+        std::string path;
+        size_t size;
+        size_t first;   // index of the first sample in the whole dataset
+        size_t bytes;
+    };
+
+    struct _Loaded{
+        Dataset data;
+        size_t shard = SIZE_MAX;
+        std::string error;  // why the shard couldn't be read, empty on success
+    };
+
+    // Resident shard of the window, its samples are visited in the `order`
+    struct _Active{
+        _Loaded loaded;
+        IndexPermutation order;
+        size_t position = 0;
+
+        inline size_t remaining() const {
+            return loaded.data.size() - position;
+        }
+    };
+
+    // Batch of the ring, owned by the builder until it's `ready`
+    struct _Slot{
+        QuantizedBatch batch;
+        std::vector<size_t> indexes;
+        Dataset view;
+        size_t number = 0;
+        bool ready = false;
+    };
+
+    void _read_ahead();
+
+    /// @brief Builds the batches of the epoch into the ring, until the epoch is over (or the stream is stopped)
+    void _build();
+
+    /**
+     * @brief Draws the next batch into the `slot`
+     * @return false if there are not enough samples left (the last, incomplete batch is skipped)
+    */
+    bool _build_batch(_Slot& slot);
+
+    /**
+     * @brief Waits for the read ahead half of the budget (or all the remaining shards), then moves
+     * these shards into the empty window
+     * @return false if there are no shards left (the epoch is over) or the stream was stopped
+     * @throw std::runtime_error if a shard couldn't be read or doesn't match the manifest
+    */
+    bool _fill_window();
+
+    /// @brief Picks the shard (index in the window) of the next sample, with the probability proportional to its remaining samples
+    size_t _draw();
+
+    /// @brief Removes the consumed shard from the window and unmaps it, so the reader may load the next one
+    void _release(size_t active);
+
+    std::string _directory;
+    std::vector<_Shard> _shards;
+    size_t _size;
+    size_t _rows;
+    size_t _cols;
+    size_t _classes;
+    real_number_t _scale;
+    real_number_t _offset;
+    size_t _memory_budget;
+    size_t _prefetch;
+
+    // epoch state
+    uint64_t _seed;
+    size_t _batch_size;
+    stage_t _stage;
+    uint64_t _draw_seed;
+    IndexPermutation _shard_order;
+    std::vector<_Active> _window;
+    size_t _remaining;  // samples left in the window
+    size_t _draws;      // samples drawn in the epoch
+
+    // ring of the built batches, shared with the builder
+    std::vector<_Slot> _slots;
+    size_t _built;      // batches claimed by the builder
+    size_t _consumed;   // batches handed to the consumer
+    size_t _released;   // batches released by the consumer
+    bool _finished;     // the builder reached the end of the epoch (or failed)
+    std::exception_ptr _error;
+    std::thread _builder;
+    std::condition_variable _batch_ready;
+    std::condition_variable _batch_freed;
+
+    // read ahead state, shared with the background thread
+    std::deque<_Loaded> _ready;
+    size_t _resident_bytes;
+    size_t _next_to_load;
+    size_t _loading;        // shards reserved in the budget, not yet in `_ready`
+    bool _reader_waiting;   // the reader waits for the budget
+    bool _stop;
+    std::thread _reader;
+    std::mutex _mutex;
+    std::condition_variable _loaded;
+    std::condition_variable _freed;
+
+    size_t _stalls;
+    std::chrono::nanoseconds _stall_time;
+
+    public:
+    ShardStream();
+
+    /// @brief Calls `open(...)` internally
+    explicit ShardStream(const std::string& directory, size_t memory_budget = 256UL << 20, size_t prefetch = 2);
+    ~ShardStream();
+
+    ShardStream(const ShardStream&) = delete;
+    ShardStream& operator=(const ShardStream&) = delete;
+
+    /**
+     * @brief Reads the manifest of the sharded dataset
+     * @param directory directory written by the `ShardWriter`
+     * @param memory_budget maximum size (in bytes) of the shards held in memory
+     * @param prefetch number of batch buffers, (prefetch - 1) batches may be ready ahead of the consumer
+     * @throw std::runtime_error if the manifest is missing or invalid
+     * @return *this
+    */
+    ShardStream& open(const std::string& directory, size_t memory_budget = 256UL << 20, size_t prefetch = 2);
+
+    inline size_t shards() const { return _shards.size(); }
+    inline size_t rows() const { return _rows; }
+    inline size_t cols() const { return _cols; }
+    inline size_t classes() const { return _classes; }
+
+    size_t size() const override;
+    /// @brief Starts new epoch, the `stage` runs on the background thread
+    void start(uint64_t seed, size_t batch_size, stage_t stage = stage_t()) override;
+
+    /**
+     * @brief Waits for the next built batch, the previously returned one is released
+     * @return view of the batch or nullptr if the epoch is over
+     * @throw std::runtime_error if a shard couldn't be read (with its path and the reason), or the stage threw
+    */
+    const Dataset* next() override;
+    void stop() override;
+
+    size_t stalls() const override {
+        return _stalls;
+    }
+
+    double stall_time() const override {
+        return std::chrono::duration<double, std::milli>(_stall_time).count();
+    }
+};
+
+END_NAMESPACE
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Dataset.hpp"
+
+START_NAMESPACE_DATA
+
+enum class NormalizationType{
+    none,
+    /// @brief x' = (x - min) / (max - min), values in [0, 1]
+    min_max,
+    /// @brief x' = (x - mean) / deviation
+    standard
+};
+
+/// @brief Statistics of a single feature column, computed from the raw (not normalized) values
+struct ColumnStats{
+    real_number_t min = 0;
+    real_number_t max = 0;
+    real_number_t mean = 0;
+    real_number_t deviation = 0;
+};
+
+/**
+ * @brief Contiguous, real-valued table of samples (ex. loaded from a CSV file).
+ *
+ * Features are stored row by row, `features()` values per sample, with a single target per sample:
+ * class label (if `classes() > 0`) or a real value (regression). The per-column statistics
+ * and the normalization are kept, so new inputs may be normalized the same way (`normalize`).
+*/
+class Table{
+    public:
+    Table() = default;
+
+    inline size_t size() const { return targets.size(); }
+    inline size_t features() const { return columns; }
+    inline bool empty() const { return targets.empty(); }
+
+    /// @brief Features of the sample at `index`
+    inline const real_number_t* sample(size_t index) const {
+        return values.data() + index * columns;
+    }
+
+    /// @brief Class label of the sample at `index` (valid only if `classes > 0`)
+    inline size_t label(size_t index) const {
+        return static_cast<size_t>(targets[index]);
+    }
+
+    /**
+     * @brief Writes the expected output of the sample at `index` into `out`: one-hot encoded label
+     * (`classes` values) or the target (1 value)
+    */
+    void expect(size_t index, real_number_t* out) const;
+
+    /// @brief Normalizes raw features (`features()` values) in place, the same way the table was
+    void normalize(real_number_t* raw) const;
+
+    /// @brief Copies the table as a batch, caller owns the returned batch
+    data_batch* to_batch() const;
+
+    /**
+     * @brief Quantizes the features into a `Dataset` (1 x `features()` samples), with the scale and offset
+     * spanning the range of the whole table
+     * @throw std::runtime_error if the table has no class labels
+    */
+    Dataset quantize() const;
+
+    std::vector<real_number_t> values;
+    std::vector<real_number_t> targets;
+    std::vector<ColumnStats> stats;
+    size_t columns = 0;
+    size_t classes = 0;
+    NormalizationType normalization = NormalizationType::none;
+};
+
+END_NAMESPACE
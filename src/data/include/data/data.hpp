@@ -2,4 +2,16 @@
 
 #include "TestData.hpp"
 #include "Data.hpp"
-#include "DoodlesLoader.hpp"
\ No newline at end of file
+#include "DoodlesLoader.hpp"
+#include "Permutation.hpp"
+#include "BatchLoader.hpp"
+#include "MappedFile.hpp"
+#include "Dataset.hpp"
+#include "DatasetCache.hpp"
+#include "BatchStream.hpp"
+#include "Shards.hpp"
+#include "Image.hpp"
+#include "ImageFolderLoader.hpp"
+#include "Table.hpp"
+#include "CsvLoader.hpp"
+#include "Sampler.hpp"
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include <data/BatchLoader.hpp>
+
+#include <algorithm>
+
+START_NAMESPACE_DATA
+
+BatchLoader::BatchLoader():
+    _source(nullptr), _dataset(nullptr), _batch_size(0), _workers_count(1), _drop_last(true), _seed(0), _sampler(nullptr), _current(nullptr), _total(0), _claimed(0),
+    _consumed(0), _released(0), _stop(true), _stalls(0), _stall_time(0)
+{}
+
+BatchLoader::BatchLoader(const data_batch* source, size_t batch_size, size_t prefetch, size_t workers):
+    BatchLoader()
+{
+    (void)prepare(source, batch_size, prefetch, workers);
+}
+
+BatchLoader::~BatchLoader(){
+    stop();
+}
+
+BatchLoader& BatchLoader::prepare(const data_batch* source, size_t batch_size, size_t prefetch, size_t workers){
+    stop();
+
+    _source = source;
+    _dataset = nullptr;
+    _sampler = nullptr;
+    _shuffled = ShuffledSampler(_source_size());
+    _drop_last = true;
+    _batch_size = std::max<size_t>(batch_size, 1);
+    _workers_count = std::max<size_t>(workers, 1);
+    _slots = std::vector<_Slot>(std::max<size_t>(prefetch, 1));
+    _current = nullptr;
+    _count_batches();
+    return *this;
+}
+
+BatchLoader& BatchLoader::prepare(const Dataset* source, size_t batch_size, size_t prefetch, size_t workers){
+    (void)prepare(static_cast<const data_batch*>(nullptr), batch_size, prefetch, workers);
+    _dataset = source;
+    _shuffled = ShuffledSampler(_source_size());
+    _count_batches();
+    return *this;
+}
+
+BatchLoader& BatchLoader::stage(stage_t stage){
+    stop();
+    _stage = stage;
+    return *this;
+}
+
+BatchLoader& BatchLoader::stage_quantized(quantized_stage_t stage){
+    stop();
+    _quantized_stage = stage;
+    return *this;
+}
+
+BatchLoader& BatchLoader::sampler(Sampler* sampler){
+    stop();
+    _sampler = sampler;
+    _count_batches();
+    return *this;
+}
+
+BatchLoader& BatchLoader::drop_last(bool drop){
+    stop();
+    _drop_last = drop;
+    _count_batches();
+    return *this;
+}
+
+void BatchLoader::_count_batches(){
+    size_t size = _order().size();
+    _total = _drop_last ? size / _batch_size : (size + _batch_size - 1) / _batch_size;
+}
+
+void BatchLoader::start(uint64_t seed){
+    stop();
+
+    _seed = seed;
+    _order().start(seed);
+    _claimed = 0;
+    _consumed = 0;
+    _released = 0;
+    _current = nullptr;
+    _stalls = 0;
+    _stall_time = std::chrono::nanoseconds(0);
+    for (auto& slot : _slots){
+        slot.ready = false;
+    }
+
+    _stop = false;
+    for (size_t i = 0; i < _workers_count; i++){
+        _workers.emplace_back(&BatchLoader::_produce, this);
+    }
+}
+
+void BatchLoader::stop(){
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _freed.notify_all();
+    _produced.notify_all();
+
+    for (auto& worker : _workers){
+        worker.join();
+    }
+    _workers.clear();
+}
+
+void BatchLoader::_produce(){
+    const size_t prefetch = _slots.size();
+
+    while (true){
+        size_t number;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_stop || _claimed == _total){
+                return;
+            }
+            number = _claimed++;
+
+            // wait until the consumer releases the batch that occupied this slot
+            _freed.wait(lock, [this, number, prefetch](){
+                return _stop || number < _released + prefetch;
+            });
+            if (_stop){
+                return;
+            }
+            _slots[number % prefetch].ready = false;
+        }
+
+        // The slot is owned by this thread until it's marked as ready
+        _Slot& slot = _slots[number % prefetch];
+        size_t begin = number * _batch_size;
+        size_t end = std::min(begin + _batch_size, _order().size());
+
+        slot.indexes.resize(end - begin);
+        for (size_t i = begin; i < end; i++){
+            slot.indexes[i - begin] = _order()(i);
+        }
+
+        if (_dataset != nullptr){
+            gather(*_dataset, slot.indexes, slot.quantized);
+            if (_quantized_stage){
+                _quantized_stage(slot.quantized, slot.indexes, _seed);
+            }
+            slot.view = slot.quantized.view();
+        } else {
+            gather(*_source, slot.indexes, slot.batch);
+            if (_stage){
+                _stage(slot.batch, slot.indexes, _seed);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            slot.number = number;
+            slot.ready = true;
+        }
+        _produced.notify_all();
+    }
+}
+
+BatchLoader::_Slot* BatchLoader::_next_slot(){
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    // the consumer is done with the previous batch, its slot may be refilled
+    _current = nullptr;
+    if (_released < _consumed){
+        _released = _consumed;
+        _freed.notify_all();
+    }
+
+    if (_stop || _consumed == _total){
+        return nullptr;
+    }
+
+    _Slot& slot = _slots[_consumed % _slots.size()];
+    auto is_ready = [this, &slot](){
+        return _stop || (slot.ready && slot.number == _consumed);
+    };
+
+    if (!is_ready()){
+        // The loader is the bottleneck
+        auto start = std::chrono::steady_clock::now();
+        _produced.wait(lock, is_ready);
+        _stall_time += std::chrono::steady_clock::now() - start;
+        _stalls++;
+    }
+    if (_stop){
+        return nullptr;
+    }
+
+    _consumed++;
+    _current = &slot;
+    return &slot;
+}
+
+const std::vector<size_t>& BatchLoader::indexes() const {
+    static const std::vector<size_t> empty;
+    return _current != nullptr ? _current->indexes : empty;
+}
+
+const data_batch* BatchLoader::next(){
+    _Slot* slot = _next_slot();
+    return slot != nullptr ? &slot->batch : nullptr;
+}
+
+const Dataset* BatchLoader::next_quantized(){
+    _Slot* slot = _next_slot();
+    return slot != nullptr ? &slot->view : nullptr;
+}
+
+END_NAMESPACE
@@ -0,0 +1,375 @@
+#include <data/CsvLoader.hpp>
+#include <data/MappedFile.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+
+START_NAMESPACE_DATA
+
+namespace {
+    // Chunks per thread, so the threads stay busy even if the lines differ in length
+    constexpr size_t CHUNKS_PER_THREAD = 8;
+    constexpr size_t MIN_CHUNK_SIZE = 1 << 16;
+
+    struct _Chunk{
+        const char* begin;
+        const char* end;
+        size_t first_row;
+        size_t rows;
+    };
+
+    // Partial sums of a feature column, reduced into `ColumnStats`
+    struct _Sums{
+        real_number_t min = INFINITY;
+        real_number_t max = -INFINITY;
+        double sum = 0.0;
+        double squares = 0.0;
+    };
+
+    inline const char* line_end(const char* position, const char* end){
+        const char* newline = static_cast<const char*>(std::memchr(position, '\n', end - position));
+        return newline != nullptr ? newline : end;
+    }
+
+    // Drops the trailing '\r' of the line
+    inline const char* trim_line(const char* begin, const char* end){
+        return end > begin && end[-1] == '\r' ? end - 1 : end;
+    }
+
+    std::string trim(const std::string& field){
+        size_t begin = field.find_first_not_of(" \t\"");
+        size_t end = field.find_last_not_of(" \t\"\r");
+        return begin == std::string::npos ? std::string() : field.substr(begin, end - begin + 1);
+    }
+
+    std::vector<std::string> split(const char* begin, const char* end, char delimiter){
+        std::vector<std::string> fields;
+        const char* field = begin;
+        for (const char* p = begin; p <= end; p++){
+            if (p == end || *p == delimiter){
+                fields.push_back(trim(std::string(field, p)));
+                field = p + 1;
+            }
+        }
+        return fields;
+    }
+
+    /**
+     * Parses the number at the start of the field [begin, end), the field may be padded with spaces
+     * and quoted. Returns the position after the field (at the delimiter or `end`), nullptr on error
+    */
+    inline const char* parse_field(const char* begin, const char* end, char delimiter, real_number_t& value){
+        while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '"')){
+            begin++;
+        }
+        if (begin < end && *begin == '+'){
+            begin++;
+        }
+        auto result = std::from_chars(begin, end, value);
+        if (result.ec != std::errc()){
+            return nullptr;
+        }
+        const char* p = result.ptr;
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '"')){
+            p++;
+        }
+        return p == end || *p == delimiter ? p : nullptr;
+    }
+
+    // Calls `work(index)` for every index in [0, count), on `threads` threads
+    template <class Work>
+    void parallel_for(size_t count, size_t threads, Work work){
+        std::atomic<size_t> next(0);
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        auto run = [&](){
+            for (size_t i = next++; i < count; i = next++){
+                try{
+                    work(i);
+                } catch (...){
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error){
+                        error = std::current_exception();
+                    }
+                    next = count;
+                    return;
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < std::min(threads, count); i++){
+            workers.emplace_back(run);
+        }
+        run();
+        for (auto& worker : workers){
+            worker.join();
+        }
+        if (error){
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+CsvLoader::CsvLoader():
+    _delimiter(','), _header(false), _threads(0),
+    _label_index(NO_COLUMN), _classes(0),
+    _normalization(NormalizationType::none) {}
+
+CsvLoader& CsvLoader::load(const std::string& path){
+    _path = path;
+    return *this;
+}
+
+CsvLoader& CsvLoader::delimiter(char delimiter){
+    _delimiter = delimiter;
+    return *this;
+}
+
+CsvLoader& CsvLoader::header(bool header){
+    _header = header;
+    return *this;
+}
+
+CsvLoader& CsvLoader::threads(size_t threads){
+    _threads = threads;
+    return *this;
+}
+
+CsvLoader& CsvLoader::features(const std::vector<size_t>& columns){
+    _feature_indexes = columns;
+    _feature_names.clear();
+    return *this;
+}
+
+CsvLoader& CsvLoader::features(const std::vector<std::string>& columns){
+    _feature_names = columns;
+    _feature_indexes.clear();
+    return *this;
+}
+
+CsvLoader& CsvLoader::label(size_t column, size_t classes){
+    _label_index = column;
+    _label_name.clear();
+    _classes = classes;
+    return *this;
+}
+
+CsvLoader& CsvLoader::label(const std::string& column, size_t classes){
+    _label_name = column;
+    _label_index = NO_COLUMN;
+    _classes = classes;
+    return *this;
+}
+
+CsvLoader& CsvLoader::normalize(NormalizationType normalization){
+    _normalization = normalization;
+    return *this;
+}
+
+Table CsvLoader::get_table(){
+    auto start = std::chrono::steady_clock::now();
+
+    MappedFile file(_path);
+    const char* begin = reinterpret_cast<const char*>(file.data());
+    const char* end = begin + file.size();
+
+    // header and the number of the fields, from the first line
+    _columns.clear();
+    const char* first_end = trim_line(begin, line_end(begin, end));
+    std::vector<std::string> first = split(begin, first_end, _delimiter);
+    const size_t fields = first.size();
+    if (_header){
+        _columns = std::move(first);
+        begin = line_end(begin, end);
+        begin += begin < end;
+    }
+
+    auto find_column = [&](const std::string& name) -> size_t {
+        auto it = std::find(_columns.begin(), _columns.end(), name);
+        if (it == _columns.end()){
+            throw std::runtime_error("No such CSV column: " + name + " in " + _path);
+        }
+        return it - _columns.begin();
+    };
+
+    // selected columns
+    size_t label_column = !_label_name.empty() ? find_column(_label_name) :
+        _label_index != NO_COLUMN ? _label_index : fields - 1;
+    std::vector<size_t> feature_columns = _feature_indexes;
+    for (const auto& name : _feature_names){
+        feature_columns.push_back(find_column(name));
+    }
+    if (feature_columns.empty()){
+        for (size_t c = 0; c < fields; c++){
+            if (c != label_column){
+                feature_columns.push_back(c);
+            }
+        }
+    }
+    if (feature_columns.empty()){
+        throw std::runtime_error("No CSV feature columns in " + _path);
+    }
+    for (size_t c : feature_columns){
+        if (c >= fields){
+            throw std::runtime_error("CSV column out of range: " + std::to_string(c) + " in " + _path);
+        }
+    }
+    if (label_column >= fields){
+        throw std::runtime_error("CSV label column out of range: " + std::to_string(label_column) + " in " + _path);
+    }
+
+    // feature slot of every field, -1 if it's not a feature
+    std::vector<long> slots(fields, -1);
+    for (size_t i = 0; i < feature_columns.size(); i++){
+        if (slots[feature_columns[i]] >= 0){
+            throw std::runtime_error("Duplicated CSV column: " + std::to_string(feature_columns[i]) + " in " + _path);
+        }
+        slots[feature_columns[i]] = static_cast<long>(i);
+    }
+    const size_t last_field = std::max(label_column, *std::max_element(feature_columns.begin(), feature_columns.end()));
+
+    // chunks split at the line boundaries
+    const size_t threads = _threads != 0 ? _threads : std::max(1U, std::thread::hardware_concurrency());
+    const size_t bytes = end - begin;
+    const size_t chunk_count = std::max<size_t>(1, std::min(threads * CHUNKS_PER_THREAD, bytes / MIN_CHUNK_SIZE));
+
+    std::vector<_Chunk> chunks;
+    const char* chunk_begin = begin;
+    for (size_t i = 1; i <= chunk_count && chunk_begin < end; i++){
+        const char* chunk_end = end;
+        if (i != chunk_count){
+            chunk_end = line_end(std::max(chunk_begin, begin + bytes * i / chunk_count), end);
+            chunk_end += chunk_end < end;
+        }
+        chunks.push_back({chunk_begin, chunk_end, 0, 0});
+        chunk_begin = chunk_end;
+    }
+
+    // first pass, counts the (non empty) lines, to know where each chunk writes its rows
+    parallel_for(chunks.size(), threads, [&](size_t c){
+        _Chunk& chunk = chunks[c];
+        for (const char* line = chunk.begin; line < chunk.end;){
+            const char* next = line_end(line, chunk.end);
+            chunk.rows += trim_line(line, next) > line;
+            line = next + 1;
+        }
+    });
+
+    size_t rows = 0;
+    for (auto& chunk : chunks){
+        chunk.first_row = rows;
+        rows += chunk.rows;
+    }
+
+    Table table;
+    table.columns = feature_columns.size();
+    table.classes = _classes;
+    table.normalization = _normalization;
+    table.values.resize(rows * table.columns);
+    table.targets.resize(rows);
+
+    // second pass, parses the values straight into the table
+    std::vector<std::vector<_Sums>> sums(chunks.size(), std::vector<_Sums>(table.columns));
+    parallel_for(chunks.size(), threads, [&](size_t c){
+        const _Chunk& chunk = chunks[c];
+        std::vector<_Sums>& column_sums = sums[c];
+        size_t row = chunk.first_row;
+
+        for (const char* line = chunk.begin; line < chunk.end;){
+            const char* next = line_end(line, chunk.end);
+            const char* line_last = trim_line(line, next);
+            if (line_last == line){
+                line = next + 1;
+                continue;
+            }
+
+            auto error = [&](const std::string& message){
+                return std::runtime_error(
+                    "CSV row " + std::to_string(row) + " (" + std::string(line, line_last) + "): " + message
+                );
+            };
+
+            real_number_t* values = table.values.data() + row * table.columns;
+            const char* field = line;
+            for (size_t f = 0; f <= last_field; f++){
+                if (field > line_last){
+                    throw error("missing column " + std::to_string(f));
+                }
+                if (slots[f] < 0 && f != label_column){
+                    const char* delimiter = static_cast<const char*>(std::memchr(field, _delimiter, line_last - field));
+                    field = (delimiter != nullptr ? delimiter : line_last) + 1;
+                    continue;
+                }
+
+                real_number_t value;
+                const char* field_end = parse_field(field, line_last, _delimiter, value);
+                if (field_end == nullptr){
+                    throw error("invalid number in column " + std::to_string(f));
+                }
+                if (slots[f] >= 0){
+                    values[slots[f]] = value;
+                }
+                if (f == label_column){
+                    if (_classes != 0 && (value < 0 || value >= _classes || value != std::floor(value))){
+                        throw error("invalid class label");
+                    }
+                    table.targets[row] = value;
+                }
+                field = field_end + 1;
+            }
+
+            for (size_t i = 0; i < table.columns; i++){
+                _Sums& s = column_sums[i];
+                s.min = std::min(s.min, values[i]);
+                s.max = std::max(s.max, values[i]);
+                s.sum += values[i];
+                s.squares += values[i] * values[i];
+            }
+            row++;
+            line = next + 1;
+        }
+    });
+
+    // column statistics
+    table.stats.resize(table.columns);
+    for (size_t i = 0; i < table.columns && rows > 0; i++){
+        _Sums total;
+        for (const auto& chunk_sums : sums){
+            total.min = std::min(total.min, chunk_sums[i].min);
+            total.max = std::max(total.max, chunk_sums[i].max);
+            total.sum += chunk_sums[i].sum;
+            total.squares += chunk_sums[i].squares;
+        }
+        double mean = total.sum / rows;
+        table.stats[i].min = total.min;
+        table.stats[i].max = total.max;
+        table.stats[i].mean = mean;
+        table.stats[i].deviation = std::sqrt(std::max(0.0, total.squares / rows - mean * mean));
+    }
+
+    if (_normalization != NormalizationType::none){
+        parallel_for(chunks.size(), threads, [&](size_t c){
+            for (size_t row = chunks[c].first_row; row < chunks[c].first_row + chunks[c].rows; row++){
+                table.normalize(table.values.data() + row * table.columns);
+            }
+        });
+    }
+
+    _stats.rows = rows;
+    _stats.bytes = file.size();
+    _stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return table;
+}
+
+END_NAMESPACE
@@ -0,0 +1,134 @@
+#include <data/Dataset.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+START_NAMESPACE_DATA
+
+Dataset::Dataset():
+    _samples(nullptr), _labels(nullptr),
+    _size(0), _rows(0), _cols(0), _classes(0),
+    _scale(1.0), _offset(0.0)
+{}
+
+Dataset::Dataset(
+    std::shared_ptr<const void> storage,
+    const uint8_t* samples, const uint16_t* labels,
+    size_t size, size_t rows, size_t cols, size_t classes,
+    real_number_t scale, real_number_t offset
+):
+    _storage(storage), _samples(samples), _labels(labels),
+    _size(size), _rows(rows), _cols(cols), _classes(classes),
+    _scale(scale), _offset(offset)
+{}
+
+Dataset Dataset::owned(
+    std::vector<uint8_t>&& samples, std::vector<uint16_t>&& labels,
+    size_t rows, size_t cols, size_t classes,
+    real_number_t scale, real_number_t offset
+){
+    struct _Buffers{
+        std::vector<uint8_t> samples;
+        std::vector<uint16_t> labels;
+    };
+
+    auto buffers = std::make_shared<_Buffers>();
+    buffers->samples = std::move(samples);
+    buffers->labels = std::move(labels);
+
+    return Dataset(
+        buffers, buffers->samples.data(), buffers->labels.data(),
+        buffers->labels.size(), rows, cols, classes, scale, offset
+    );
+}
+
+void Dataset::dequantize(size_t index, real_number_t* out) const {
+    const uint8_t* q = sample(index);
+    const size_t n = features();
+    for (size_t i = 0; i < n; i++){
+        out[i] = q[i] * _scale + _offset;
+    }
+}
+
+void Dataset::expect(size_t index, real_number_t* out) const {
+    std::fill(out, out + _classes, 0.0);
+    out[label(index)] = 1.0;
+}
+
+void Dataset::at(size_t index, Data& out) const {
+    out.input.resize(features());
+    out.expect.resize(_classes);
+    dequantize(index, out.input.data());
+    expect(index, out.expect.data());
+}
+
+Dataset Dataset::slice(size_t begin, size_t end) const {
+    end = std::min(end, _size);
+    begin = std::min(begin, end);
+
+    Dataset view(*this);
+    view._samples = _samples + begin * features();
+    view._labels = _labels + begin;
+    view._size = end - begin;
+    return view;
+}
+
+data_batch* Dataset::to_batch() const {
+    std::unique_ptr<data_batch> batch(new data_batch(_size));
+    for (size_t i = 0; i < _size; i++){
+        at(i, (*batch)[i]);
+    }
+    return batch.release();
+}
+
+QuantizedBatch& QuantizedBatch::resize(size_t size, const Dataset& like){
+    rows = like.rows();
+    cols = like.cols();
+    classes = like.classes();
+    scale = like.scale();
+    offset = like.offset();
+
+    samples.resize(size * features());
+    labels.resize(size);
+    return *this;
+}
+
+Dataset QuantizedBatch::view() const {
+    return Dataset(
+        nullptr, samples.data(), labels.data(),
+        size(), rows, cols, classes, scale, offset
+    );
+}
+
+void gather(
+    const Dataset& source,
+    const IndexPermutation& order,
+    size_t begin, size_t end,
+    QuantizedBatch& staging
+){
+    end = std::min(end, source.size());
+    begin = std::min(begin, end);
+
+    const size_t features = source.features();
+    staging.resize(end - begin, source);
+    for (size_t i = begin; i < end; i++){
+        size_t index = order(i);
+        std::memcpy(staging.sample(i - begin), source.sample(index), features);
+        staging.labels[i - begin] = source.labels()[index];
+    }
+}
+
+void gather(
+    const Dataset& source,
+    const std::vector<size_t>& indexes,
+    QuantizedBatch& staging
+){
+    const size_t features = source.features();
+    staging.resize(indexes.size(), source);
+    for (size_t i = 0; i < indexes.size(); i++){
+        std::memcpy(staging.sample(i), source.sample(indexes[i]), features);
+        staging.labels[i] = source.labels()[indexes[i]];
+    }
+}
+
+END_NAMESPACE
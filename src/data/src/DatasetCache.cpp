@@ -0,0 +1,183 @@
+#include <data/DatasetCache.hpp>
+#include <data/MappedFile.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+START_NAMESPACE_DATA
+
+namespace {
+    constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+    constexpr size_t CACHE_ALIGNMENT = 64;
+    constexpr char CACHE_MAGIC[8] = {'C', 'L', 'D', 'S', 'E', 'T', '\0', '\0'};
+
+    // Header of the cache file, stored as it is (little endian)
+    struct _CacheHeader{
+        char magic[8];
+        uint32_t version;
+        uint32_t header_size;
+        uint64_t key;
+        uint64_t size;
+        uint64_t rows;
+        uint64_t cols;
+        uint64_t classes;
+        double scale;
+        double offset;
+        uint64_t samples_offset;
+        uint64_t labels_offset;
+    };
+
+    inline uint64_t align(uint64_t offset){
+        return (offset + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+    }
+
+    void write_padding(std::ofstream& file, uint64_t from, uint64_t to){
+        static const char zeros[CACHE_ALIGNMENT] = {};
+        file.write(zeros, to - from);
+    }
+}
+
+uint64_t content_hash(const void* data, size_t size, uint64_t seed){
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+
+    // a word at a time, the dependency chain is 8 times shorter than byte by byte
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8){
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * FNV_PRIME;
+    }
+    for (; i < size; i++){
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t content_hash(const std::vector<std::string>& paths, uint64_t seed){
+    uint64_t hash = seed;
+    for (auto& path : paths){
+        MappedFile file(path);
+        uint64_t size = file.size();
+        hash = content_hash(&size, sizeof(size), hash);
+        hash = content_hash(file.data(), file.size(), hash);
+    }
+    return hash;
+}
+
+void DatasetCache::write(const std::string& path, const Dataset& dataset, uint64_t key){
+    _CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = version;
+    header.header_size = sizeof(_CacheHeader);
+    header.key = key;
+    header.size = dataset.size();
+    header.rows = dataset.rows();
+    header.cols = dataset.cols();
+    header.classes = dataset.classes();
+    header.scale = dataset.scale();
+    header.offset = dataset.offset();
+    header.samples_offset = align(sizeof(_CacheHeader));
+
+    const uint64_t samples_bytes = header.size * dataset.features();
+    const uint64_t labels_bytes = header.size * sizeof(uint16_t);
+    header.labels_offset = align(header.samples_offset + samples_bytes);
+
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()){
+            throw std::runtime_error("Could not create the cache file: " + temporary);
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        write_padding(file, sizeof(header), header.samples_offset);
+        file.write(reinterpret_cast<const char*>(dataset.samples()), samples_bytes);
+        write_padding(file, header.samples_offset + samples_bytes, header.labels_offset);
+        file.write(reinterpret_cast<const char*>(dataset.labels()), labels_bytes);
+
+        if (!file.good()){
+            file.close();
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Could not write the cache file: " + temporary);
+        }
+    }
+
+    if (std::rename(temporary.c_str(), path.c_str()) != 0){
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Could not replace the cache file: " + path);
+    }
+}
+
+bool DatasetCache::read(const std::string& path, uint64_t key, Dataset& dataset, std::string* reason){
+    auto fail = [reason](const std::string& why){
+        if (reason != nullptr){
+            *reason = why;
+        }
+        return false;
+    };
+
+    auto file = std::make_shared<MappedFile>();
+    try {
+        file->open(path);
+    } catch (const std::runtime_error& e){
+        return fail(e.what());
+    }
+
+    if (file->size() < sizeof(_CacheHeader)){
+        return fail("the file is too small");
+    }
+
+    _CacheHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.header_size != sizeof(_CacheHeader)){
+        return fail("not a dataset cache");
+    }
+    if (header.version != version){
+        return fail("version " + std::to_string(header.version) + ", expected " + std::to_string(version));
+    }
+    if (header.key != key){
+        return fail("the key doesn't match");
+    }
+
+    const uint64_t samples_bytes = header.size * header.rows * header.cols;
+    const uint64_t labels_bytes = header.size * sizeof(uint16_t);
+    if (header.samples_offset + samples_bytes > header.labels_offset
+        || header.labels_offset % alignof(uint16_t) != 0
+        || header.labels_offset + labels_bytes > file->size()){
+        return fail("the file is truncated or corrupted");
+    }
+
+    const uint8_t* samples = file->data() + header.samples_offset;
+    const uint16_t* labels = reinterpret_cast<const uint16_t*>(file->data() + header.labels_offset);
+
+    dataset = Dataset(
+        file, samples, labels,
+        header.size, header.rows, header.cols, header.classes,
+        header.scale, header.offset
+    );
+    return true;
+}
+
+Dataset DatasetCache::load_or_build(
+    const std::string& path, uint64_t key,
+    const std::function<Dataset()>& build
+){
+    Dataset dataset;
+    if (read(path, key, dataset)){
+        return dataset;
+    }
+
+    dataset = build();
+    try {
+        write(path, dataset, key);
+    } catch (const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+    }
+    return dataset;
+}
+
+END_NAMESPACE
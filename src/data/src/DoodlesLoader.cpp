@@ -1,70 +1,243 @@
 #include <data/DoodlesLoader.hpp>
+#include <data/MappedFile.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
 
 
 START_NAMESPACE_DATA
 
+namespace {
+    // key_id, country_code, recognized, timestamp, n_strokes
+    constexpr size_t RECORD_HEADER_SIZE = 8 + 2 + 1 + 4 + 2;
+    constexpr size_t CHUNK_SIZE = 256;
+    // empty border around the drawing, in pixels of the output image
+    constexpr float MARGIN = 2.0f;
+
+    inline uint16_t read_u16(const uint8_t* p){
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    // Mapped category file with the offsets of its records
+    struct _Source{
+        MappedFile file;
+        std::vector<size_t> records;
+        size_t label;
+    };
+
+    // Walks the records (only the headers and the point counts are read), returns their offsets
+    void scan(_Source& source, const std::string& path, size_t limit){
+        const uint8_t* data = source.file.data();
+        const size_t size = source.file.size();
+        size_t position = 0;
+
+        while (position < size && (limit == 0 || source.records.size() < limit)){
+            if (position + RECORD_HEADER_SIZE > size){
+                throw std::runtime_error("Truncated Quick Draw record: " + path);
+            }
+            source.records.push_back(position);
+
+            uint16_t strokes = read_u16(data + position + RECORD_HEADER_SIZE - 2);
+            position += RECORD_HEADER_SIZE;
+            for (uint16_t s = 0; s < strokes; s++){
+                if (position + 2 > size){
+                    throw std::runtime_error("Truncated Quick Draw stroke: " + path);
+                }
+                position += 2 + 2 * static_cast<size_t>(read_u16(data + position));
+            }
+            if (position > size){
+                throw std::runtime_error("Truncated Quick Draw stroke: " + path);
+            }
+        }
+    }
+
+    // Draws all strokes of the record at `record` on the `image`
+    void rasterize(const uint8_t* record, uint8_t* image, size_t size){
+        const float scale = (size - 2.0f * MARGIN - 1.0f) / (DoodlesLoader::CANVAS_SIZE - 1);
+
+        uint16_t strokes = read_u16(record + RECORD_HEADER_SIZE - 2);
+        const uint8_t* stroke = record + RECORD_HEADER_SIZE;
+
+        for (uint16_t s = 0; s < strokes; s++){
+            uint16_t points = read_u16(stroke);
+            const uint8_t* x = stroke + 2;
+            const uint8_t* y = x + points;
+
+            for (uint16_t i = 0; i < points; i++){
+                size_t from = i > 0 ? i - 1 : 0;
+                draw_line(
+                    image, size,
+                    x[from] * scale + MARGIN, y[from] * scale + MARGIN,
+                    x[i] * scale + MARGIN, y[i] * scale + MARGIN
+                );
+            }
+            stroke = y + points;
+        }
+    }
+
+    // Rasterizes the records of all the sources, in parallel chunks
+    Dataset rasterize_all(std::vector<_Source>& sources, size_t size, size_t classes, size_t threads){
+        struct _Chunk{
+            const _Source* source;
+            size_t begin, end;
+            size_t output;
+        };
+
+        std::vector<_Chunk> chunks;
+        size_t total = 0;
+        for (auto& source : sources){
+            for (size_t begin = 0; begin < source.records.size(); begin += CHUNK_SIZE){
+                size_t end = std::min(begin + CHUNK_SIZE, source.records.size());
+                chunks.push_back({&source, begin, end, total + begin});
+            }
+            total += source.records.size();
+        }
+
+        const size_t features = size * size;
+        std::vector<uint8_t> samples(total * features, 0);
+        std::vector<uint16_t> labels(total);
+
+        std::atomic<size_t> next_chunk(0);
+        auto work = [&](){
+            for (size_t c = next_chunk++; c < chunks.size(); c = next_chunk++){
+                const _Chunk& chunk = chunks[c];
+                const uint8_t* data = chunk.source->file.data();
+                for (size_t r = chunk.begin; r < chunk.end; r++){
+                    size_t index = chunk.output + r - chunk.begin;
+                    rasterize(data + chunk.source->records[r], samples.data() + index * features, size);
+                    labels[index] = static_cast<uint16_t>(chunk.source->label);
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < threads; i++){
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto& worker : workers){
+            worker.join();
+        }
+
+        return Dataset::owned(std::move(samples), std::move(labels), size, size, classes);
+    }
+}
+
+void draw_line(uint8_t* image, size_t size, float x0, float y0, float x1, float y1){
+    const int isize = static_cast<int>(size);
+    const bool steep = std::fabs(y1 - y0) > std::fabs(x1 - x0);
+    if (steep){
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+    if (x0 > x1){
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+
+    auto plot = [&](int x, int y, float coverage){
+        if (steep){
+            std::swap(x, y);
+        }
+        if (x < 0 || y < 0 || x >= isize || y >= isize){
+            return;
+        }
+        uint8_t value = static_cast<uint8_t>(std::min(1.0f, coverage) * 255.0f + 0.5f);
+        uint8_t& pixel = image[y * size + x];
+        pixel = std::max(pixel, value);
+    };
+    auto fpart = [](float v){ return v - std::floor(v); };
+
+    const float dx = x1 - x0, dy = y1 - y0;
+    const float gradient = dx == 0.0f ? 1.0f : dy / dx;
+
+    // first end point
+    float xend = std::round(x0);
+    float yend = y0 + gradient * (xend - x0);
+    float xgap = 1.0f - fpart(x0 + 0.5f);
+    int xpixel1 = static_cast<int>(xend), ypixel1 = static_cast<int>(std::floor(yend));
+    plot(xpixel1, ypixel1, (1.0f - fpart(yend)) * xgap);
+    plot(xpixel1, ypixel1 + 1, fpart(yend) * xgap);
+    float intery = yend + gradient;
+
+    // second end point
+    xend = std::round(x1);
+    yend = y1 + gradient * (xend - x1);
+    xgap = fpart(x1 + 0.5f);
+    int xpixel2 = static_cast<int>(xend), ypixel2 = static_cast<int>(std::floor(yend));
+    plot(xpixel2, ypixel2, (1.0f - fpart(yend)) * xgap);
+    plot(xpixel2, ypixel2 + 1, fpart(yend) * xgap);
+
+    // the line between them, 2 pixels per column
+    for (int x = xpixel1 + 1; x < xpixel2; x++){
+        int y = static_cast<int>(std::floor(intery));
+        plot(x, y, 1.0f - fpart(intery));
+        plot(x, y + 1, fpart(intery));
+        intery += gradient;
+    }
+}
+
+DoodlesLoader::DoodlesLoader(): _threads(0) {}
+
 DoodlesLoader& DoodlesLoader::load(const std::string& path){
     _path = path;
     return *this;
 }
 
-matrix_t* DoodlesLoader::get_images(){
-    std::ifstream file(_path);
-    
-    if(!file.is_open()){
-        throw std::runtime_error("File not found: " + _path);
+DoodlesLoader& DoodlesLoader::threads(size_t threads){
+    _threads = threads;
+    return *this;
+}
+
+Dataset DoodlesLoader::_load(
+    const std::vector<std::string>& paths,
+    const std::vector<size_t>& labels,
+    size_t classes, size_t size, size_t limit
+){
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<_Source> sources(paths.size());
+    size_t bytes = 0;
+    for (size_t i = 0; i < paths.size(); i++){
+        sources[i].file.open(paths[i]);
+        sources[i].label = labels[i];
+        scan(sources[i], paths[i], limit);
+        bytes += sources[i].file.size();
     }
-    
-    std::string line;
-    
-    matrix_t* images = new matrix_t();
-
-    long long int key_id = 0;
-    std::string country_code;
-    bool recognized = false;
-    uint32_t timestamp = 0;
-    uint16_t n_strokes = 0;
-    // uint8_t keys[8];
-    file.read(reinterpret_cast<char*>(&key_id), 8);
-    file.read(country_code.data(), 2);
-    file.read(reinterpret_cast<char*>(&recognized), sizeof(recognized));
-    file.read(reinterpret_cast<char*>(&timestamp), sizeof(timestamp));
-    file.read(reinterpret_cast<char*>(&n_strokes), sizeof(n_strokes));
-
-    printf("key_id: %lld\n", key_id);
-    printf("country_code: %s\n", country_code.data());
-    printf("recognized: %d\n", recognized);
-    printf("timestamp: %d\n", timestamp);
-    printf("n_strokes: %d\n", n_strokes);
-
-    uint16_t n_points;
-    data::vector_t pixels(256*256, 0.0);
-    
-    for (uint16_t n = 0; n < n_strokes; n++){
-        file.read(reinterpret_cast<char*>(&n_points), sizeof(n_points));
-        std::vector<uint8_t> x(n_points, 0);
-        std::vector<uint8_t> y(n_points, 0);
-
-        file.read(reinterpret_cast<char*>(x.data()), n_points * sizeof(uint8_t));
-        file.read(reinterpret_cast<char*>(y.data()), n_points * sizeof(uint8_t));
-
-        printf("n_points: %d\n", n_points);
-        for (uint16_t i = 0; i < n_points; i++){
-            uint8_t pixel_x = x[i];
-            uint8_t pixel_y = y[i];
-            printf("%i. %d %d\n", i, x, y);
-            pixels[pixel_x + pixel_y*256] = 1.0;
-        }
+
+    size_t threads = _threads != 0 ? _threads : std::max(1U, std::thread::hardware_concurrency());
+    Dataset dataset = rasterize_all(sources, size, classes, threads);
+
+    _stats.drawings = dataset.size();
+    _stats.bytes = bytes;
+    _stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return dataset;
+}
+
+Dataset DoodlesLoader::get_dataset(const std::vector<std::string>& paths, size_t size, size_t limit){
+    std::vector<size_t> labels(paths.size());
+    for (size_t i = 0; i < paths.size(); i++){
+        labels[i] = i;
     }
-    images->push_back(pixels);
+    return _load(paths, labels, paths.size(), size, limit);
+}
 
-    // for (int i = 0; i < 8; i++){
-    //     printf("%d\n", keys[i]);
-    // }
-    
+Dataset DoodlesLoader::get_dataset(size_t label, size_t classes, size_t size){
+    return _load({_path}, {label}, classes, size, 0);
+}
 
+matrix_t* DoodlesLoader::get_images(){
+    Dataset dataset = get_dataset(0, 1);
 
+    matrix_t* images = new matrix_t(dataset.size(), vector_t(dataset.features()));
+    for (size_t i = 0; i < dataset.size(); i++){
+        dataset.dequantize(i, (*images)[i].data());
+    }
     return images;
 }
 
-END_NAMESPACE
\ No newline at end of file
+END_NAMESPACE
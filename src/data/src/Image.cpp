@@ -0,0 +1,155 @@
+#include <data/Image.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+START_NAMESPACE_DATA
+
+namespace {
+    // Reads whitespace separated values of the netpbm header (and of the ascii formats), skips the comments
+    struct _Reader{
+        const uint8_t* data;
+        size_t size;
+        size_t position;
+
+        void skip(){
+            while (position < size){
+                if (data[position] == '#'){
+                    while (position < size && data[position] != '\n'){
+                        position++;
+                    }
+                } else if (data[position] == ' ' || data[position] == '\t' || data[position] == '\n' || data[position] == '\r'){
+                    position++;
+                } else {
+                    break;
+                }
+            }
+        }
+
+        uint32_t number(){
+            skip();
+            if (position == size || data[position] < '0' || data[position] > '9'){
+                throw std::runtime_error("Invalid netpbm image: expected a number");
+            }
+            uint32_t value = 0;
+            while (position < size && data[position] >= '0' && data[position] <= '9'){
+                value = value * 10 + (data[position++] - '0');
+            }
+            return value;
+        }
+    };
+}
+
+void decode_netpbm(const uint8_t* data, size_t size, Image& image){
+    if (size < 2 || data[0] != 'P'){
+        throw std::runtime_error("Invalid netpbm image: bad magic number");
+    }
+
+    const char format = data[1];
+    const bool ascii = format == '2' || format == '3';
+    const bool color = format == '3' || format == '6';
+    if (format != '2' && format != '3' && format != '5' && format != '6'){
+        throw std::runtime_error(std::string("Unsupported netpbm format: P") + format);
+    }
+
+    _Reader reader{data, size, 2};
+    image.cols = reader.number();
+    image.rows = reader.number();
+    const uint32_t maxval = reader.number();
+    if (maxval == 0 || maxval > 65535 || image.cols == 0 || image.rows == 0){
+        throw std::runtime_error("Invalid netpbm image header");
+    }
+
+    const size_t pixels = image.rows * image.cols;
+    const size_t channels = color ? 3 : 1;
+    const size_t bytes = maxval < 256 ? 1 : 2;
+    image.pixels.resize(pixels);
+
+    // single whitespace separates the header from the binary data
+    size_t position = reader.position + 1;
+    if (!ascii && position + pixels * channels * bytes > size){
+        throw std::runtime_error("Truncated netpbm image");
+    }
+
+    auto sample = [&](){
+        if (ascii){
+            return std::min(reader.number(), maxval);
+        }
+        uint32_t value = bytes == 1 ? data[position] : (data[position] << 8) | data[position + 1];
+        position += bytes;
+        return std::min(value, maxval);
+    };
+
+    for (size_t i = 0; i < pixels; i++){
+        uint32_t value;
+        if (color){
+            uint32_t r = sample(), g = sample(), b = sample();
+            value = (299 * r + 587 * g + 114 * b + 500) / 1000;
+        } else {
+            value = sample();
+        }
+        image.pixels[i] = static_cast<uint8_t>((value * 255 + maxval / 2) / maxval);
+    }
+}
+
+void resize(
+    const uint8_t* src,
+    uint8_t* dst,
+    size_t count, size_t rows, size_t cols,
+    size_t new_rows, size_t new_cols
+){
+    const size_t size = rows * cols, new_size = new_rows * new_cols;
+
+    if (rows % new_rows == 0 && cols % new_cols == 0){
+        // block average, rounded to the nearest value
+        const size_t block_rows = rows / new_rows, block_cols = cols / new_cols;
+        const uint32_t area = block_rows * block_cols;
+
+        for (size_t n = 0; n < count; n++){
+            const uint8_t* image = src + n * size;
+            uint8_t* out = dst + n * new_size;
+
+            for (size_t r = 0; r < new_rows; r++){
+                for (size_t c = 0; c < new_cols; c++){
+                    uint32_t sum = 0;
+                    for (size_t y = 0; y < block_rows; y++){
+                        const uint8_t* row = image + (r * block_rows + y) * cols + c * block_cols;
+                        for (size_t x = 0; x < block_cols; x++){
+                            sum += row[x];
+                        }
+                    }
+                    out[r * new_cols + c] = static_cast<uint8_t>((sum + area / 2) / area);
+                }
+            }
+        }
+        return;
+    }
+
+    // bilinear sampling at the pixel centers, coordinates clamped to the image
+    const float scale_y = static_cast<float>(rows) / new_rows, scale_x = static_cast<float>(cols) / new_cols;
+    const float max_y = rows - 1.0f, max_x = cols - 1.0f;
+
+    for (size_t n = 0; n < count; n++){
+        const uint8_t* image = src + n * size;
+        uint8_t* out = dst + n * new_size;
+
+        for (size_t r = 0; r < new_rows; r++){
+            float v = std::min(max_y, std::max(0.0f, (r + 0.5f) * scale_y - 0.5f));
+            size_t y0 = static_cast<size_t>(v), y1 = std::min(y0 + 1, rows - 1);
+            float fy = v - y0;
+
+            for (size_t c = 0; c < new_cols; c++){
+                float u = std::min(max_x, std::max(0.0f, (c + 0.5f) * scale_x - 0.5f));
+                size_t x0 = static_cast<size_t>(u), x1 = std::min(x0 + 1, cols - 1);
+                float fx = u - x0;
+
+                float top = image[y0 * cols + x0] + fx * (image[y0 * cols + x1] - image[y0 * cols + x0]);
+                float bottom = image[y1 * cols + x0] + fx * (image[y1 * cols + x1] - image[y1 * cols + x0]);
+                out[r * new_cols + c] = static_cast<uint8_t>(top + fy * (bottom - top) + 0.5f);
+            }
+        }
+    }
+}
+
+END_NAMESPACE
@@ -0,0 +1,132 @@
+#include <data/ImageFolderLoader.hpp>
+#include <data/MappedFile.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+
+START_NAMESPACE_DATA
+
+namespace {
+    namespace fs = std::filesystem;
+
+    bool is_netpbm(const fs::path& path){
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        return extension == ".pgm" || extension == ".ppm" || extension == ".pnm";
+    }
+
+    struct _File{
+        std::string path;
+        uint16_t label;
+    };
+}
+
+ImageFolderLoader::ImageFolderLoader():
+    _rows(28), _cols(28), _threads(0), _loaded(0), _total(0) {}
+
+ImageFolderLoader& ImageFolderLoader::load(const std::string& root){
+    _root = root;
+    return *this;
+}
+
+ImageFolderLoader& ImageFolderLoader::size(size_t rows, size_t cols){
+    _rows = rows;
+    _cols = cols;
+    return *this;
+}
+
+ImageFolderLoader& ImageFolderLoader::threads(size_t threads){
+    _threads = threads;
+    return *this;
+}
+
+Dataset ImageFolderLoader::get_dataset(){
+    if (!fs::is_directory(_root)){
+        throw std::runtime_error("Image directory doesn't exist: " + _root);
+    }
+
+    _loaded = 0;
+    _total = 0;
+    _classes.clear();
+
+    // classes, sorted so the labels don't depend on the order of the directory entries
+    for (const auto& entry : fs::directory_iterator(_root)){
+        if (entry.is_directory()){
+            _classes.push_back(entry.path().filename().string());
+        }
+    }
+    std::sort(_classes.begin(), _classes.end());
+    if (_classes.size() > UINT16_MAX){
+        throw std::runtime_error("Too many classes in: " + _root);
+    }
+
+    std::vector<_File> files;
+    for (size_t label = 0; label < _classes.size(); label++){
+        size_t first = files.size();
+        for (const auto& entry : fs::directory_iterator(fs::path(_root) / _classes[label])){
+            if (entry.is_regular_file() && is_netpbm(entry.path())){
+                files.push_back({entry.path().string(), static_cast<uint16_t>(label)});
+            }
+        }
+        std::sort(files.begin() + first, files.end(), [](const _File& a, const _File& b){
+            return a.path < b.path;
+        });
+    }
+    _total = files.size();
+
+    const size_t features = _rows * _cols;
+    std::vector<uint8_t> samples(files.size() * features);
+    std::vector<uint16_t> labels(files.size());
+
+    std::atomic<size_t> next_file(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    // Each worker holds only the file it's decoding, resized straight into its slot of the dataset
+    auto work = [&](){
+        Image image;
+        for (size_t i = next_file++; i < files.size(); i = next_file++){
+            try{
+                MappedFile file(files[i].path);
+                decode_netpbm(file.data(), file.size(), image);
+            } catch (const std::exception& e){
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error){
+                    error = std::make_exception_ptr(std::runtime_error(
+                        files[i].path + ": " + e.what()
+                    ));
+                }
+                // skip the rest of the files
+                next_file = files.size();
+                return;
+            }
+            resize(image.pixels.data(), samples.data() + i * features, 1, image.rows, image.cols, _rows, _cols);
+            labels[i] = files[i].label;
+            _loaded.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    size_t threads = _threads != 0 ? _threads : std::max(1U, std::thread::hardware_concurrency());
+    threads = std::max<size_t>(1, std::min(threads, files.size()));
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++){
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers){
+        worker.join();
+    }
+
+    if (error){
+        std::rethrow_exception(error);
+    }
+    return Dataset::owned(std::move(samples), std::move(labels), _rows, _cols, _classes.size());
+}
+
+END_NAMESPACE
@@ -0,0 +1,108 @@
+#include <data/MappedFile.hpp>
+
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#   define DATA_HAS_MMAP 1
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#else
+#   define DATA_HAS_MMAP 0
+#   include <fstream>
+#endif
+
+START_NAMESPACE_DATA
+
+MappedFile::MappedFile(): _data(nullptr), _size(0), _mapped(false) {}
+
+MappedFile::MappedFile(const std::string& path): MappedFile() {
+    (void)open(path);
+}
+
+MappedFile::~MappedFile(){
+    _close();
+}
+
+MappedFile::MappedFile(MappedFile&& other): MappedFile() {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other){
+    if (this != &other){
+        _close();
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(_mapped, other._mapped);
+    }
+    return *this;
+}
+
+void MappedFile::_close(){
+    if (_data != nullptr){
+#if DATA_HAS_MMAP
+        if (_mapped){
+            munmap(const_cast<uint8_t*>(_data), _size);
+        } else {
+            delete[] _data;
+        }
+#else
+        delete[] _data;
+#endif
+    }
+    _data = nullptr;
+    _size = 0;
+    _mapped = false;
+}
+
+MappedFile& MappedFile::open(const std::string& path){
+    _close();
+
+#if DATA_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0){
+        ::close(fd);
+        throw std::runtime_error("Could not read the size of the file: " + path);
+    }
+    _size = static_cast<size_t>(info.st_size);
+
+    if (_size == 0){
+        // mmap doesn't accept empty mappings
+        ::close(fd);
+        _data = new uint8_t[1];
+        return *this;
+    }
+
+    void* address = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED){
+        _size = 0;
+        throw std::runtime_error("Could not map the file: " + path);
+    }
+    // The datasets are read as a whole, let the OS read ahead
+    (void)madvise(address, _size, MADV_WILLNEED);
+
+    _data = static_cast<const uint8_t*>(address);
+    _mapped = true;
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()){
+        throw std::runtime_error("Could not open file: " + path);
+    }
+    _size = static_cast<size_t>(file.tellg());
+    uint8_t* buffer = new uint8_t[_size + 1];
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(buffer), _size);
+    _data = buffer;
+#endif
+    return *this;
+}
+
+END_NAMESPACE
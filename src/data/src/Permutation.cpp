@@ -0,0 +1,94 @@
+#include <data/Permutation.hpp>
+
+#include <algorithm>
+
+START_NAMESPACE_DATA
+
+// splitmix64 finalizer, used both for the key schedule and as a round function
+inline uint64_t mix(uint64_t x){
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+IndexPermutation::IndexPermutation(){
+    (void)reseed(0, 0);
+}
+
+IndexPermutation::IndexPermutation(size_t size, uint64_t seed){
+    (void)reseed(size, seed);
+}
+
+IndexPermutation& IndexPermutation::reseed(size_t size, uint64_t seed){
+    _size = size;
+
+    // smallest even number of bits that covers [0, size)
+    int bits = 1;
+    while (bits < 64 && (uint64_t(1) << bits) < size){
+        bits++;
+    }
+    _half_bits = (bits + 1) / 2;
+    _half_mask = (uint64_t(1) << _half_bits) - 1;
+
+    for (int r = 0; r < _rounds; r++){
+        seed = mix(seed);
+        _keys[r] = seed;
+    }
+    return *this;
+}
+
+uint64_t IndexPermutation::_feistel(uint64_t index) const {
+    uint64_t left = index >> _half_bits;
+    uint64_t right = index & _half_mask;
+
+    for (int r = 0; r < _rounds; r++){
+        uint64_t next = left ^ (mix(right ^ _keys[r]) & _half_mask);
+        left = right;
+        right = next;
+    }
+    return (left << _half_bits) | right;
+}
+
+size_t IndexPermutation::operator()(size_t position) const {
+    // Feistel network is a bijection on [0, 2^(2 * half_bits)), which is at most
+    // 4 times bigger than the size, so on average it takes < 4 steps to get back into the range
+    uint64_t index = position;
+    do {
+        index = _feistel(index);
+    } while (index >= _size);
+    return index;
+}
+
+uint64_t sample_seed(uint64_t seed, size_t index){
+    return mix(mix(seed) ^ index);
+}
+
+void gather(
+    const data_batch& source,
+    const IndexPermutation& order,
+    size_t begin, size_t end,
+    data_batch& staging
+){
+    end = std::min(end, source.size());
+    begin = std::min(begin, end);
+
+    staging.resize(end - begin);
+    for (size_t i = begin; i < end; i++){
+        // vector's assignment keeps the capacity, so the buffers are reused
+        staging[i - begin] = source[order(i)];
+    }
+}
+
+void gather(
+    const data_batch& source,
+    const std::vector<size_t>& indexes,
+    data_batch& staging
+){
+    staging.resize(indexes.size());
+    for (size_t i = 0; i < indexes.size(); i++){
+        staging[i] = source[indexes[i]];
+    }
+}
+
+END_NAMESPACE
@@ -0,0 +1,253 @@
+#include <data/Sampler.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <stdexcept>
+
+START_NAMESPACE_DATA
+
+void ClassSampler::_group(const uint16_t* labels, size_t size, size_t classes){
+    _class_begin.assign(classes + 1, 0);
+    for (size_t i = 0; i < size; i++){
+        if (labels[i] >= classes){
+            throw std::runtime_error("Sampler: label out of range: " + std::to_string(labels[i]));
+        }
+        _class_begin[labels[i] + 1]++;
+    }
+    for (size_t c = 0; c < classes; c++){
+        _class_begin[c + 1] += _class_begin[c];
+    }
+
+    // counting sort, keeps the order of the dataset within the class
+    std::vector<size_t> position(_class_begin.begin(), _class_begin.end() - 1);
+    _by_class.resize(size);
+    for (size_t i = 0; i < size; i++){
+        _by_class[position[labels[i]]++] = i;
+    }
+}
+
+void ClassSampler::start(uint64_t seed){
+    struct _Next{
+        double key;
+        size_t rank;
+        size_t c;
+
+        bool operator>(const _Next& other) const {
+            return key > other.key || (key == other.key && rank > other.rank);
+        }
+    };
+    using queue_t = std::priority_queue<_Next, std::vector<_Next>, std::greater<_Next>>;
+
+    const size_t classes = _visits.size();
+    const size_t active = std::count_if(_visits.begin(), _visits.end(), [](size_t v){ return v > 0; });
+
+    // Tijdeman's schedule: after n positions every class has n * visits[c] / size +- sigma visits, so any
+    // window of consecutive positions is within 2 * sigma < 2 of its share. The next visit of the class
+    // may be placed from its `release` position, and must be placed by its `deadline`, the released
+    // visit with the earliest deadline goes first.
+    const double sigma = active > 1 ? 1.0 - 1.0 / (2.0 * (active - 1)) : 0.5;
+    auto release = [&](size_t c, size_t k){ return (k + 1 - sigma) * _epoch_size / _visits[c]; };
+    auto deadline = [&](size_t c, size_t k){ return (k + sigma) * _epoch_size / _visits[c]; };
+
+    std::vector<IndexPermutation> order(classes);
+    std::vector<size_t> visited(classes, 0);
+    // ties are broken in a random order of the classes
+    IndexPermutation ranks(classes, sample_seed(seed, classes));
+    queue_t waiting, ready;
+
+    for (size_t c = 0; c < classes; c++){
+        if (_visits[c] == 0){
+            continue;
+        }
+        order[c].reseed(_class_size(c), sample_seed(seed, c));
+        waiting.push({release(c, 0), ranks(c), c});
+    }
+
+    // the whole schedule is rotated, every class gets exactly its visits, so the wrapped windows keep the bound
+    const size_t shift = _epoch_size > 0 ? sample_seed(seed, 2 * classes) % _epoch_size : 0;
+    _order.resize(_epoch_size);
+    for (size_t p = 0; p < _epoch_size; p++){
+        const double n = p + 1;
+        while (!waiting.empty() && waiting.top().key <= n){
+            size_t c = waiting.top().c;
+            ready.push({deadline(c, visited[c]), waiting.top().rank, c});
+            waiting.pop();
+        }
+        // only the rounding may leave nothing released
+        queue_t& from = ready.empty() ? waiting : ready;
+        size_t c = from.top().c;
+        from.pop();
+
+        // every cycle through the class is shuffled differently
+        size_t k = visited[c]++;
+        size_t rank = k % _class_size(c);
+        if (rank == 0 && k > 0){
+            order[c].reseed(_class_size(c), sample_seed(seed + k / _class_size(c), c));
+        }
+        _order[(p + shift) % _epoch_size] = _by_class[_class_begin[c] + order[c](rank)];
+
+        if (visited[c] < _visits[c]){
+            waiting.push({release(c, visited[c]), ranks(c), c});
+        }
+    }
+}
+
+StratifiedSampler::StratifiedSampler(const uint16_t* labels, size_t size, size_t classes){
+    _group(labels, size, classes);
+    _visits.resize(classes);
+    for (size_t c = 0; c < classes; c++){
+        _visits[c] = _class_size(c);
+    }
+    _epoch_size = size;
+}
+
+WeightedSampler::WeightedSampler(
+    const uint16_t* labels, size_t size, size_t classes,
+    const std::vector<double>& weights
+){
+    _group(labels, size, classes);
+    if (!weights.empty() && weights.size() != classes){
+        throw std::runtime_error("Sampler: expected a weight for every class");
+    }
+
+    std::vector<double> w(classes);
+    double sum = 0.0;
+    for (size_t c = 0; c < classes; c++){
+        w[c] = _class_size(c) == 0 ? 0.0 : (weights.empty() ? 1.0 : std::max(0.0, weights[c]));
+        sum += w[c];
+    }
+
+    // largest remainder, so the visits add up to the size of the dataset
+    _visits.assign(classes, 0);
+    if (sum <= 0.0){
+        return;
+    }
+    std::vector<std::pair<double, size_t>> remainders(classes);
+    size_t assigned = 0;
+    for (size_t c = 0; c < classes; c++){
+        double exact = size * w[c] / sum;
+        _visits[c] = static_cast<size_t>(exact);
+        remainders[c] = {exact - _visits[c], c};
+        assigned += _visits[c];
+    }
+    std::sort(remainders.begin(), remainders.end(), std::greater<std::pair<double, size_t>>());
+    for (size_t i = 0; assigned < size && i < classes; i++){
+        if (w[remainders[i].second] > 0.0){
+            _visits[remainders[i].second]++;
+            assigned++;
+        }
+    }
+    _epoch_size = assigned;
+}
+
+ImportanceSampler::ImportanceSampler(size_t size, double fraction, double uniform, float initial_loss):
+    _losses(size, initial_loss), _probabilities(size, size > 0 ? 1.0f / size : 0.0f),
+    _fraction(0.0), _uniform(std::min(1.0, std::max(uniform, 1e-6)))
+{
+    (void)this->fraction(fraction);
+}
+
+ImportanceSampler& ImportanceSampler::fraction(double fraction){
+    _fraction = std::min(1.0, std::max(fraction, 0.0));
+    return *this;
+}
+
+size_t ImportanceSampler::size() const {
+    if (_losses.empty()){
+        return 0;
+    }
+    return std::max<size_t>(1, static_cast<size_t>(std::lround(_fraction * _losses.size())));
+}
+
+void ImportanceSampler::start(uint64_t seed){
+    const size_t n = _losses.size();
+    const size_t draws = size();
+
+    double sum = 0.0;
+    for (float loss : _losses){
+        sum += std::max(0.0f, loss);
+    }
+    // the whole pass (warmup) is uniform, so every sample is visited (and its loss re-estimated) once
+    const bool whole = draws == n && _fraction >= 1.0;
+    const double uniform = sum > 0.0 && !whole ? _uniform : 1.0;
+    for (size_t i = 0; i < n; i++){
+        double proportional = sum > 0.0 ? std::max(0.0f, _losses[i]) / sum : 0.0;
+        _probabilities[i] = static_cast<float>((1.0 - uniform) * proportional + uniform / n);
+    }
+
+    _drawn.resize(draws);
+    if (whole){
+        // not through the cumulative sum, its rounding could drop or repeat a sample
+        for (size_t i = 0; i < n; i++){
+            _drawn[i] = i;
+        }
+    } else {
+        // systematic sampling: the draws are at (k + u) / draws of the cumulative distribution
+        const double u = (sample_seed(seed, n) >> 11) * 0x1.0p-53;
+        double cumulative = 0.0;
+        size_t k = 0;
+        for (size_t i = 0; i < n && k < draws; i++){
+            cumulative += _probabilities[i];
+            while (k < draws && (k + u) / draws < cumulative){
+                _drawn[k++] = i;
+            }
+        }
+        // rounding of the cumulative sum
+        for (; k < draws; k++){
+            _drawn[k] = n - 1;
+        }
+    }
+
+    // the draws are sorted by the index, shuffle them
+    IndexPermutation order(draws, seed);
+    _order.resize(draws);
+    for (size_t p = 0; p < draws; p++){
+        _order[p] = _drawn[order(p)];
+    }
+}
+
+std::vector<uint16_t> class_labels(const data_batch& batch){
+    std::vector<uint16_t> labels(batch.size());
+    for (size_t i = 0; i < batch.size(); i++){
+        const vector_t& expect = batch[i].expect;
+        labels[i] = static_cast<uint16_t>(std::max_element(expect.begin(), expect.end()) - expect.begin());
+    }
+    return labels;
+}
+
+namespace {
+    std::unique_ptr<Sampler> make_sampler(
+        SamplerType type, const uint16_t* labels, size_t size, size_t classes,
+        const std::vector<double>& weights
+    ){
+        switch (type)
+        {
+        case SamplerType::sequential:
+            return std::make_unique<SequentialSampler>(size);
+        case SamplerType::stratified:
+            return std::make_unique<StratifiedSampler>(labels, size, classes);
+        case SamplerType::weighted:
+            return std::make_unique<WeightedSampler>(labels, size, classes, weights);
+        case SamplerType::importance:
+            return std::make_unique<ImportanceSampler>(size);
+        default:
+            return std::make_unique<ShuffledSampler>(size);
+        }
+    }
+}
+
+std::unique_ptr<Sampler> make_sampler(SamplerType type, const Dataset& dataset, const std::vector<double>& weights){
+    return make_sampler(type, dataset.labels(), dataset.size(), dataset.classes(), weights);
+}
+
+std::unique_ptr<Sampler> make_sampler(SamplerType type, const data_batch& batch, const std::vector<double>& weights){
+    if (type == SamplerType::sequential || type == SamplerType::shuffled || type == SamplerType::importance){
+        return make_sampler(type, nullptr, batch.size(), 0, weights);
+    }
+    std::vector<uint16_t> labels = class_labels(batch);
+    size_t classes = batch.empty() ? 0 : batch[0].expect.size();
+    return make_sampler(type, labels.data(), labels.size(), classes, weights);
+}
+
+END_NAMESPACE
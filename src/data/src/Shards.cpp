@@ -0,0 +1,471 @@
+#include <data/Shards.hpp>
+
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+START_NAMESPACE_DATA
+
+namespace {
+    constexpr char SHARDS_MAGIC[] = "clife-shards";
+    constexpr int SHARDS_VERSION = 1;
+    constexpr size_t PAGE_SIZE = 4096;
+
+    std::string shard_name(size_t number){
+        char name[32];
+        std::snprintf(name, sizeof(name), "shard-%05zu.bin", number);
+        return name;
+    }
+
+    // Reads every page of the mapped shard, so the consumer never waits for the disk
+    void touch(const Dataset& data){
+        volatile uint8_t sink = 0;
+        const size_t bytes = data.size() * data.features();
+        for (size_t i = 0; i < bytes; i += PAGE_SIZE){
+            sink = sink + data.samples()[i];
+        }
+        for (size_t i = 0; i < data.size(); i += PAGE_SIZE / sizeof(uint16_t)){
+            sink = sink + data.labels()[i];
+        }
+        (void)sink;
+    }
+}
+
+// ShardWriter
+
+ShardWriter::ShardWriter(
+    const std::string& directory,
+    size_t rows, size_t cols, size_t classes,
+    size_t shard_size,
+    real_number_t scale, real_number_t offset
+):
+    _directory(directory), _shard_size(std::max<size_t>(shard_size, 1)), _total(0),
+    _layout(nullptr, nullptr, nullptr, 0, rows, cols, classes, scale, offset),
+    _finished(false)
+{
+    _buffer.resize(0, _layout);
+    _buffer.samples.reserve(_shard_size * _layout.features());
+    _buffer.labels.reserve(_shard_size);
+}
+
+ShardWriter::~ShardWriter(){
+    try {
+        finish();
+    } catch (const std::runtime_error&){}
+}
+
+ShardWriter& ShardWriter::add(const uint8_t* sample, size_t label){
+    if (_finished){
+        throw std::runtime_error("The shards are already finished: " + _directory);
+    }
+    if (label >= _layout.classes()){
+        throw std::runtime_error("Invalid label: " + std::to_string(label));
+    }
+
+    const size_t features = _layout.features();
+    _buffer.samples.insert(_buffer.samples.end(), sample, sample + features);
+    _buffer.labels.push_back(static_cast<uint16_t>(label));
+    _total++;
+
+    if (_buffer.size() == _shard_size){
+        _flush();
+    }
+    return *this;
+}
+
+ShardWriter& ShardWriter::add(const Dataset& dataset){
+    if (dataset.features() != _layout.features()){
+        throw std::runtime_error("The dataset's shape doesn't match the shards");
+    }
+    for (size_t i = 0; i < dataset.size(); i++){
+        add(dataset.sample(i), dataset.label(i));
+    }
+    return *this;
+}
+
+void ShardWriter::_flush(){
+    if (_buffer.size() == 0){
+        return;
+    }
+
+    std::string name = shard_name(_shards.size());
+    // the key of the shard is its number, so the shards can't be mixed up
+    DatasetCache::write(_directory + "/" + name, _buffer.view(), _shards.size());
+    _shards.emplace_back(name, _buffer.size());
+
+    _buffer.samples.clear();
+    _buffer.labels.clear();
+}
+
+void ShardWriter::finish(){
+    if (_finished){
+        return;
+    }
+    _finished = true;
+    _flush();
+
+    std::ofstream manifest(_directory + "/" + SHARDS_MANIFEST_FILE_NAME, std::ios::trunc);
+    if (!manifest.is_open()){
+        throw std::runtime_error("Could not create the manifest: " + _directory);
+    }
+
+    manifest << SHARDS_MAGIC << ' ' << SHARDS_VERSION << '\n'
+             << _layout.rows() << ' ' << _layout.cols() << ' ' << _layout.classes() << ' '
+             << std::setprecision(17) << _layout.scale() << ' ' << _layout.offset() << '\n'
+             << _shards.size() << '\n';
+    for (auto& shard : _shards){
+        manifest << shard.first << ' ' << shard.second << '\n';
+    }
+
+    if (!manifest.good()){
+        throw std::runtime_error("Could not write the manifest: " + _directory);
+    }
+}
+
+// ShardStream
+
+ShardStream::ShardStream():
+    _size(0), _rows(0), _cols(0), _classes(0), _scale(1.0), _offset(0.0), _memory_budget(0), _prefetch(2),
+    _seed(0), _batch_size(1), _draw_seed(0), _remaining(0), _draws(0),
+    _built(0), _consumed(0), _released(0), _finished(false),
+    _resident_bytes(0), _next_to_load(0), _loading(0), _reader_waiting(false), _stop(true),
+    _stalls(0), _stall_time(0)
+{}
+
+ShardStream::ShardStream(const std::string& directory, size_t memory_budget, size_t prefetch): ShardStream() {
+    (void)open(directory, memory_budget, prefetch);
+}
+
+ShardStream::~ShardStream(){
+    stop();
+}
+
+ShardStream& ShardStream::open(const std::string& directory, size_t memory_budget, size_t prefetch){
+    stop();
+
+    std::ifstream manifest(directory + "/" + SHARDS_MANIFEST_FILE_NAME);
+    if (!manifest.is_open()){
+        throw std::runtime_error("Could not open the manifest: " + directory);
+    }
+
+    std::string magic;
+    int version = 0;
+    size_t count = 0;
+    manifest >> magic >> version >> _rows >> _cols >> _classes >> _scale >> _offset >> count;
+    if (!manifest || magic != SHARDS_MAGIC || version != SHARDS_VERSION){
+        throw std::runtime_error("Invalid manifest: " + directory);
+    }
+
+    _directory = directory;
+    _memory_budget = memory_budget;
+    _prefetch = std::max<size_t>(prefetch, 1);
+    _shards.clear();
+    _size = 0;
+
+    const size_t features = _rows * _cols;
+    for (size_t i = 0; i < count; i++){
+        _Shard shard;
+        manifest >> shard.path >> shard.size;
+        if (!manifest){
+            throw std::runtime_error("Invalid manifest: " + directory);
+        }
+        shard.path = directory + "/" + shard.path;
+        shard.first = _size;
+        shard.bytes = shard.size * (features + sizeof(uint16_t));
+        _size += shard.size;
+        _shards.push_back(shard);
+    }
+    return *this;
+}
+
+size_t ShardStream::size() const {
+    return _size;
+}
+
+void ShardStream::start(uint64_t seed, size_t batch_size, stage_t stage){
+    stop();
+
+    _seed = seed;
+    _batch_size = std::max<size_t>(batch_size, 1);
+    _stage = stage;
+    _shard_order.reseed(_shards.size(), seed);
+    // the shards themselves use the seeds [0, shards)
+    _draw_seed = sample_seed(seed, _shards.size());
+    _window.clear();
+    _remaining = 0;
+    _draws = 0;
+    _next_to_load = 0;
+    _loading = 0;
+    _reader_waiting = false;
+    _resident_bytes = 0;
+    _stalls = 0;
+    _stall_time = std::chrono::nanoseconds(0);
+
+    _slots.resize(_prefetch);
+    for (auto& slot : _slots){
+        slot.ready = false;
+    }
+    _built = 0;
+    _consumed = 0;
+    _released = 0;
+    _finished = false;
+    _error = nullptr;
+
+    _stop = false;
+    _reader = std::thread(&ShardStream::_read_ahead, this);
+    _builder = std::thread(&ShardStream::_build, this);
+}
+
+void ShardStream::stop(){
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _freed.notify_all();
+    _loaded.notify_all();
+    _batch_freed.notify_all();
+    _batch_ready.notify_all();
+
+    if (_builder.joinable()){
+        _builder.join();
+    }
+    if (_reader.joinable()){
+        _reader.join();
+    }
+
+    _ready.clear();
+    _window.clear();
+    _remaining = 0;
+    _resident_bytes = 0;
+}
+
+void ShardStream::_read_ahead(){
+    while (true){
+        size_t shard;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_stop || _next_to_load == _shards.size()){
+                return;
+            }
+            shard = _shard_order(_next_to_load);
+            const size_t bytes = _shards[shard].bytes;
+
+            // stay within the budget, unless nothing is loaded (single shard may be bigger than the budget)
+            auto fits = [this, bytes](){
+                return _stop || _resident_bytes == 0 || _resident_bytes + bytes <= _memory_budget;
+            };
+            while (!fits()){
+                // the budget is full, the consumer may start drawing from the window
+                _reader_waiting = true;
+                _loaded.notify_all();
+                _freed.wait(lock);
+            }
+            if (_stop){
+                return;
+            }
+            _resident_bytes += bytes;
+            _next_to_load++;
+            _loading++;
+        }
+
+        _Loaded loaded;
+        loaded.shard = shard;
+        std::string reason;
+        if (DatasetCache::read(_shards[shard].path, shard, loaded.data, &reason)){
+            touch(loaded.data);
+        } else {
+            loaded.error = "Could not read the shard " + _shards[shard].path + ": " + reason;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _ready.push_back(std::move(loaded));
+            _loading--;
+        }
+        _loaded.notify_all();
+    }
+}
+
+bool ShardStream::_fill_window(){
+    std::unique_lock<std::mutex> lock(_mutex);
+    const size_t half = _memory_budget / 2;
+
+    auto ready_bytes = [this](){
+        size_t bytes = 0;
+        for (auto& loaded : _ready){
+            bytes += _shards[loaded.shard].bytes;
+        }
+        return bytes;
+    };
+    auto is_full = [&](){
+        return _stop || ready_bytes() >= half ||
+            (_loading == 0 && (_reader_waiting || _next_to_load == _shards.size()));
+    };
+    _loaded.wait(lock, is_full);
+    if (_stop){
+        return false;
+    }
+
+    // up to half of the budget (but at least one shard), the rest stays for the next window
+    size_t bytes = 0;
+    while (!_ready.empty() && (_window.empty() || bytes + _shards[_ready.front().shard].bytes <= half)){
+        bytes += _shards[_ready.front().shard].bytes;
+        _Active active;
+        active.loaded = std::move(_ready.front());
+        _ready.pop_front();
+
+        const _Shard& shard = _shards[active.loaded.shard];
+        if (!active.loaded.error.empty()){
+            throw std::runtime_error(active.loaded.error);
+        }
+        if (active.loaded.data.size() != shard.size || active.loaded.data.features() != _rows * _cols){
+            throw std::runtime_error(
+                "Invalid shard: " + shard.path + ": " + std::to_string(active.loaded.data.size()) + " samples of " +
+                std::to_string(active.loaded.data.features()) + " values, the manifest lists " +
+                std::to_string(shard.size) + " samples of " + std::to_string(_rows * _cols)
+            );
+        }
+        active.order.reseed(shard.size, sample_seed(_seed, active.loaded.shard));
+        _remaining += shard.size;
+        _window.push_back(std::move(active));
+    }
+    return !_window.empty();
+}
+
+size_t ShardStream::_draw(){
+    // uniform among the samples left in the window, the (negligible) modulo bias aside
+    size_t pick = sample_seed(_draw_seed, _draws++) % _remaining;
+    size_t active = 0;
+    while (pick >= _window[active].remaining()){
+        pick -= _window[active].remaining();
+        active++;
+    }
+    return active;
+}
+
+void ShardStream::_release(size_t active){
+    std::lock_guard<std::mutex> lock(_mutex);
+    _resident_bytes -= _shards[_window[active].loaded.shard].bytes;
+    // until the reader checks the budget again
+    _reader_waiting = false;
+    _window.erase(_window.begin() + active);
+    _freed.notify_all();
+}
+
+void ShardStream::_build(){
+    while (true){
+        size_t number;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            number = _built;
+
+            // wait until the consumer releases the batch that occupied this slot
+            _batch_freed.wait(lock, [this, number](){
+                return _stop || number < _released + _slots.size();
+            });
+            if (_stop){
+                return;
+            }
+            _slots[number % _slots.size()].ready = false;
+        }
+
+        // The slot is owned by this thread until it's marked as ready
+        _Slot& slot = _slots[number % _slots.size()];
+        bool built = false;
+        std::exception_ptr error;
+        try {
+            built = _build_batch(slot);
+        } catch (...){
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (built){
+                slot.number = number;
+                slot.ready = true;
+                _built++;
+            } else {
+                _finished = true;
+                _error = error;
+            }
+        }
+        _batch_ready.notify_all();
+        if (!built){
+            return;
+        }
+    }
+}
+
+bool ShardStream::_build_batch(_Slot& slot){
+    const size_t features = _rows * _cols;
+    slot.batch.resize(_batch_size, Dataset(nullptr, nullptr, nullptr, 0, _rows, _cols, _classes, _scale, _offset));
+    slot.indexes.resize(_batch_size);
+
+    for (size_t i = 0; i < _batch_size; i++){
+        if (_remaining == 0 && !_fill_window()){
+            return false;
+        }
+
+        const size_t shard = _draw();
+        _Active& active = _window[shard];
+        size_t local = active.order(active.position++);
+        std::memcpy(slot.batch.sample(i), active.loaded.data.sample(local), features);
+        slot.batch.labels[i] = static_cast<uint16_t>(active.loaded.data.label(local));
+        slot.indexes[i] = _shards[active.loaded.shard].first + local;
+        _remaining--;
+
+        if (active.remaining() == 0){
+            _release(shard);
+        }
+    }
+
+    if (_stage){
+        _stage(slot.batch, slot.indexes, _seed);
+    }
+    slot.view = slot.batch.view();
+    return true;
+}
+
+const Dataset* ShardStream::next(){
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    // the consumer is done with the previous batch, its slot may be refilled
+    if (_released < _consumed){
+        _released = _consumed;
+        _batch_freed.notify_all();
+    }
+    if (_stop || _slots.empty()){
+        return nullptr;
+    }
+
+    _Slot& slot = _slots[_consumed % _slots.size()];
+    auto is_ready = [this, &slot](){
+        return _stop || (slot.ready && slot.number == _consumed) || (_finished && _built == _consumed);
+    };
+    if (!is_ready()){
+        // The builder (or the reader) is the bottleneck
+        auto start = std::chrono::steady_clock::now();
+        _batch_ready.wait(lock, is_ready);
+        _stall_time += std::chrono::steady_clock::now() - start;
+        _stalls++;
+    }
+    if (_stop){
+        return nullptr;
+    }
+    if (_finished && _built == _consumed){
+        if (_error){
+            std::exception_ptr error = _error;
+            _error = nullptr;
+            std::rethrow_exception(error);
+        }
+        return nullptr;
+    }
+
+    _consumed++;
+    return &slot.view;
+}
+
+END_NAMESPACE
@@ -0,0 +1,75 @@
+#include <data/Table.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+START_NAMESPACE_DATA
+
+void Table::expect(size_t index, real_number_t* out) const {
+    if (classes == 0){
+        out[0] = targets[index];
+        return;
+    }
+    std::fill(out, out + classes, 0.0);
+    out[label(index)] = 1.0;
+}
+
+void Table::normalize(real_number_t* raw) const {
+    for (size_t c = 0; c < columns; c++){
+        const ColumnStats& column = stats[c];
+        switch (normalization)
+        {
+        case NormalizationType::min_max:{
+            real_number_t range = column.max - column.min;
+            raw[c] = range > 0 ? (raw[c] - column.min) / range : 0.0;
+            break;
+        }
+        case NormalizationType::standard:
+            raw[c] = column.deviation > 0 ? (raw[c] - column.mean) / column.deviation : 0.0;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+data_batch* Table::to_batch() const {
+    const size_t outputs = classes != 0 ? classes : 1;
+    std::unique_ptr<data_batch> batch(new data_batch(size()));
+    for (size_t i = 0; i < size(); i++){
+        Data& data = (*batch)[i];
+        data.input.assign(sample(i), sample(i) + columns);
+        data.expect.resize(outputs);
+        expect(i, data.expect.data());
+    }
+    return batch.release();
+}
+
+Dataset Table::quantize() const {
+    if (classes == 0){
+        throw std::runtime_error("Only a table with class labels can be quantized");
+    }
+
+    real_number_t min = 0, max = 0;
+    if (!values.empty()){
+        auto range = std::minmax_element(values.begin(), values.end());
+        min = *range.first;
+        max = *range.second;
+    }
+    const real_number_t scale = max > min ? (max - min) / 255.0 : 1.0;
+
+    std::vector<uint8_t> samples(values.size());
+    for (size_t i = 0; i < values.size(); i++){
+        samples[i] = static_cast<uint8_t>(std::lround((values[i] - min) / scale));
+    }
+
+    std::vector<uint16_t> labels(size());
+    for (size_t i = 0; i < size(); i++){
+        labels[i] = static_cast<uint16_t>(label(i));
+    }
+
+    return Dataset::owned(std::move(samples), std::move(labels), 1, columns, classes, scale, min);
+}
+
+END_NAMESPACE
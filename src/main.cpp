@@ -3,6 +3,12 @@
 #include <mnist/mnist.hpp>
 #include <games/games.hpp>
 #include <filesystem>
+#include <future>
+#include <chrono>
+
+#if defined(__unix__) || defined(__APPLE__)
+#   include <server/server.hpp>
+#endif
 
 static std::filesystem::path PATH;
 
@@ -12,13 +18,11 @@ void pointTest(){
 
 void showTrainingDigits(){
     // testing noisy data
-    mnist::Loader loader;
-    auto trainingImages = loader.load(PATH / mnist::MNIST_TRAINING_SET_IMAGE_FILE_NAME).get_images();
-    auto trainingLabels = loader.load(PATH / mnist::MNIST_TRAINING_SET_LABEL_FILE_NAME).get_labels();
-
-    std::unique_ptr<data::data_batch> trainingData(
-        loader.merge_data(trainingImages, trainingLabels)
+    auto trainingSet = mnist::Loader::get_dataset(
+        PATH / mnist::MNIST_TRAINING_SET_IMAGE_FILE_NAME,
+        PATH / mnist::MNIST_TRAINING_SET_LABEL_FILE_NAME
     );
+    std::unique_ptr<data::data_batch> trainingData(trainingSet.slice(0, 16).to_batch());
 
     // mnist::transformator t;
     // std::unique_ptr<data::data_batch> noisy(
@@ -28,14 +32,14 @@ void showTrainingDigits(){
 
     neural_network::ConvLayer layer;
     layer.initialize();
-    auto pixels = layer.forward(neural_network::matrix3d_t(1, neural_network::reshape(trainingData->at(10).input, 28, 28)));    
+    auto pixels = layer.forward(neural_network::Tensor({1, 28, 28}, trainingData->at(10).input));
     neural_network::MaxPoolingLayer pool;
     auto pooled = pool.forward(pixels);
     
     // pooled = layer.forward(pooled);
     // pooled = pool.forward(pooled);
     
-    auto flattened = neural_network::flatten(pooled[0]);
+    auto flattened = pooled[0].flatten().to_vector();
     
 
 
@@ -46,35 +50,17 @@ void showTrainingDigits(){
 }
 
 void digitDrawerMnist(bool use_new = false, bool train = false, std::string network_name = "mnistNetwork2"){
-    mnist::Loader loader;
-
-    auto trainingImages = loader.load(PATH / mnist::MNIST_TRAINING_SET_IMAGE_FILE_NAME).get_images();
-    auto trainingLabels = loader.load(PATH / mnist::MNIST_TRAINING_SET_LABEL_FILE_NAME).get_labels();
-    auto testImages = loader.load(PATH / mnist::MNIST_TEST_SET_IMAGE_FILE_NAME).get_images();
-    auto testLabels = loader.load(PATH / mnist::MNIST_TEST_SET_LABEL_FILE_NAME).get_labels();
-
-    std::cout << trainingImages->size() << std::endl;
-    std::cout << trainingLabels->size() << std::endl;
-    std::cout << testImages->size() << std::endl;
-    std::cout << testLabels->size() << std::endl;
-
-    std::unique_ptr<data::data_batch> trainingData(
-        loader.merge_data(trainingImages, trainingLabels)
-    );
-    std::unique_ptr<data::data_batch> testData(
-        loader.merge_data(testImages, testLabels)
-    );
+    constexpr int input_size = 28;
 
-    delete trainingImages;
-    delete trainingLabels;
-    delete testImages;
-    delete testLabels;
+    // The pixels stay as uint8 (mapped straight from the cache), the network dequantizes them in the first layer.
+    // The cache is built on the first run, set `input_size` to 14 to train on downscaled images
+    auto mnistData = mnist::Loader::load_cached(PATH.string(), input_size, input_size);
 
-    std::cout << trainingData->size() << std::endl;
-    std::cout << testData->size() << std::endl;
+    std::cout << mnistData.training.size() << std::endl;
+    std::cout << mnistData.test.size() << std::endl;
 
-    std::cout << trainingData->at(0).input.size() << std::endl;
-    std::cout << trainingData->at(0).expect.size() << std::endl;
+    std::cout << mnistData.training.features() << std::endl;
+    std::cout << mnistData.training.classes() << std::endl;
     
     // max trainingAccuracy: 0.876 "mnistNetwork" {784, 128, 64, 10} softmax relu
     // max trainingAccuracy: ~0.89 (max: 89.9) "mnistNetwork2" {784, 255, 128, 10} softmax relu
@@ -82,8 +68,6 @@ void digitDrawerMnist(bool use_new = false, bool train = false, std::string netw
 
     neural_network::ONeural* network_ptr;
 
-    constexpr int input_size = 28;
-
     if (use_new){
         network_ptr = new neural_network::ONeural(
             // {14*14, 256, 128, 32, 10}, 
@@ -97,64 +81,226 @@ void digitDrawerMnist(bool use_new = false, bool train = false, std::string netw
         network_ptr = fm.from_file();
     }
 
+    std::unique_ptr<neural_network::ONeural> network(
+        network_ptr
+    );
+
+    // The drawer classifies with the latest published snapshot, so it may be used while the network trains
+    neural_network::PublishedModel published;
+    published.publish(*network);
+
+    std::thread trainer;
     if (train)
     {
         optimizer::NeuralNetworkOptimizerParameters params;
-        params.setNeuralNetwork(network_ptr)
-            .setTrainingData(trainingData.get())
-            .setTestData(testData.get())
+        params.setNeuralNetwork(network.get())
+            .setTrainingData(&mnistData.training)
+            .setTestData(&mnistData.test)
             .setBatchSize(64)
             .setEpochs(8)
-            .setLearningRate(0.2);
-
-        optimizer::NeuralNetworkOptimizer optimizer(params);
-        optimizer.optimize();
+            .setLearningRate(0.2)
+            .setEarlyStopping(3)
+            .setPlateauReduction(2, 0.5)
+            .setKeepBest(true)
+            .setPublishedModel(&published, 100);
+
+        trainer = std::thread([params](){
+            optimizer::NeuralNetworkOptimizer optimizer(params);
+            optimizer.optimize();
+        });
     }
 
-    std::unique_ptr<neural_network::ONeural> network(
-        network_ptr
-    );
-    
-    fm.prepare(network_name)
-      .to_file(*network);
-
     ui::Drawer drawer(512, 512, input_size, input_size, true);
 
+    // the drawing is classified on every frame, use the frozen, allocation-free network
+    neural_network::PublishedModel::Reader reader(published);
+    std::vector<float> inputs(reader.plan().inputs()), outputs(reader.plan().outputs());
+
     drawer.setCallback([&](neural_network::vector_t pixels){
-        network->raw_input(pixels);
-        auto outputs = network->outputs();
-        auto guess = network->classify();
-        std::cout << "Network guess: " << guess << std::endl;
+        std::copy(pixels.begin(), pixels.end(), inputs.begin());
+        reader.plan().predict(inputs.data(), outputs.data());
+        auto guess = std::max_element(outputs.begin(), outputs.end()) - outputs.begin();
+        std::cout << "Network guess: " << guess << " (snapshot " << reader.version() << ")" << std::endl;
         for (size_t i = 0; i < outputs.size(); i++) {
             std::cout << '\t' << i << ": " << outputs[i] << std::endl;
         }
     }).open();
+
+    if (trainer.joinable()){
+        trainer.join();
+    }
+    fm.prepare(network_name)
+      .to_file(*network);
+}
+
+
+void shardedMnist(){
+    // Streams the training set from the shards, only a few of them are held in memory at once
+    auto mnistData = mnist::Loader::load_all(PATH.string());
+    auto shards = PATH / "mnist-shards";
+
+    if (!std::filesystem::exists(shards / data::SHARDS_MANIFEST_FILE_NAME)){
+        std::filesystem::create_directories(shards);
+        data::ShardWriter writer(shards.string(), 28, 28, 10, 8192);
+        writer.add(mnistData.training).finish();
+    }
+
+    data::ShardStream stream(shards.string(), 16UL << 20);
+
+    neural_network::ONeural network({28*28, 256, 128, 10}, ActivationType::softmax, ActivationType::relu, 0.2);
+    network.initialize();
+
+    optimizer::NeuralNetworkOptimizerParameters params;
+    params.setNeuralNetwork(&network)
+        .setTrainingData(&stream)
+        .setTestData(&mnistData.test)
+        .setBatchSize(64)
+        .setEpochs(2)
+        .setLearningRate(0.2);
+
+    optimizer::NeuralNetworkOptimizer(params).optimize();
 }
 
+void doodlesTest(const std::vector<std::string>& categories){
+    // Quick Draw binary files (one per category), rasterized to 28x28 in parallel
+    data::DoodlesLoader loader;
+    auto doodles = loader.get_dataset(categories, 28);
+
+    std::cout << "Loaded " << doodles.size() << " drawings in " << loader.stats().seconds << "s ("
+        << loader.stats().drawings_per_second() << " drawings/s)" << std::endl;
+}
+
+void imageFolderTest(const std::string& root){
+    // class-per-directory tree of PGM/PPM images, decoded in the background
+    data::ImageFolderLoader loader;
+    loader.load(root).size(28, 28);
+
+    auto future = std::async(std::launch::async, [&loader](){ return loader.get_dataset(); });
+    while (future.wait_for(std::chrono::milliseconds(250)) != std::future_status::ready){
+        std::cout << "\rDecoded " << loader.progress() << "/" << loader.total() << std::flush;
+    }
+    auto images = future.get();
+    std::cout << "\rDecoded " << images.size() << " images, " << loader.classes().size() << " classes" << std::endl;
+}
+
+void csvTest(const std::string& path){
+    // numeric CSV: 2 point coordinates and the class (0/1), like the `TestCreator::createPointTest` data
+    data::CsvLoader loader;
+    auto table = loader.load(path)
+        .header(true)
+        .label(2, 2)
+        .normalize(data::NormalizationType::min_max)
+        .get_table();
+
+    std::cout << "Parsed " << table.size() << " rows in " << loader.stats().seconds << "s ("
+        << loader.stats().megabytes_per_second() << " MB/s)" << std::endl;
+
+    std::unique_ptr<data::data_batch> points(table.to_batch());
+    neural_network::ONeural net({2, 10, 2}, ActivationType::softmax, ActivationType::sigmoid);
+    net.initialize();
+    net.batch_learn(points.get(), 0.6, 64);
+
+    // the linear model learns straight from the table, the class is the regression target
+    constexpr size_t batch_size = 64, epochs = 20;
+    neural_network::LinearModel linear(table.features());
+    for (size_t epoch = 0; epoch < epochs; epoch++){
+        for (size_t begin = 0; begin < table.size(); begin += batch_size){
+            linear.batch_learn(table, 0.1, begin, begin + batch_size);
+        }
+    }
+
+    double cost = 0;
+    for (size_t i = 0; i < table.size(); i++){
+        linear.set_inputs(neural_network::vector_t(table.sample(i), table.sample(i) + table.features()));
+        const double diff = linear.output() - table.targets[i];
+        cost += diff * diff;
+    }
+    std::cout << "Linear model cost: " << cost / std::max<size_t>(table.size(), 1) << std::endl;
+}
+
+void inferenceLatency(){
+    // single sample latency: the training network (outputs + classify) vs the frozen plan
+    neural_network::ONeural network({28*28, 256, 128, 10}, ActivationType::softmax, ActivationType::relu);
+    network.initialize();
+
+    auto mnistData = mnist::Loader::load_all(PATH.string());
+    neural_network::vector_t pixels(mnistData.test.features());
+    mnistData.test.dequantize(0, pixels.data());
+    std::vector<float> inputs(pixels.begin(), pixels.end()), outputs(10);
+
+    constexpr size_t runs = 1000;
+    size_t guesses = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < runs; i++){
+        network.raw_input(pixels);
+        (void)network.outputs();
+        guesses += network.classify();
+    }
+    auto network_time = std::chrono::steady_clock::now() - start;
+
+    auto plan = network.freeze();
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < runs; i++){
+        plan.predict(inputs.data(), outputs.data());
+        guesses += std::max_element(outputs.begin(), outputs.end()) - outputs.begin();
+    }
+    auto plan_time = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Network: " << std::chrono::duration<double, std::micro>(network_time).count() / runs << "us, "
+        << "frozen plan: " << std::chrono::duration<double, std::micro>(plan_time).count() / runs << "us "
+        << "(" << guesses << ")" << std::endl;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+void inferenceServer(const std::string& network_name, const std::string& socket = "/tmp/clife.sock"){
+    // serves the saved network until enter is pressed
+    server::InferenceServer srv;
+    srv.model(network_name)
+       .socket(socket)
+       .max_batch(64)
+       .max_latency(std::chrono::microseconds(500))
+       .queue_capacity(1024);
+    srv.start();
+
+    std::cout << "Serving " << network_name << " at " << socket << ", press enter to stop" << std::endl;
+    std::cin.get();
+    srv.stop();
+
+    auto stats = srv.stats();
+    std::cout << stats.requests << " requests, " << stats.batches << " batches (average "
+        << stats.average_batch() << "), " << stats.rejected << " rejected" << std::endl;
+}
+
+void serverLoadTest(const std::string& socket = "/tmp/clife.sock", size_t clients = 16){
+    // sends the mnist test images to the running `inferenceServer`
+    auto mnistData = mnist::Loader::load_all(PATH.string());
+    neural_network::vector_t pixels(mnistData.test.features());
+    std::vector<float> samples;
+    for (size_t i = 0; i < std::min<size_t>(1000, mnistData.test.size()); i++){
+        mnistData.test.dequantize(i, pixels.data());
+        samples.insert(samples.end(), pixels.begin(), pixels.end());
+    }
+
+    auto report = server::LoadGenerator()
+        .socket(socket)
+        .clients(clients)
+        .requests(2000)
+        .samples(samples, mnistData.test.features())
+        .run();
+
+    std::cout << report.requests << " requests in " << report.seconds << "s: "
+        << report.throughput() << " req/s, p50 " << report.p50 << "us, p99 " << report.p99
+        << "us, max " << report.max << "us, " << report.rejected << " rejected, "
+        << report.errors << " errors" << std::endl;
+}
+#endif
 
 void cnnTest(){
-    mnist::Loader loader;
-    auto trainingImages = loader.load(PATH / mnist::MNIST_TRAINING_SET_IMAGE_FILE_NAME).get_images();
-    auto trainingLabels = loader.load(PATH / mnist::MNIST_TRAINING_SET_LABEL_FILE_NAME).get_labels();
-    auto testImages = loader.load(PATH / mnist::MNIST_TEST_SET_IMAGE_FILE_NAME).get_images();
-    auto testLabels = loader.load(PATH / mnist::MNIST_TEST_SET_LABEL_FILE_NAME).get_labels();
-
-    std::cout << trainingImages->size() << std::endl;
-    std::cout << trainingLabels->size() << std::endl;
-    std::cout << testImages->size() << std::endl;
-    std::cout << testLabels->size() << std::endl;
-
-    std::unique_ptr<data::data_batch> trainingData(
-        loader.merge_data(trainingImages, trainingLabels)
-    );
-    std::unique_ptr<data::data_batch> testData(
-        loader.merge_data(testImages, testLabels)
-    );
+    auto mnistData = mnist::Loader::load_all(PATH.string());
 
-    delete trainingImages;
-    delete trainingLabels;
-    delete testImages;
-    delete testLabels;
+    std::unique_ptr<data::data_batch> trainingData(mnistData.training.to_batch());
+    std::unique_ptr<data::data_batch> testData(mnistData.test.to_batch());
 
     std::cout << trainingData->size() << std::endl;
     std::cout << testData->size() << std::endl;
@@ -175,7 +321,7 @@ void cnnTest(){
         for(size_t j = 0; j < numberOfBatches; j++){
             data::data_batch batch(trainingData->begin() + j * batchSize, trainingData->begin() + (j + 1) * batchSize);
             for (size_t k = 0; k < batchSize; k++){
-                cnn.backprop(reshape(batch[k].input, 1, 28, 28), batch[k].expect);
+                cnn.backprop(Tensor({1, 28, 28}, batch[k].input), batch[k].expect);
                 loss[i] += cnn.cost();
             }
             cnn.apply(0.4, batchSize);
@@ -185,9 +331,213 @@ void cnnTest(){
 
 }
 
+void convolutionBenchmark(){
+    // im2col + GEMM (`forward`, `backprop`) vs the nested loops (`forward_direct`, `backprop_direct`) on mnist digits,
+    // then Winograd vs im2col on a multi channel layer
+    using namespace neural_network;
+    auto mnistData = mnist::Loader::load_all(PATH.string());
+    const size_t images = std::min<size_t>(256, mnistData.test.size());
+
+    std::vector<Tensor> inputs;
+    for (size_t i = 0; i < images; i++){
+        inputs.push_back(Tensor({1, 28, 28}));
+        mnistData.test.dequantize(i, inputs.back().data());
+    }
+
+    auto measure = [](auto&& run){
+        auto start = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    for (int kernels : {8, 16, 32}){
+        ConvLayer layer(3, kernels, 1, 1, 1);
+        layer.initialize();
+        layer.algorithm(ConvAlgorithm::im2col);
+        Tensor partial_dervis({size_t(kernels), 28, 28}, 0.01);
+
+        double direct = measure([&](){ for (auto& input : inputs) (void)layer.forward_direct(input); });
+        double lowered = measure([&](){ for (auto& input : inputs) (void)layer.forward(input); });
+        double direct_backprop = measure([&](){ for (auto& input : inputs) layer.backprop_direct(partial_dervis, input); });
+        double lowered_backprop = measure([&](){ for (auto& input : inputs) layer.backprop(partial_dervis, input); });
+
+        std::cout << kernels << " kernels, images/s: forward " << images / direct << " -> " << images / lowered
+            << " (" << direct / lowered << "x), backprop " << images / direct_backprop << " -> " << images / lowered_backprop
+            << " (" << direct_backprop / lowered_backprop << "x)" << std::endl;
+    }
+
+    // Winograd F(2x2, 3x3) needs 4 multiplications per output instead of 9, it pays off on the layers with more
+    // input channels, here the feature maps of a first layer with 8 kernels
+    ConvLayer first(3, 8, 1, 1, 1);
+    first.initialize();
+    std::vector<Tensor> features;
+    for (auto& input : inputs){
+        features.push_back(first.forward(input));
+    }
+
+    for (int kernels : {8, 16, 32}){
+        ConvLayer layer(3, kernels, 8, 1, 1);
+        layer.initialize();
+
+        layer.algorithm(ConvAlgorithm::im2col);
+        double lowered = measure([&](){ for (auto& feature : features) (void)layer.forward(feature); });
+        layer.algorithm(ConvAlgorithm::winograd);
+        double winograd = measure([&](){ for (auto& feature : features) (void)layer.forward(feature); });
+
+        std::cout << "8 channels, " << kernels << " kernels, images/s: im2col " << images / lowered
+            << ", winograd " << images / winograd << " (" << lowered / winograd << "x)" << std::endl;
+    }
+}
+
+void fftConvolutionBenchmark(){
+    // im2col vs FFT, 8 kernels on random images of the doodle sizes, the FFT pays off with the larger kernels
+    using namespace neural_network;
+    std::default_random_engine engine(42);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+
+    for (int channels : {1, 4}){
+        for (int size : {28, 64, 128, 256}){
+            Tensor image({size_t(channels), size_t(size), size_t(size)});
+            std::generate(image.data(), image.data() + image.size(), [&](){ return dist(engine); });
+
+            for (int kernel_size : {3, 5, 7, 9, 11, 15}){
+                ConvLayer layer(kernel_size, 8, channels, 1, kernel_size / 2);
+                layer.initialize();
+                const size_t runs = size >= 128 ? 4 : 32;
+
+                double seconds[2];
+                ConvAlgorithm algorithms[2] = {ConvAlgorithm::im2col, ConvAlgorithm::fft};
+                for (int i = 0; i < 2; i++){
+                    layer.algorithm(algorithms[i]);
+                    (void)layer.forward(image);
+                    auto start = std::chrono::steady_clock::now();
+                    for (size_t run = 0; run < runs; run++){
+                        (void)layer.forward(image);
+                    }
+                    seconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / runs;
+                }
+                layer.algorithm(ConvAlgorithm::automatic);
+
+                std::cout << channels << "x" << size << "x" << size << ", " << kernel_size << "x" << kernel_size
+                    << " kernels: im2col " << seconds[0] * 1e3 << "ms, fft " << seconds[1] * 1e3 << "ms ("
+                    << seconds[0] / seconds[1] << "x), automatic: "
+                    << (layer.get_algorithm(size) == ConvAlgorithm::fft ? "fft" :
+                        layer.get_algorithm(size) == ConvAlgorithm::winograd ? "winograd" : "im2col") << std::endl;
+            }
+        }
+    }
+}
+
+void channelsLastBenchmark(){
+    // channels first vs channels last, 3x3 convolution (channels -> channels) and 2x2 max pooling of 28x28 feature maps
+    using namespace neural_network;
+    std::default_random_engine engine(42);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    constexpr size_t runs = 16;
+
+    auto measure = [](auto&& run){
+        double best = std::numeric_limits<double>::max();
+        for (int repeat = 0; repeat < 3; repeat++){
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < runs; i++){
+                run();
+            }
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / runs);
+        }
+        return best * 1e3;
+    };
+
+    for (size_t channels : {16, 32, 64}){
+        Tensor image({channels, 28, 28});
+        std::generate(image.data(), image.data() + image.size(), [&](){ return dist(engine); });
+        Tensor partial_dervis({channels, 28, 28}, 0.01), pooled_dervis({channels, 14, 14}, 0.01);
+        Tensor image_last = to_channels_last(image), partial_last = to_channels_last(partial_dervis);
+        Tensor pooled_last = to_channels_last(pooled_dervis);
+
+        ConvLayer layer(3, channels, channels, 1, 1);
+        layer.initialize();
+        MaxPoolingLayer pool(2, channels, 2, 0);
+
+        double winograd = measure([&](){ (void)layer.forward(image); });
+        layer.algorithm(ConvAlgorithm::im2col);
+        double im2col = measure([&](){ (void)layer.forward(image); });
+        double im2col_backprop = measure([&](){ layer.backprop(partial_dervis, image); });
+        double pooling = measure([&](){ (void)pool.forward(image); });
+        double pooling_backprop = measure([&](){ (void)pool.backprop(pooled_dervis); });
+
+        layer.layout(Layout::channels_last);
+        pool.layout(Layout::channels_last);
+        double last = measure([&](){ (void)layer.forward(image_last); });
+        double last_backprop = measure([&](){ layer.backprop(partial_last, image_last); });
+        double pooling_last = measure([&](){ (void)pool.forward(image_last); });
+        double pooling_last_backprop = measure([&](){ (void)pool.backprop(pooled_last); });
+
+        std::cout << channels << " channels, ms: conv forward im2col " << im2col << ", winograd " << winograd
+            << ", channels last " << last << " (" << im2col / last << "x im2col), backprop " << im2col_backprop
+            << " -> " << last_backprop << " (" << im2col_backprop / last_backprop << "x); pool forward " << pooling
+            << " -> " << pooling_last << " (" << pooling / pooling_last << "x), backprop " << pooling_backprop
+            << " -> " << pooling_last_backprop << std::endl;
+    }
+}
+
+void fusedConvolutionBenchmark(){
+    // convolution, ReLU and max pooling as separate passes vs `ConvLayer::forward_pooled`, in both layouts
+    using namespace neural_network;
+    std::default_random_engine engine(42);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    constexpr size_t runs = 16;
+
+    auto measure = [](auto&& run){
+        double best = std::numeric_limits<double>::max();
+        for (int repeat = 0; repeat < 3; repeat++){
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < runs; i++){
+                run();
+            }
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / runs);
+        }
+        return best * 1e3;
+    };
+
+    for (Layout layout : {Layout::channels_first, Layout::channels_last}){
+        for (size_t channels : {1, 8}){
+            for (size_t kernels : {8, 32}){
+                for (size_t size : {28, 64}){
+                    Tensor image({channels, size, size});
+                    std::generate(image.data(), image.data() + image.size(), [&](){ return dist(engine); });
+                    if (layout == Layout::channels_last){
+                        image = to_channels_last(image);
+                    }
+
+                    ConvLayer layer(3, kernels, channels, 1, 1);
+                    layer.initialize();
+                    layer.layout(layout).algorithm(ConvAlgorithm::im2col);
+                    MaxPoolingLayer pool(2, kernels, 2, 0);
+                    pool.layout(layout);
+
+                    double separate = measure([&](){
+                        Tensor output = layer.forward(image);
+                        std::for_each(output.data(), output.data() + output.size(), [](double& x){ x = std::max(x, 0.0); });
+                        (void)pool.forward(output);
+                    });
+                    double fused = measure([&](){ (void)layer.forward_pooled(image, pool); });
+
+                    std::cout << (layout == Layout::channels_last ? "channels last, " : "channels first, ") << channels
+                        << " -> " << kernels << " channels, " << size << "x" << size << ", ms: separate " << separate
+                        << ", fused " << fused << " (" << separate / fused << "x)" << std::endl;
+                }
+            }
+        }
+    }
+}
+
 int main(int argc, char** argv)
 {
     // cnnTest();
+    // convolutionBenchmark();
+    // fftConvolutionBenchmark();
+    // channelsLastBenchmark();
+    // fusedConvolutionBenchmark();
     PATH = std::filesystem::path(argv[0]).parent_path();
     digitDrawerMnist(true, true, "digitMT");
 
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <data/types.hpp>
+#include "namespaces.hpp"
+
+START_NAMESPACE_MNIST
+
+/**
+ * @brief Affine transformation used by `warp_affine`, maps the destination pixel (x, y)
+ * to the source pixel:
+ *      source_x = a * x + b * y + tx
+ *      source_y = c * x + d * y + ty
+*/
+struct Affine{
+    float a, b, c, d;
+    float tx, ty;
+
+    static Affine identity();
+
+    /**
+     * @brief Creates the inverse mapping of: shear -> scale -> rotation around (center_x, center_y),
+     * then translation by (shift_x, shift_y)
+     * @param angle rotation angle in radians
+     * @param scale scale factor (1 = no scaling)
+     * @param shear horizontal shear factor (0 = no shear)
+    */
+    static Affine make(
+        float angle, float scale, float shear,
+        float shift_x, float shift_y,
+        float center_x, float center_y
+    );
+};
+
+/*
+
+Augmentation kernels, each one processes `count` images at once, stored contiguously:
+image `n` starts at `images + n * rows * cols`, pixels are stored row by row.
+
+*/
+
+/**
+ * @brief Moves every image by an integer vector, pixels moved outside are lost, the uncovered ones are 0.
+ * Implemented as row copies.
+ * @param src source images
+ * @param dst destination images, must not overlap with `src`
+ * @param dx horizontal shift of each image (`count` values)
+ * @param dy vertical shift of each image (`count` values)
+*/
+void shift(
+    const data::real_number_t* src,
+    data::real_number_t* dst,
+    size_t count, size_t rows, size_t cols,
+    const int* dx, const int* dy
+);
+
+/**
+ * @brief Applies affine transformation to every image (rotation, scale, shear, translation),
+ * using bilinear sampling, pixels outside the source image are treated as 0.
+ * @param src source images
+ * @param dst destination images, must not overlap with `src`
+ * @param transforms transformation of each image (`count` values)
+*/
+void warp_affine(
+    const data::real_number_t* src,
+    data::real_number_t* dst,
+    size_t count, size_t rows, size_t cols,
+    const Affine* transforms
+);
+
+/**
+ * @brief Adds random noise in place to every image, on [noisiness / 2, noisiness] random pixels
+ * of each image, values are clamped to 1.
+ * @param seeds seed of each image (`count` values), the same seed gives the same noise
+ * @param max_noise maximum value added to a pixel
+*/
+void add_noise(
+    data::real_number_t* images,
+    size_t count, size_t rows, size_t cols,
+    const uint64_t* seeds,
+    size_t noisiness,
+    data::real_number_t max_noise = 0.9
+);
+
+END_NAMESPACE_MNIST
@@ -5,6 +5,7 @@
 #include <vector>
 #include <algorithm> 
 #include <memory>
+#include <future>
 
 #include <data/data.hpp>
 #include "namespaces.hpp"
@@ -23,6 +24,44 @@ constexpr char MNIST_TRAINING_SET_LABEL_FILE_NAME[] = "train-labels.idx1-ubyte";
 constexpr char MNIST_TEST_SET_IMAGE_FILE_NAME[] = "t10k-images.idx3-ubyte";
 constexpr char MNIST_TEST_SET_LABEL_FILE_NAME[] = "t10k-labels.idx1-ubyte";
 
+/**
+ * @brief Memory mapped IDX file (http://yann.lecun.com/exdb/mnist/), only the unsigned byte type is supported.
+ * The header is parsed on `open`, the data block is accessed in place.
+*/
+class IdxFile{
+    data::MappedFile _file;
+    std::vector<size_t> _dims;
+    int32_t _magic = 0;
+
+    public:
+    IdxFile() = default;
+    explicit IdxFile(const std::string& path);
+
+    /**
+     * @brief Maps the file and reads its header
+     * @throw std::runtime_error if the file can't be opened, or it's not a valid ubyte IDX file
+    */
+    IdxFile& open(const std::string& path);
+
+    /// @brief Magic number of the file (2051 for MNIST images, 2049 for labels)
+    inline int32_t magic() const { return _magic; }
+
+    /// @brief Dimensions of the data, first one is the number of the items
+    inline const std::vector<size_t>& dims() const { return _dims; }
+
+    /// @brief Number of the items (first dimension)
+    inline size_t count() const { return _dims.empty() ? 0 : _dims[0]; }
+
+    /// @brief Raw data block (after the header)
+    const uint8_t* data() const;
+};
+
+/// @brief Training and test sets of the MNIST
+struct MnistDatasets{
+    data::Dataset training;
+    data::Dataset test;
+};
+
 class Loader{
 
     std::string path;
@@ -50,6 +89,36 @@ public:
      *       where the index of the element with the highest value (==1) is the label
     */
     data::matrix_t* get_labels();
+
+    /**
+     * @brief Maps the image and label files and returns them as a dataset.
+     * Pixels are not copied nor normalized, the dataset dequantizes them with scale 1/255.
+    */
+    static data::Dataset get_dataset(
+        const std::string& images_path,
+        const std::string& labels_path
+    );
+
+    /**
+     * @brief Loads all 4 MNIST files from the `directory` concurrently
+    */
+    static MnistDatasets load_all(const std::string& directory);
+
+    /**
+     * @brief `load_all` through the binary dataset cache (see `data::DatasetCache`).
+     * The images are resized to `rows` x `cols` (if it's not 28x28), every size has its own cache files.
+     * The caches are rebuilt whenever the content of the MNIST files changes.
+     * @param directory directory with the MNIST files
+     * @param cache_directory where to store the caches, the `directory` if empty
+    */
+    static MnistDatasets load_cached(
+        const std::string& directory,
+        size_t rows = 28, size_t cols = 28,
+        const std::string& cache_directory = ""
+    );
+
+    /// @brief Returns new dataset with the images resized to `rows` x `cols`
+    static data::Dataset resize(const data::Dataset& dataset, size_t rows, size_t cols);
 };
 
 END_NAMESPACE_MNIST
\ No newline at end of file
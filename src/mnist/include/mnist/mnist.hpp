@@ -1,4 +1,5 @@
 #pragma once
 
 #include "loader.hpp"
-#include "transformator.hpp"
\ No newline at end of file
+#include "transformator.hpp"
+#include "kernels.hpp"
\ No newline at end of file
@@ -1,12 +1,41 @@
 #pragma once
 
 #include "loader.hpp"
+#include "kernels.hpp"
 #include <random>
 
 START_NAMESPACE_MNIST
 
+/// @brief Ranges of the random augmentation, every sample draws its own values uniformly from them
+struct AugmentParams{
+    // maximum shift in pixels, in both directions
+    int max_shift = 5;
+    // maximum rotation angle in degrees
+    float max_angle = 15.0f;
+    // maximum relative change of the scale (0.1 -> [0.9, 1.1])
+    float max_scale = 0.1f;
+    // maximum horizontal shear factor
+    float max_shear = 0.1f;
+    // maximum number of noisy pixels
+    size_t noisiness = 196;
+    // maximum value added to a noisy pixel
+    data::real_number_t max_noise = 0.9;
+};
+
 /// @brief Class for adding noise to the data
 class transformator{
+    // Draws the random parameters of every sample and runs the kernels on `count` packed images
+    void _augment_packed(
+        const data::real_number_t* packed,
+        data::real_number_t* augmented,
+        size_t count,
+        const std::vector<size_t>& indexes,
+        uint64_t seed,
+        const AugmentParams& params,
+        size_t cols,
+        size_t rows
+    ) const;
+
     public:
     transformator() = default;
 
@@ -14,7 +43,7 @@ class transformator{
      * @brief
      * Add noise to the data:
      *  * Moves the pixels at random.
-     *  * Rotates the pixels at random.
+     *  * Rotates, scales and shears the pixels at random.
      *  * Adds random noise to the pixels.
      * 
      * @param data The data to add noise to
@@ -22,37 +51,68 @@ class transformator{
      * @return new `noisy` data
     */
     data::data_batch* add_noise(
-        data::data_batch* data, 
+        const data::data_batch* data, 
         int max_vector = 6,
         size_t cols = 28,
         size_t rows = 28,
         size_t noisiness = 200
     );
 
+    /**
+     * @brief Augments the whole batch in place, with a single affine warp (or shift, if there is no
+     * rotation, scaling and shear) and additive noise, see `kernels.hpp`.
+     * The result of every sample depends only on the `seed` and its index, so it may be called
+     * from any thread, in any order
+     * @param batch the images to augment
+     * @param indexes dataset index of every sample in the batch
+     * @param seed seed of the epoch, see `data::sample_seed`
+     * @param params ranges of the random transformations
+    */
+    void augment(
+        data::data_batch& batch,
+        const std::vector<size_t>& indexes,
+        uint64_t seed,
+        const AugmentParams& params = AugmentParams(),
+        size_t cols = 28,
+        size_t rows = 28
+    ) const;
+
+    /**
+     * @brief `augment` of the quantized batch, the images are dequantized into scratch buffers,
+     * transformed by the same kernels and quantized back (rounded to the nearest level)
+    */
+    void augment(
+        data::QuantizedBatch& batch,
+        const std::vector<size_t>& indexes,
+        uint64_t seed,
+        const AugmentParams& params = AugmentParams()
+    ) const;
+
     /**
      * @brief Rotate the pixels by angle and given center point
+     * @param angle rotation angle in radians
      * @returns new vector of pixels
     */
     data::vector_t rotate(
-        data::vector_t& pixels,
+        const data::vector_t& pixels,
         size_t cols = 28,
         size_t rows = 28,
         float angle = 30.0f,
         int center_x = 14,
         int center_y = 14
-    );
+    ) const;
 
     /**
      * @brief Move the pixels by x and y
      * @returns new vector of pixels
     */
     data::vector_t move(
-        data::vector_t& pixels,
+        const data::vector_t& pixels,
         size_t cols = 28,
         size_t rows = 28,
         int x = 0,
         int y = 0
-    );
+    ) const;
 };
 
 END_NAMESPACE_MNIST
\ No newline at end of file
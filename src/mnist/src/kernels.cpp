@@ -0,0 +1,170 @@
+#include <mnist/kernels.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+START_NAMESPACE_MNIST
+
+using data::real_number_t;
+
+// Small, fast generator (splitmix64), each image gets its own state
+struct _SplitMix{
+    uint64_t state;
+
+    inline uint64_t next(){
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // uniform value in [0, range)
+    inline size_t below(size_t range){
+        return static_cast<size_t>((next() >> 32) * range >> 32);
+    }
+
+    // uniform value in [0, 1)
+    inline real_number_t uniform(){
+        return static_cast<real_number_t>(next() >> 11) * 0x1.0p-53;
+    }
+};
+
+Affine Affine::identity(){
+    return {1, 0, 0, 1, 0, 0};
+}
+
+Affine Affine::make(
+    float angle, float scale, float shear,
+    float shift_x, float shift_y,
+    float center_x, float center_y
+){
+    // forward: destination = M * (source - center) + center + shift, where
+    // M = rotation * scale * shear = scale * [cos, cos * shear - sin]
+    //                                        [sin, sin * shear + cos]
+    float cos_a = std::cos(angle), sin_a = std::sin(angle);
+    float m00 = scale * cos_a, m01 = scale * (cos_a * shear - sin_a);
+    float m10 = scale * sin_a, m11 = scale * (sin_a * shear + cos_a);
+    float inv_det = 1.0f / (scale * scale);
+
+    // backward: source = M^-1 * destination + (center - M^-1 * (center + shift))
+    Affine t;
+    t.a = m11 * inv_det;
+    t.b = -m01 * inv_det;
+    t.c = -m10 * inv_det;
+    t.d = m00 * inv_det;
+
+    float px = center_x + shift_x, py = center_y + shift_y;
+    t.tx = center_x - (t.a * px + t.b * py);
+    t.ty = center_y - (t.c * px + t.d * py);
+    return t;
+}
+
+void shift(
+    const real_number_t* src,
+    real_number_t* dst,
+    size_t count, size_t rows, size_t cols,
+    const int* dx, const int* dy
+){
+    const int irows = static_cast<int>(rows), icols = static_cast<int>(cols);
+    const size_t size = rows * cols;
+
+    for (size_t n = 0; n < count; n++){
+        const real_number_t* image = src + n * size;
+        real_number_t* out = dst + n * size;
+
+        // horizontal shift is the same for every row: copy `width` pixels
+        // from column `from` to column `to`, the rest of the row is 0
+        int x = std::max(-icols, std::min(icols, dx[n]));
+        size_t width = cols - std::abs(x);
+        size_t from = x < 0 ? -x : 0, to = x > 0 ? x : 0;
+
+        for (int r = 0; r < irows; r++){
+            real_number_t* row = out + r * cols;
+            int source_row = r - dy[n];
+
+            if (source_row < 0 || source_row >= irows){
+                std::fill(row, row + cols, 0.0);
+                continue;
+            }
+
+            std::fill(row, row + to, 0.0);
+            std::memcpy(row + to, image + source_row * cols + from, width * sizeof(real_number_t));
+            std::fill(row + to + width, row + cols, 0.0);
+        }
+    }
+}
+
+void warp_affine(
+    const real_number_t* src,
+    real_number_t* dst,
+    size_t count, size_t rows, size_t cols,
+    const Affine* transforms
+){
+    // The source image is copied into a zero padded buffer (1 pixel on the left/top, 2 on the right/bottom),
+    // the sampling coordinates are clamped to [-1, size], so the inner loop reads the 4 neighbours
+    // without any bounds check (and branches), outside pixels just read the zero padding
+    const size_t padded_cols = cols + 3, padded_rows = rows + 3;
+    std::vector<real_number_t> padded(padded_cols * padded_rows, 0.0);
+
+    const float max_x = static_cast<float>(cols), max_y = static_cast<float>(rows);
+    const size_t size = rows * cols;
+
+    for (size_t n = 0; n < count; n++){
+        const real_number_t* image = src + n * size;
+        real_number_t* out = dst + n * size;
+        const Affine& t = transforms[n];
+
+        for (size_t r = 0; r < rows; r++){
+            std::memcpy(&padded[(r + 1) * padded_cols + 1], image + r * cols, cols * sizeof(real_number_t));
+        }
+
+        const real_number_t* base = padded.data() + padded_cols + 1;
+
+        for (size_t r = 0; r < rows; r++){
+            const float row_x = t.b * r + t.tx;
+            const float row_y = t.d * r + t.ty;
+            real_number_t* row = out + r * cols;
+
+            for (size_t c = 0; c < cols; c++){
+                float u = std::min(max_x, std::max(-1.0f, row_x + t.a * c));
+                float v = std::min(max_y, std::max(-1.0f, row_y + t.c * c));
+
+                // u, v >= -1 so the truncation of (u + 1) is the floor
+                int x0 = static_cast<int>(u + 1.0f) - 1;
+                int y0 = static_cast<int>(v + 1.0f) - 1;
+                real_number_t fx = u - x0, fy = v - y0;
+
+                const real_number_t* p = base + y0 * static_cast<ptrdiff_t>(padded_cols) + x0;
+                real_number_t top = p[0] + fx * (p[1] - p[0]);
+                real_number_t bottom = p[padded_cols] + fx * (p[padded_cols + 1] - p[padded_cols]);
+                row[c] = top + fy * (bottom - top);
+            }
+        }
+    }
+}
+
+void add_noise(
+    real_number_t* images,
+    size_t count, size_t rows, size_t cols,
+    const uint64_t* seeds,
+    size_t noisiness,
+    real_number_t max_noise
+){
+    const size_t size = rows * cols;
+    const size_t min_noises = noisiness / 2;
+
+    for (size_t n = 0; n < count; n++){
+        real_number_t* image = images + n * size;
+        _SplitMix rng{seeds[n]};
+
+        size_t noises = min_noises + rng.below(noisiness - min_noises + 1);
+        for (size_t j = 0; j < noises; j++){
+            real_number_t& pixel = image[rng.below(size)];
+            pixel = std::min<real_number_t>(1.0, pixel + max_noise * rng.uniform());
+        }
+    }
+}
+
+END_NAMESPACE_MNIST
@@ -11,46 +11,103 @@ Loader& Loader::load(const std::string& path){
     return *this;
 }
 
-data::matrix_t* Loader::get_images(){
-    std::ifstream file(path, std::ios::binary);
-    if(!file.is_open()){
-        throw std::runtime_error("Could not open file: " + path);
+namespace {
+    // IDX header values are stored as big endian
+    inline uint32_t read_big_endian(const uint8_t* p){
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
     }
 
-    int magic_number = 0;
-    int number_of_images = 0;
-    int n_rows = 0;
-    int n_cols = 0;
+    constexpr uint8_t IDX_UNSIGNED_BYTE = 0x08;
+
+    // Keeps the mapped files and the widened labels alive as long as any dataset uses them
+    struct _MnistStorage{
+        IdxFile images;
+        IdxFile labels;
+        std::vector<uint16_t> classes;
+    };
+
+    data::Dataset make_dataset(IdxFile&& images, IdxFile&& labels){
+        if (images.magic() != MNIST_MAGIC_NUMBER || images.dims().size() != 3){
+            throw std::runtime_error("Invalid MNIST image file!");
+        }
+        if (labels.magic() != MNIST_LABEL_MAGIC_NUMBER){
+            throw std::runtime_error("Invalid MNIST label file!");
+        }
+        if (images.count() != labels.count()){
+            throw std::runtime_error("Number of images and labels does not match!");
+        }
+
+        auto storage = std::make_shared<_MnistStorage>();
+        storage->images = std::move(images);
+        storage->labels = std::move(labels);
+
+        const size_t count = storage->labels.count();
+        const uint8_t* raw = storage->labels.data();
+        storage->classes.assign(raw, raw + count);
+
+        const uint8_t* samples = storage->images.data();
+        const uint16_t* classes = storage->classes.data();
+        size_t rows = storage->images.dims()[1], cols = storage->images.dims()[2];
+
+        return data::Dataset(storage, samples, classes, count, rows, cols, 10);
+    }
+}
 
-    file.read(reinterpret_cast<char*>(&magic_number), sizeof(magic_number));
-    file.read(reinterpret_cast<char*>(&number_of_images), sizeof(number_of_images));
-    file.read(reinterpret_cast<char*>(&n_rows), sizeof(n_rows));
-    file.read(reinterpret_cast<char*>(&n_cols), sizeof(n_cols));
+IdxFile::IdxFile(const std::string& path){
+    (void)open(path);
+}
 
-    // Convert from big endian to little endian
-    magic_number = __builtin_bswap32(magic_number);
-    number_of_images = __builtin_bswap32(number_of_images);
-    n_rows = __builtin_bswap32(n_rows);
-    n_cols = __builtin_bswap32(n_cols);
+IdxFile& IdxFile::open(const std::string& path){
+    _file.open(path);
+    _dims.clear();
 
-    if(magic_number != MNIST_MAGIC_NUMBER){
-        throw std::runtime_error("Invalid MNIST image file!");
+    const uint8_t* header = _file.data();
+    if (_file.size() < 4 || header[0] != 0 || header[1] != 0){
+        throw std::runtime_error("Invalid IDX file: " + path);
+    }
+    if (header[2] != IDX_UNSIGNED_BYTE){
+        throw std::runtime_error("Unsupported IDX data type: " + path);
     }
 
-    int image_size = n_rows * n_cols;
-    std::unique_ptr<data::matrix_t> images(
-        new data::matrix_t(number_of_images, data::vector_t(image_size))
-    );
-    
+    size_t ndims = header[3];
+    if (_file.size() < 4 * (ndims + 1)){
+        throw std::runtime_error("Truncated IDX header: " + path);
+    }
+
+    _magic = static_cast<int32_t>(read_big_endian(header));
+    size_t total = 1;
+    for (size_t i = 0; i < ndims; i++){
+        _dims.push_back(read_big_endian(header + 4 * (i + 1)));
+        total *= _dims.back();
+    }
+
+    if (_file.size() - 4 * (ndims + 1) < total){
+        throw std::runtime_error("Truncated IDX file: " + path);
+    }
+    return *this;
+}
+
+const uint8_t* IdxFile::data() const {
+    return _file.data() + 4 * (_dims.size() + 1);
+}
+
+data::matrix_t* Loader::get_images(){
+    IdxFile file(path);
+    if(file.magic() != MNIST_MAGIC_NUMBER || file.dims().size() != 3){
+        throw std::runtime_error("Invalid MNIST image file!");
+    }
 
-    for(int i = 0; i < number_of_images; i++){
-        std::vector<uint8_t> image(image_size);
-        file.read(reinterpret_cast<char*>(image.data()), image_size);
+    const size_t number_of_images = file.count();
+    const size_t image_size = file.dims()[1] * file.dims()[2];
+    const uint8_t* pixels = file.data();
 
-        std::transform(image.begin(), image.end(), (*images)[i].begin(), [](uint8_t pixel){
-            return static_cast<double>(pixel) / 255.0f; // Normalize to [0, 1]
+    std::unique_ptr<data::matrix_t> images(new data::matrix_t(number_of_images));
+    for(size_t i = 0; i < number_of_images; i++){
+        const uint8_t* image = pixels + i * image_size;
+        (*images)[i].resize(image_size);
+        std::transform(image, image + image_size, (*images)[i].begin(), [](uint8_t pixel){
+            return static_cast<double>(pixel) / 255.0; // Normalize to [0, 1]
         });
-        std::cout << std::endl;
     }
 
     return images.release();
@@ -60,37 +117,102 @@ data::matrix_t* Loader::get_images(){
  * @brief Get the labels object
 */
 data::matrix_t* Loader::get_labels(){
-    std::ifstream file(path, std::ios::binary);
-    if(!file.is_open()){
-        throw std::runtime_error("Could not open file: " + path);
-    }
-
-    int32_t magic_number = 0;
-    int32_t num_labels = 0;
-    file.read(reinterpret_cast<char*>(&magic_number), sizeof(magic_number));
-    file.read(reinterpret_cast<char*>(&num_labels), sizeof(num_labels));
-
-    // Convert from big endian to little endian
-    magic_number = __builtin_bswap32(magic_number);
-    num_labels = __builtin_bswap32(num_labels);
-
-    if(magic_number != MNIST_LABEL_MAGIC_NUMBER){
+    IdxFile file(path);
+    if(file.magic() != MNIST_LABEL_MAGIC_NUMBER){
         throw std::runtime_error("Invalid MNIST label file!");
     }
 
-    std::vector<uint8_t> labels(num_labels);
-    file.read(reinterpret_cast<char*>(labels.data()), num_labels);
+    const size_t num_labels = file.count();
+    const uint8_t* labels = file.data();
 
     std::unique_ptr<data::matrix_t> labels_double(
         new data::matrix_t(num_labels, data::vector_t(10, 0))
     );
-    for(int i = 0; i < num_labels; i++){
+    for(size_t i = 0; i < num_labels; i++){
         (*labels_double)[i][labels[i]] = 1;
     }
 
     return labels_double.release();
 }
 
+data::Dataset Loader::get_dataset(
+    const std::string& images_path,
+    const std::string& labels_path
+){
+    return make_dataset(IdxFile(images_path), IdxFile(labels_path));
+}
+
+MnistDatasets Loader::load_all(const std::string& directory){
+    const std::string root = directory.empty() ? "" : directory + "/";
+
+    auto open = [](std::string path){
+        return IdxFile(path);
+    };
+
+    // Mapping is cheap, but the headers are validated and pages prefetched (MADV_WILLNEED),
+    // so the files are opened concurrently
+    auto training_images = std::async(std::launch::async, open, root + MNIST_TRAINING_SET_IMAGE_FILE_NAME);
+    auto training_labels = std::async(std::launch::async, open, root + MNIST_TRAINING_SET_LABEL_FILE_NAME);
+    auto test_images = std::async(std::launch::async, open, root + MNIST_TEST_SET_IMAGE_FILE_NAME);
+    auto test_labels = std::async(std::launch::async, open, root + MNIST_TEST_SET_LABEL_FILE_NAME);
+
+    MnistDatasets datasets;
+    datasets.training = make_dataset(training_images.get(), training_labels.get());
+    datasets.test = make_dataset(test_images.get(), test_labels.get());
+    return datasets;
+}
+
+data::Dataset Loader::resize(const data::Dataset& dataset, size_t rows, size_t cols){
+    std::vector<uint8_t> samples(dataset.size() * rows * cols);
+    std::vector<uint16_t> labels(dataset.labels(), dataset.labels() + dataset.size());
+
+    data::resize(
+        dataset.samples(), samples.data(), dataset.size(),
+        dataset.rows(), dataset.cols(), rows, cols
+    );
+    return data::Dataset::owned(
+        std::move(samples), std::move(labels),
+        rows, cols, dataset.classes(), dataset.scale(), dataset.offset()
+    );
+}
+
+MnistDatasets Loader::load_cached(
+    const std::string& directory,
+    size_t rows, size_t cols,
+    const std::string& cache_directory
+){
+    const std::string root = directory.empty() ? "" : directory + "/";
+    const std::string cache_root = cache_directory.empty() ? root : cache_directory + "/";
+    const std::string variant = std::to_string(rows) + "x" + std::to_string(cols);
+
+    auto load = [&](const std::string& name, const std::string& images, const std::string& labels){
+        // the key covers the source files and the preprocessing
+        uint64_t key = data::content_hash(variant.data(), variant.size());
+        key = data::content_hash({images, labels}, key);
+
+        return data::DatasetCache::load_or_build(
+            cache_root + name + "-" + variant + ".cache", key,
+            [&](){
+                data::Dataset dataset = get_dataset(images, labels);
+                if (dataset.rows() != rows || dataset.cols() != cols){
+                    dataset = resize(dataset, rows, cols);
+                }
+                return dataset;
+            }
+        );
+    };
+
+    auto training = std::async(std::launch::async, load, "mnist-train",
+        root + MNIST_TRAINING_SET_IMAGE_FILE_NAME, root + MNIST_TRAINING_SET_LABEL_FILE_NAME);
+    auto test = std::async(std::launch::async, load, "mnist-test",
+        root + MNIST_TEST_SET_IMAGE_FILE_NAME, root + MNIST_TEST_SET_LABEL_FILE_NAME);
+
+    MnistDatasets datasets;
+    datasets.training = training.get();
+    datasets.test = test.get();
+    return datasets;
+}
+
 data::data_batch* Loader::merge_data(
     data::matrix_t* images,
     data::matrix_t* labels
@@ -4,119 +4,177 @@ START_NAMESPACE_MNIST
 
 
 data::data_batch* transformator::add_noise(
-    data::data_batch* data,
+    const data::data_batch* data,
     int max_vector,
     size_t cols,
     size_t rows,
     size_t noisiness
 ){
-    std::uniform_int_distribution<int> dist(-max_vector, max_vector);
-    std::uniform_int_distribution<size_t> noise_index_gen(0, rows*cols);
-    std::uniform_int_distribution<size_t> number_of_noise_gen(noisiness*0.5, noisiness);
-    std::uniform_real_distribution<double> noise(0, 0.9);
-    std::default_random_engine engine(std::random_device{}());
-    
-    // constexpr float RADIANS = 0.0174532925f;
+    constexpr size_t chunk_size = 256;
+
+    AugmentParams params;
+    params.max_shift = max_vector;
+    params.noisiness = noisiness;
+
+    uint64_t seed = std::random_device{}();
 
     std::unique_ptr<data::data_batch> noisy(
         new data::data_batch(*data));
 
-    int size = noisy->size();
-    int x, y;
-
-    for (int i = 0; i < size; ++i){
-        // get random x and y, the movement vector
-        x = dist(engine);
-        y = dist(engine);
-        
-        // copy the pixels
-        auto pixels = (*noisy)[i].input;
-        // move the pixels
-        data::vector_t new_pixels = move(pixels, cols, rows, x, y);
-
-        // add random rotation
-        // std::uniform_real_distribution angle_dist(-30.0f, 30.0f);
-        // new_pixels = rotate(
-        //     new_pixels, cols, rows, angle_dist(engine) * RADIANS
-        // );
-        
-        // add random noise
-        size_t noises = number_of_noise_gen(engine);
-        for (size_t j = 0; j < noises; j++){
-            auto idx = noise_index_gen(engine);
-            new_pixels[idx] = std::min(1.0, new_pixels[idx] + noise(engine));
+    // augment in chunks, to keep the kernels' buffers small
+    size_t size = noisy->size();
+    data::data_batch chunk;
+    std::vector<size_t> indexes;
+
+    for (size_t begin = 0; begin < size; begin += chunk_size){
+        size_t end = std::min(begin + chunk_size, size);
+        chunk.assign(noisy->begin() + begin, noisy->begin() + end);
+        indexes.resize(end - begin);
+        for (size_t i = begin; i < end; i++){
+            indexes[i - begin] = i;
         }
 
-        (*noisy)[i].input = new_pixels;
+        augment(chunk, indexes, seed, params, cols, rows);
+        std::copy(chunk.begin(), chunk.end(), noisy->begin() + begin);
     }
     return noisy.release();
 }
 
+void transformator::augment(
+    data::data_batch& batch,
+    const std::vector<size_t>& indexes,
+    uint64_t seed,
+    const AugmentParams& params,
+    size_t cols,
+    size_t rows
+) const {
+    const size_t count = batch.size(), size = rows * cols;
+
+    // Scratch buffers, reused by every call on this thread
+    thread_local std::vector<data::real_number_t> packed, augmented;
+    packed.resize(count * size);
+    augmented.resize(count * size);
+
+    for (size_t i = 0; i < count; i++){
+        std::copy(batch[i].input.begin(), batch[i].input.end(), packed.begin() + i * size);
+    }
+
+    _augment_packed(packed.data(), augmented.data(), count, indexes, seed, params, cols, rows);
+
+    for (size_t i = 0; i < count; i++){
+        batch[i].input.assign(augmented.begin() + i * size, augmented.begin() + (i + 1) * size);
+    }
+}
+
+void transformator::augment(
+    data::QuantizedBatch& batch,
+    const std::vector<size_t>& indexes,
+    uint64_t seed,
+    const AugmentParams& params
+) const {
+    const size_t count = batch.size(), size = batch.features();
+    const data::real_number_t scale = batch.scale, offset = batch.offset;
+
+    thread_local std::vector<data::real_number_t> packed, augmented;
+    packed.resize(count * size);
+    augmented.resize(count * size);
+
+    const uint8_t* samples = batch.samples.data();
+    for (size_t i = 0; i < count * size; i++){
+        packed[i] = samples[i] * scale + offset;
+    }
+
+    _augment_packed(packed.data(), augmented.data(), count, indexes, seed, params, batch.cols, batch.rows);
+
+    // back to the dataset's quantization, rounded to the nearest level
+    uint8_t* out = batch.samples.data();
+    const data::real_number_t inverse = 1.0 / scale;
+    for (size_t i = 0; i < count * size; i++){
+        data::real_number_t q = (augmented[i] - offset) * inverse + 0.5;
+        out[i] = static_cast<uint8_t>(std::min<data::real_number_t>(255.0, std::max<data::real_number_t>(0.0, q)));
+    }
+}
+
+void transformator::_augment_packed(
+    const data::real_number_t* packed,
+    data::real_number_t* augmented,
+    size_t count,
+    const std::vector<size_t>& indexes,
+    uint64_t seed,
+    const AugmentParams& params,
+    size_t cols,
+    size_t rows
+) const {
+    constexpr float RADIANS = 0.0174532925f;
+
+    const bool affine = params.max_angle != 0 || params.max_scale != 0 || params.max_shear != 0;
+
+    thread_local std::vector<Affine> transforms;
+    thread_local std::vector<int> dx, dy;
+    thread_local std::vector<uint64_t> seeds;
+
+    transforms.resize(count);
+    dx.resize(count);
+    dy.resize(count);
+    seeds.resize(count);
+
+    std::uniform_int_distribution<int> shift_dist(-params.max_shift, params.max_shift);
+    std::uniform_real_distribution<float> angle_dist(-params.max_angle, params.max_angle);
+    std::uniform_real_distribution<float> scale_dist(-params.max_scale, params.max_scale);
+    std::uniform_real_distribution<float> shear_dist(-params.max_shear, params.max_shear);
+
+    const float center_x = (cols - 1) * 0.5f, center_y = (rows - 1) * 0.5f;
+
+    for (size_t i = 0; i < count; i++){
+        // draw the parameters of this sample
+        uint64_t sample = data::sample_seed(seed, indexes[i]);
+        std::default_random_engine engine(static_cast<std::default_random_engine::result_type>(sample));
+
+        dx[i] = shift_dist(engine);
+        dy[i] = shift_dist(engine);
+        seeds[i] = data::sample_seed(sample, 1);
+
+        if (affine){
+            float angle = angle_dist(engine) * RADIANS;
+            float scale = 1.0f + scale_dist(engine);
+            float shear = shear_dist(engine);
+            transforms[i] = Affine::make(angle, scale, shear, dx[i], dy[i], center_x, center_y);
+        }
+    }
+
+    if (affine){
+        warp_affine(packed, augmented, count, rows, cols, transforms.data());
+    } else {
+        shift(packed, augmented, count, rows, cols, dx.data(), dy.data());
+    }
+    mnist::add_noise(augmented, count, rows, cols, seeds.data(), params.noisiness, params.max_noise);
+}
+
 data::vector_t transformator::move(
-    data::vector_t& pixels,
+    const data::vector_t& pixels,
     size_t cols,
     size_t rows,
     int x,
     int y
-){
+) const {
     data::vector_t moved(pixels.size(), 0);
-    int new_y, new_x;
-
-    for (int r = 0; r < static_cast<int>(rows); ++r){
-        for (int c = 0; c < static_cast<int>(cols); ++c){
-            new_y = r + y;
-            new_x = c + x;
-
-            if (new_y >= 0 && new_y < static_cast<int>(rows) 
-             && new_x >= 0 && new_x < static_cast<int>(cols)
-            ){
-                moved[new_y * cols + new_x] = pixels[r * cols + c];
-            }
-        }
-    }
-
+    shift(pixels.data(), moved.data(), 1, rows, cols, &x, &y);
     return moved;
 }
 
 
 data::vector_t transformator::rotate(
-    data::vector_t& pixels,
+    const data::vector_t& pixels,
     size_t cols,
     size_t rows,
     float angle,
     int center_x,
     int center_y
-){
+) const {
     data::vector_t rotated(pixels.size(), 0);
-    int x, y;
-    double cos_angle = std::cos(angle);
-    double sin_angle = std::sin(angle);
-
-    for (size_t r = 0; r < rows; ++r){
-        for (size_t c = 0; c < cols; ++c){
-            x = c - center_x;
-            y = r - center_y;
-
-            // rotate around the point
-            float new_x = x * cos_angle - y * sin_angle + center_x;
-            float new_y = x * sin_angle + y * cos_angle + center_y;
-
-            // Bilinear interpolation
-            if (static_cast<int>(new_y) >= 0 && static_cast<int>(new_y) < static_cast<int>(rows) 
-             && static_cast<int>(new_x) >= 0 && static_cast<int>(new_x) < static_cast<int>(cols)
-            ){
-                int x1 = std::floor(new_x), x2 = std::ceil(new_x);
-                int y1 = std::floor(new_y), y2 = std::ceil(new_y);
-
-                double r1 = (x2 - new_x) * pixels[y1 * cols + x1] + (new_x - x1) * pixels[y1 * cols + x2];
-                double r2 = (x2 - new_x) * pixels[y2 * cols + x1] + (new_x - x1) * pixels[y2 * cols + x2];
-
-                rotated[r * cols + c] = (y2 - new_y) * r1 + (new_y - y1) * r2;
-            }
-        }
-    }
-
+    Affine transform = Affine::make(angle, 1.0f, 0.0f, 0.0f, 0.0f, center_x, center_y);
+    warp_affine(pixels.data(), rotated.data(), 1, rows, cols, &transform);
     return rotated;
 }
 
-END_NAMESPACE_MNIST
\ No newline at end of file
+END_NAMESPACE_MNIST
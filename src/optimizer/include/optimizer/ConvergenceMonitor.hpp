@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "namespaces.hpp"
+
+START_NAMESPACE_OPTIMIZER
+
+struct ConvergenceDecision
+{
+    // The metric is the best so far (by more than the minimal improvement)
+    bool improved = false;
+    // No improvement for `plateauPatience` epochs since the last reduction, reduce the learning rate
+    bool reduceLearningRate = false;
+    // No improvement for `stopPatience` epochs, stop the training
+    bool stop = false;
+};
+
+/**
+ * @brief Early stopping and plateau detection, fed with the validation metric of every epoch,
+ * in the order of the epochs (higher is better, ex. the test accuracy or the negative loss).
+ * A patience of 0 disables the decision.
+*/
+class ConvergenceMonitor
+{
+public:
+    ConvergenceMonitor(size_t stopPatience = 0, size_t plateauPatience = 0, double minImprovement = 1e-4);
+
+    ConvergenceDecision update(double metric);
+
+    // Index of the epoch with the best metric
+    size_t bestEpoch() const {return best;}
+    double bestMetric() const {return bestValue;}
+    // Number of the epochs seen so far
+    size_t epochs() const {return seen;}
+
+private:
+    size_t stopPatience;
+    size_t plateauPatience;
+    double minImprovement;
+
+    double bestValue;
+    size_t best;
+    size_t seen;
+    size_t sinceImprovement;
+    size_t sinceReduction;
+};
+
+END_NAMESPACE_OPTIMIZER
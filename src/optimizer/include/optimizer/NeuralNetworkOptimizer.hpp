@@ -1,11 +1,14 @@
 #pragma once
 
 #include "namespaces.hpp"
+#include "ConvergenceMonitor.hpp"
 
 #include <iostream>
 #include <chrono>
 #include <vector>
+#include <memory>
 #include <thread>
+#include <future>
 
 #include <core/core.hpp>
 #include <mnist/mnist.hpp>
@@ -16,8 +19,12 @@ START_NAMESPACE_OPTIMIZER
 struct NeuralNetworkOptimizerParameters
 {
     NeuralNetworkOptimizerParameters(): 
-        batchSize(0), epochs(0), learningRate(0.4),
-        trainingData(nullptr), testData(nullptr), network(nullptr) {};
+        batchSize(0), epochs(0), learningRate(0.4), prefetch(2), loaderThreads(2),
+        sampler(data::SamplerType::shuffled), importanceFraction(0.3), importanceWarmup(1),
+        trainingData(nullptr), testData(nullptr), trainingSet(nullptr), testSet(nullptr), 
+        trainingStream(nullptr), network(nullptr), publishedModel(nullptr), publishInterval(0),
+        validation(true), validationThreads(1), earlyStoppingPatience(0), minImprovement(1e-4),
+        plateauPatience(0), plateauFactor(0.5), minLearningRate(1e-4), keepBest(false) {};
     virtual ~NeuralNetworkOptimizerParameters() {};
 
     NeuralNetworkOptimizerParameters& setNeuralNetwork(
@@ -25,13 +32,25 @@ struct NeuralNetworkOptimizerParameters
     ) {this->network = network; return *this;}
 
     NeuralNetworkOptimizerParameters& setTrainingData(
-        data::data_batch* trainingData
+        const data::data_batch* trainingData
     ) {this->trainingData = trainingData; return *this;}
 
     NeuralNetworkOptimizerParameters& setTestData(
-        data::data_batch* testData
+        const data::data_batch* testData
     ) {this->testData = testData; return *this;}
 
+    NeuralNetworkOptimizerParameters& setTrainingData(
+        const data::Dataset* trainingSet
+    ) {this->trainingSet = trainingSet; return *this;}
+
+    NeuralNetworkOptimizerParameters& setTestData(
+        const data::Dataset* testSet
+    ) {this->testSet = testSet; return *this;}
+
+    NeuralNetworkOptimizerParameters& setTrainingData(
+        data::BatchStream* trainingStream
+    ) {this->trainingStream = trainingStream; return *this;}
+
     NeuralNetworkOptimizerParameters& setBatchSize(
         size_t batchSize
     ) {this->batchSize = batchSize; return *this;}
@@ -44,12 +63,123 @@ struct NeuralNetworkOptimizerParameters
         double learningRate
     ) {this->learningRate = learningRate; return *this;}
 
+    NeuralNetworkOptimizerParameters& setPrefetch(
+        size_t prefetch
+    ) {this->prefetch = prefetch; return *this;}
+
+    NeuralNetworkOptimizerParameters& setLoaderThreads(
+        size_t loaderThreads
+    ) {this->loaderThreads = loaderThreads; return *this;}
+
+    NeuralNetworkOptimizerParameters& setSampler(
+        data::SamplerType sampler
+    ) {this->sampler = sampler; return *this;}
+
+    NeuralNetworkOptimizerParameters& setClassWeights(
+        const std::vector<double>& classWeights
+    ) {this->classWeights = classWeights; return *this;}
+
+    NeuralNetworkOptimizerParameters& setImportanceSampling(
+        double importanceFraction, size_t importanceWarmup = 1
+    ) {
+        this->sampler = data::SamplerType::importance;
+        this->importanceFraction = importanceFraction; 
+        this->importanceWarmup = importanceWarmup; 
+        return *this;
+    }
+
+    NeuralNetworkOptimizerParameters& setPublishedModel(
+        neural_network::PublishedModel* publishedModel, size_t publishInterval = 0
+    ) {
+        this->publishedModel = publishedModel; 
+        this->publishInterval = publishInterval; 
+        return *this;
+    }
+
+    NeuralNetworkOptimizerParameters& setValidation(
+        bool validation, size_t validationThreads = 1
+    ) {
+        this->validation = validation; 
+        this->validationThreads = validationThreads; 
+        return *this;
+    }
+
+    NeuralNetworkOptimizerParameters& setEarlyStopping(
+        size_t earlyStoppingPatience, double minImprovement = 1e-4
+    ) {
+        this->earlyStoppingPatience = earlyStoppingPatience; 
+        this->minImprovement = minImprovement; 
+        return *this;
+    }
+
+    NeuralNetworkOptimizerParameters& setPlateauReduction(
+        size_t plateauPatience, double plateauFactor = 0.5, double minLearningRate = 1e-4
+    ) {
+        this->plateauPatience = plateauPatience; 
+        this->plateauFactor = plateauFactor; 
+        this->minLearningRate = minLearningRate; 
+        return *this;
+    }
+
+    NeuralNetworkOptimizerParameters& setKeepBest(
+        bool keepBest
+    ) {this->keepBest = keepBest; return *this;}
+
+    NeuralNetworkOptimizerParameters& setAugmentation(
+        const mnist::AugmentParams& augmentation
+    ) {this->augmentation = augmentation; return *this;}
+
     size_t batchSize;
     size_t epochs;
     double learningRate;
-    data::data_batch* trainingData;
-    data::data_batch* testData;
+    // Number of mini batches prepared in the background
+    size_t prefetch;
+    // Number of threads preparing (and augmenting) the mini batches
+    size_t loaderThreads;
+    // Order of the training samples
+    data::SamplerType sampler;
+    // Weights of the classes, used by the `SamplerType::weighted` sampler (empty -> class-balanced)
+    std::vector<double> classWeights;
+    // Part of the training data visited per epoch by the `SamplerType::importance` sampler
+    double importanceFraction;
+    // Number of the first epochs visiting the whole training data, to get the loss of every sample
+    size_t importanceWarmup;
+    // Random transformations applied to the training batches
+    mnist::AugmentParams augmentation;
+    // Not modified by the optimizer, may be shared with other threads
+    const data::data_batch* trainingData;
+    const data::data_batch* testData;
+    // Quantized datasets, used instead of `trainingData` and `testData` if set,
+    // the samples stay quantized, the network dequantizes them in the first layer
+    const data::Dataset* trainingSet;
+    const data::Dataset* testSet;
+    // Streamed training data (ex. sharded dataset larger than memory), used instead of 
+    // `trainingSet` and `trainingData` if set
+    data::BatchStream* trainingStream;
     neural_network::ONeural* network;
+    // Snapshots of the network are published there after every epoch, so other threads
+    // (ex. the drawer, a server) may use the network while it's trained
+    neural_network::PublishedModel* publishedModel;
+    // Number of the mini batches between the snapshots, 0 -> only after the epochs
+    size_t publishInterval;
+    // Evaluates the test accuracy after every epoch, on a snapshot of the network, in the background
+    // (at low priority) while the next epoch trains
+    bool validation;
+    // Threads of a single evaluation, 0 -> hardware concurrency
+    size_t validationThreads;
+    // The convergence is judged by the per epoch test accuracy (see `validation`), or by the average
+    // training loss if there is no test data. The background evaluation finishes during the next epoch,
+    // so the decisions are applied one epoch late.
+    // Stops after that many epochs without improvement, 0 -> always runs all of the `epochs`
+    size_t earlyStoppingPatience;
+    // Smallest change of the metric counted as an improvement
+    double minImprovement;
+    // Multiplies the learning rate by `plateauFactor` after that many epochs without improvement, 0 -> never
+    size_t plateauPatience;
+    double plateauFactor;
+    double minLearningRate;
+    // Keeps a copy of the best network in memory, and restores it after the training
+    bool keepBest;
 };
 
 struct NeuralNetworkOptimizerResult
@@ -67,6 +197,12 @@ struct NeuralNetworkOptimizerResult
 
     double trainingAccuracy;
     double testAccuracy;
+    // Test accuracy after every epoch, if `NeuralNetworkOptimizerParameters::validation` is set
+    std::vector<double> epochTestAccuracy;
+    // Number of the trained epochs (fewer than requested if stopped early)
+    size_t epochs = 0;
+    // Epoch with the best validation metric
+    size_t bestEpoch = 0;
 };
 
 class NeuralNetworkOptimizer
@@ -84,7 +220,44 @@ public:
     double train_epoch(size_t total_batches, ui::Visualizer& visualizer, size_t start_time = 0);
 
 private:
+    // The image side is taken from the `data` the stage is prepared for
+    data::BatchLoader::stage_t augmentation(const data::data_batch* data) const;
+    data::BatchLoader::quantized_stage_t quantized_augmentation() const;
+
+    // Sets up the `loader` on the training or test data, with the augmentation stage
+    void prepare_loader(bool training, size_t batchSize);
+    size_t training_size() const;
+    // Creates the `trainingSampler` if it's not created yet
+    data::Sampler* training_sampler();
+
+    // Weighted learning step of the importance sampling, feeds the costs of the batch back to the `sampler`
+    template <class Batch>
+    void importance_learn(const Batch* batch, data::ImportanceSampler& sampler);
+    size_t test_size() const;
+
+    // Evaluates the current weights on the test data in the background
+    void start_validation();
+    // Reports the finished evaluations (all of them if `wait`) and stores them in the `result`
+    void collect_validations(NeuralNetworkOptimizerResult& result, bool wait);
+    // Feeds the validation metric of the epoch to the `monitor`, keeps the best checkpoint, 
+    // reduces the learning rate or requests the stop (only if `training`)
+    void convergence_update(size_t epoch, double metric, bool training);
+
     NeuralNetworkOptimizerParameters params;
+    // Prepares the mini batches on a separate thread
+    data::BatchLoader loader;
+    // Order of the training data, built on the first epoch
+    std::unique_ptr<data::Sampler> trainingSampler;
+    std::vector<data::real_number_t> importanceWeights;
+    std::vector<data::real_number_t> importanceLosses;
+    // Test accuracy of the epochs being evaluated, in the order of the epochs
+    std::vector<std::future<double>> validations;
+
+    ConvergenceMonitor monitor;
+    // Copies of the networks waiting for their validation, by the epoch
+    std::vector<std::unique_ptr<neural_network::ONeural>> checkpoints;
+    std::unique_ptr<neural_network::ONeural> bestNetwork;
+    bool stopRequested = false;
 };
 
 END_NAMESPACE_OPTIMIZER
\ No newline at end of file
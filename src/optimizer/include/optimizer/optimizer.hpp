@@ -1,3 +1,4 @@
 #pragma once
 
-#include "NeuralNetworkOptimizer.hpp"
\ No newline at end of file
+#include "NeuralNetworkOptimizer.hpp"
+#include "ConvergenceMonitor.hpp"
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include <optimizer/ConvergenceMonitor.hpp>
+
+
+START_NAMESPACE_OPTIMIZER
+
+ConvergenceMonitor::ConvergenceMonitor(size_t stopPatience, size_t plateauPatience, double minImprovement):
+    stopPatience(stopPatience), plateauPatience(plateauPatience), minImprovement(minImprovement),
+    bestValue(0.0), best(0), seen(0), sinceImprovement(0), sinceReduction(0) {}
+
+ConvergenceDecision ConvergenceMonitor::update(double metric)
+{
+    ConvergenceDecision decision;
+    size_t epoch = seen++;
+
+    if (epoch == 0 || metric > bestValue + minImprovement){
+        bestValue = metric;
+        best = epoch;
+        sinceImprovement = 0;
+        sinceReduction = 0;
+        decision.improved = true;
+        return decision;
+    }
+
+    sinceImprovement++;
+    sinceReduction++;
+    if (plateauPatience != 0 && sinceReduction >= plateauPatience){
+        decision.reduceLearningRate = true;
+        sinceReduction = 0;
+    }
+    decision.stop = stopPatience != 0 && sinceImprovement >= stopPatience;
+    return decision;
+}
+
+END_NAMESPACE_OPTIMIZER
@@ -1,8 +1,25 @@
 #include <optimizer/optimizer.hpp>
 
+#if defined(__linux__)
+#   include <sys/resource.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
+
 
 START_NAMESPACE_OPTIMIZER
 
+namespace {
+    // Lets the training threads go first, the evaluation uses only the idle cores
+    void lower_thread_priority()
+    {
+#if defined(__linux__)
+        // on linux the nice value is per thread
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+    }
+}
+
 NeuralNetworkOptimizer::NeuralNetworkOptimizer(
     const NeuralNetworkOptimizerParameters& params)
 {
@@ -13,22 +30,155 @@ NeuralNetworkOptimizer& NeuralNetworkOptimizer::setParameters(
     const NeuralNetworkOptimizerParameters& params)
 {
     this->params = params;
+    trainingSampler.reset();
     return *this;
 }
 
 
+data::BatchLoader::stage_t NeuralNetworkOptimizer::augmentation(const data::data_batch* data) const
+{
+    // Augments every batch on the loader threads, instead of creating whole noisy copy of the dataset
+    size_t size = data != nullptr && !data->empty() ? sqrtf(data->at(0).input.size()) : 0;
+    mnist::AugmentParams augment = params.augmentation;
+    return [size, augment](data::data_batch& batch, const std::vector<size_t>& indexes, uint64_t seed){
+        mnist::transformator().augment(batch, indexes, seed, augment, size, size);
+    };
+}
+
+data::BatchLoader::quantized_stage_t NeuralNetworkOptimizer::quantized_augmentation() const
+{
+    mnist::AugmentParams augment = params.augmentation;
+    return [augment](data::QuantizedBatch& batch, const std::vector<size_t>& indexes, uint64_t seed){
+        mnist::transformator().augment(batch, indexes, seed, augment);
+    };
+}
+
+size_t NeuralNetworkOptimizer::training_size() const
+{
+    if (params.trainingStream != nullptr){
+        return params.trainingStream->size();
+    }
+    return params.trainingSet != nullptr ? params.trainingSet->size() : params.trainingData->size();
+}
+
+size_t NeuralNetworkOptimizer::test_size() const
+{
+    return params.testSet != nullptr ? params.testSet->size() : params.testData->size();
+}
+
+void NeuralNetworkOptimizer::prepare_loader(bool training, size_t batchSize)
+{
+    const data::Dataset* set = training ? params.trainingSet : params.testSet;
+    if (set != nullptr){
+        loader.prepare(set, batchSize, params.prefetch, params.loaderThreads)
+              .stage_quantized(quantized_augmentation());
+    } else {
+        const data::data_batch* data = training ? params.trainingData : params.testData;
+        loader.prepare(data, batchSize, params.prefetch, params.loaderThreads)
+              .stage(augmentation(data));
+    }
+
+    if (training){
+        loader.sampler(training_sampler());
+    }
+}
+
+data::Sampler* NeuralNetworkOptimizer::training_sampler()
+{
+    // grouping the samples by class walks the whole dataset, so it's done only once
+    if (!trainingSampler){
+        trainingSampler = params.trainingSet != nullptr 
+            ? data::make_sampler(params.sampler, *params.trainingSet, params.classWeights)
+            : data::make_sampler(params.sampler, *params.trainingData, params.classWeights);
+    }
+    return trainingSampler.get();
+}
+
+void NeuralNetworkOptimizer::start_validation()
+{
+    // the snapshot is independent of the network, so the next epoch may train in the meantime
+    auto snapshot = std::make_shared<const neural_network::InferencePlan>(params.network->freeze());
+    const data::Dataset* testSet = params.testSet;
+    const data::data_batch* testData = params.testData;
+    size_t threads = params.validationThreads;
+
+    validations.push_back(std::async(std::launch::async, [snapshot, testSet, testData, threads](){
+        lower_thread_priority();
+        return testSet != nullptr 
+            ? snapshot->accuracy(*testSet, threads)
+            : snapshot->accuracy(*testData, threads);
+    }));
+}
+
+void NeuralNetworkOptimizer::collect_validations(NeuralNetworkOptimizerResult& result, bool wait)
+{
+    while (result.epochTestAccuracy.size() < validations.size()){
+        auto& validation = validations[result.epochTestAccuracy.size()];
+        if (!wait && validation.wait_for(std::chrono::seconds(0)) != std::future_status::ready){
+            break;
+        }
+        result.epochTestAccuracy.push_back(validation.get());
+        std::cout << "**** Epoch " << result.epochTestAccuracy.size() - 1 
+            << " test accuracy: " << result.epochTestAccuracy.back() << std::endl;
+        convergence_update(result.epochTestAccuracy.size() - 1, result.epochTestAccuracy.back(), !wait);
+    }
+}
+
+void NeuralNetworkOptimizer::convergence_update(size_t epoch, double metric, bool training)
+{
+    ConvergenceDecision decision = monitor.update(metric);
+    if (decision.improved && epoch < checkpoints.size() && checkpoints[epoch]){
+        bestNetwork = std::move(checkpoints[epoch]);
+    }
+    if (epoch < checkpoints.size()){
+        checkpoints[epoch].reset();
+    }
+    if (!training){
+        return;
+    }
+
+    if (decision.reduceLearningRate && params.learningRate > params.minLearningRate){
+        params.learningRate = std::max(params.minLearningRate, params.learningRate * params.plateauFactor);
+        std::cout << "**** Plateau after epoch " << epoch << ", learning rate: " << params.learningRate << std::endl;
+    }
+    if (decision.stop){
+        stopRequested = true;
+        std::cout << "**** No improvement since epoch " << monitor.bestEpoch() << ", stopping" << std::endl;
+    }
+}
+
+template <class Batch>
+void NeuralNetworkOptimizer::importance_learn(const Batch* batch, data::ImportanceSampler& sampler)
+{
+    const std::vector<size_t>& indexes = loader.indexes();
+    importanceWeights.resize(indexes.size());
+    importanceLosses.resize(indexes.size());
+    for (size_t i = 0; i < indexes.size(); i++){
+        importanceWeights[i] = sampler.weight(indexes[i]);
+    }
+
+    params.network->learn(batch, importanceWeights.data(), importanceLosses.data(), params.learningRate);
+
+    for (size_t i = 0; i < indexes.size(); i++){
+        sampler.update(indexes[i], importanceLosses[i]);
+    }
+}
+
 double NeuralNetworkOptimizer::train_epoch(size_t total_batches, ui::Visualizer& visualizer, size_t start_time)
 {
-    std::shuffle(
-        params.trainingData->begin(), 
-        params.trainingData->end(), 
-        std::mt19937(std::random_device()())
-    );
-    auto size = sqrtf(params.trainingData->at(0).input.size());
-    mnist::transformator t;
-    std::unique_ptr<data::data_batch> noisy(
-        t.add_noise(params.trainingData, 5, size, size, size * size * 0.25)
-    );
+    // The loader shuffles, gathers and augments the next batches on separate threads,
+    // while the network learns the current one
+    data::BatchStream* stream = params.trainingStream;
+    data::ImportanceSampler* importance = nullptr;
+    if (stream != nullptr){
+        stream->start(std::random_device()(), params.batchSize, quantized_augmentation());
+    } else {
+        prepare_loader(true, params.batchSize);
+        importance = dynamic_cast<data::ImportanceSampler*>(trainingSampler.get());
+        loader.start(std::random_device()());
+    }
+
+    size_t batches = 0;
     double average_loss = 0.0;
     double current_loss = 0.0;
     int64_t total_time = start_time;
@@ -37,11 +187,39 @@ double NeuralNetworkOptimizer::train_epoch(size_t total_batches, ui::Visualizer&
     {
         auto startTime = std::chrono::high_resolution_clock::now();
 
-        params.network->batch_learn(
-            noisy.get(), 
-            params.learningRate,
-            params.batchSize
-        );
+        if (stream != nullptr || params.trainingSet != nullptr){
+            const data::Dataset* batch = stream != nullptr ? stream->next() : loader.next_quantized();
+            if (batch == nullptr){
+                break;
+            }
+            if (importance != nullptr){
+                importance_learn(batch, *importance);
+            } else {
+                params.network->batch_learn(
+                    batch, 
+                    params.learningRate,
+                    params.batchSize
+                );
+            }
+        } else {
+            const data::data_batch* batch = loader.next();
+            if (batch == nullptr){
+                break;
+            }
+            if (importance != nullptr){
+                importance_learn(batch, *importance);
+            } else {
+                params.network->batch_learn(
+                    batch, 
+                    params.learningRate,
+                    params.batchSize
+                );
+            }
+        }
+        batches++;
+        if (params.publishedModel != nullptr && params.publishInterval != 0 && batches % params.publishInterval == 0){
+            params.publishedModel->publish(*params.network);
+        }
         current_loss = params.network->loss(
             params.batchSize
         );
@@ -57,7 +235,11 @@ double NeuralNetworkOptimizer::train_epoch(size_t total_batches, ui::Visualizer&
         });
         visualizer.visualize();
     }
-    return average_loss / total_batches;
+    if (stream != nullptr){
+        stream->stop();
+    }
+    loader.stop();
+    return batches > 0 ? average_loss / batches : 0.0;
 }
 
 NeuralNetworkOptimizerResult NeuralNetworkOptimizer::optimize()
@@ -65,44 +247,112 @@ NeuralNetworkOptimizerResult NeuralNetworkOptimizer::optimize()
     NeuralNetworkOptimizerResult result;
     result.setTrainingAccuracy(0.0);
     result.setTestAccuracy(0.0);
+    validations.clear();
+    checkpoints.clear();
+    bestNetwork.reset();
+    stopRequested = false;
+    monitor = ConvergenceMonitor(params.earlyStoppingPatience, params.plateauPatience, params.minImprovement);
+    // reduced on the plateaus, restored after the training
+    const double learningRate = params.learningRate;
+
+    const bool validate = params.validation && (params.testSet != nullptr || params.testData != nullptr);
 
     params.network->training_mode();
 
     auto startTime = std::chrono::high_resolution_clock::now();
     std::cout << "Training network..." << std::endl;
 
-    size_t total_batches = params.trainingData->size() / params.batchSize;
+    size_t total_batches = training_size() / params.batchSize;
     size_t totalTime = 0, timeDiff = 0;
 
     ui::GraphVisualizer visualizer;
 
-    for (size_t i = 0; i < params.epochs; ++i)
+    for (size_t i = 0; i < params.epochs && !stopRequested; ++i)
     {
         auto startTime = std::chrono::high_resolution_clock::now();
 
+        // importance sampling visits every sample once (uniformly) in the first epochs, then mostly the hard samples
+        if (params.trainingStream == nullptr){
+            if (auto importance = dynamic_cast<data::ImportanceSampler*>(training_sampler())){
+                importance->fraction(i < params.importanceWarmup ? 1.0 : params.importanceFraction);
+            }
+        }
+
         auto average_loss = train_epoch(total_batches, visualizer, totalTime);
         result.setTrainingAccuracy(1 - average_loss);
+        result.epochs = i + 1;
+        if (params.publishedModel != nullptr){
+            params.publishedModel->publish(*params.network);
+        }
+        if (params.keepBest){
+            checkpoints.resize(i + 1);
+            checkpoints[i] = std::make_unique<neural_network::ONeural>();
+            *checkpoints[i] = *params.network;
+        }
+        if (validate){
+            start_validation();
+        }
 
         timeDiff = std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::high_resolution_clock::now() - startTime
         ).count();
         totalTime += timeDiff;
+        data::BatchStream* stream = params.trainingStream;
         std::cout << "**** Epoch " << i << " average loss: " << average_loss << " time: " 
-            << timeDiff << "ms" << std::endl;
+            << timeDiff << "ms" << " loader stalls: " << (stream ? stream->stalls() : loader.stalls()) 
+            << " (" << (stream ? stream->stall_time() : loader.stall_time()) << "ms)" << std::endl;
+        if (validate){
+            collect_validations(result, false);
+        } else {
+            // without the test data, the convergence is judged by the training loss
+            convergence_update(i, -average_loss, true);
+        }
+    }
+
+    if (validate){
+        collect_validations(result, true);
+    }
+    result.bestEpoch = monitor.bestEpoch();
+    if (bestNetwork && result.bestEpoch + 1 != result.epochs){
+        *params.network = *bestNetwork;
+        std::cout << "**** Restored the network of the epoch " << result.bestEpoch << std::endl;
+        if (params.publishedModel != nullptr){
+            params.publishedModel->publish(*params.network);
+        }
     }
+    bestNetwork.reset();
+    checkpoints.clear();
+    params.learningRate = learningRate;
 
     params.network->training_mode(false);
 
-    result.setTestAccuracy(params.network->accuracy(
-        params.testData
-    ));
+    // the snapshot of the final (or the restored best) network was already evaluated
+    if (validate && result.epochs > 0){
+        result.setTestAccuracy(result.epochTestAccuracy[params.keepBest ? result.bestEpoch : result.epochs - 1]);
+    } else {
+        result.setTestAccuracy(params.testSet != nullptr 
+            ? params.network->accuracy(params.testSet)
+            : params.network->accuracy(params.testData)
+        );
+    }
 
-    auto size = sqrtf(params.trainingData->at(0).input.size());
-    mnist::transformator t;
-    std::unique_ptr<data::data_batch> noisy(
-        t.add_noise(params.testData, 5, size, size, size * size * 0.25)
-    );
-    auto noisy_acc = params.network->accuracy(noisy.get());
+    // Noisy test set is evaluated batch by batch, never stored as a whole
+    prepare_loader(false, 1024);
+    loader.drop_last(false)
+          .start(std::random_device()());
+
+    double noisy_acc = 0.0;
+    if (params.testSet != nullptr){
+        while (const data::Dataset* batch = loader.next_quantized()){
+            noisy_acc += params.network->accuracy(batch) * batch->size();
+        }
+    } else {
+        while (const data::data_batch* batch = loader.next()){
+            noisy_acc += params.network->accuracy(batch) * batch->size();
+        }
+    }
+    noisy_acc /= test_size();
+    loader.stop();
 
     std::cout << "Training complete. Learning time: " << std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::high_resolution_clock::now() - startTime).count() 
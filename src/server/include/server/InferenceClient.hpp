@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "namespaces.hpp"
+#include "Protocol.hpp"
+
+START_NAMESPACE_SERVER
+
+struct Response{
+    Status status = Status::ok;
+    size_t label = 0;
+    /// @brief Activations of the output layer, empty if the status isn't `ok`
+    std::vector<float> outputs;
+};
+
+/**
+ * @brief Connection to the `InferenceServer`, the requests are synchronous (one at a time).
+ * Use one client per thread.
+*/
+class InferenceClient{
+    int _fd;
+    Response _response;
+
+    public:
+    InferenceClient();
+
+    /// @brief Calls `connect(path)` internally
+    explicit InferenceClient(const std::string& path);
+    ~InferenceClient();
+
+    InferenceClient(const InferenceClient&) = delete;
+    InferenceClient& operator=(const InferenceClient&) = delete;
+
+    /**
+     * @brief Connects to the server listening at `path` (closes the previous connection)
+     * @throw std::runtime_error if the server isn't running
+     * @return *this
+    */
+    InferenceClient& connect(const std::string& path);
+
+    void close();
+
+    /**
+     * @brief Sends the sample and waits for the response
+     * @param inputs `size` values, normalized the same way as the training data
+     * @return response, valid until the next request
+     * @throw std::runtime_error if the connection is broken
+    */
+    const Response& classify(const float* inputs, size_t size);
+
+    inline bool connected() const {
+        return _fd >= 0;
+    }
+};
+
+END_NAMESPACE
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <core/core.hpp>
+
+#include "namespaces.hpp"
+#include "Protocol.hpp"
+
+START_NAMESPACE_SERVER
+
+struct ServerStats{
+    size_t requests = 0;
+    size_t batches = 0;
+    /// @brief Requests rejected with `Status::overloaded`
+    size_t rejected = 0;
+
+    inline double average_batch() const {
+        return batches == 0 ? 0.0 : static_cast<double>(requests) / batches;
+    }
+};
+
+/**
+ * @brief Local inference daemon, classifies the samples sent over a unix domain socket (see `Protocol.hpp`).
+ *
+ * Every connection is served by its own thread, which reads a request and puts it into a bounded queue.
+ * A single batcher thread groups the queued requests into micro batches: the batch is computed once it has
+ * `max_batch` requests, or `max_latency` after its first request arrived, whichever comes first, with one
+ * batched forward pass of the frozen network (`InferencePlan`, or the latest snapshot of the `PublishedModel`). If the queue is full, the request is
+ * rejected right away with `Status::overloaded`, so the memory and the queueing delay stay bounded.
+ *
+ * Usage:
+ * @code
+ * server::InferenceServer srv;
+ * srv.model("mnistNetwork").socket("/tmp/clife.sock").max_batch(64).max_latency(std::chrono::microseconds(500));
+ * srv.start();
+ * ...
+ * srv.stop();
+ * @endcode
+*/
+class InferenceServer{
+    struct _Request{
+        const float* inputs;
+        float* outputs;
+        size_t label;
+        Status status;
+        std::chrono::steady_clock::time_point arrival;
+        bool done;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    struct _Connection{
+        int fd;
+        std::thread thread;
+        std::atomic<bool> closed{false};
+    };
+
+    neural_network::InferencePlan _plan;
+    neural_network::PublishedModel* _published;
+    std::string _socket_path;
+    size_t _max_batch;
+    std::chrono::microseconds _max_latency;
+    size_t _queue_capacity;
+    size_t _threads;
+
+    int _listen_fd;
+    std::atomic<bool> _running;
+    std::thread _acceptor;
+    std::thread _batcher;
+
+    std::mutex _connections_mutex;
+    std::list<_Connection> _connections;
+
+    std::mutex _queue_mutex;
+    std::condition_variable _queued;
+    std::deque<_Request*> _queue;
+
+    mutable std::mutex _stats_mutex;
+    ServerStats _stats;
+
+    void _accept();
+    void _serve(_Connection* connection);
+    void _batch();
+
+    /// @brief Queues the request and waits for its result, `Status::overloaded` if the queue is full
+    Status _submit(_Request& request);
+
+    /// @brief Joins the threads of the closed connections
+    void _collect_connections(bool all);
+
+    public:
+    InferenceServer();
+    ~InferenceServer();
+
+    InferenceServer(const InferenceServer&) = delete;
+    InferenceServer& operator=(const InferenceServer&) = delete;
+
+    /// @brief Loads the network with the `db::FileManager` and freezes it
+    InferenceServer& model(const std::string& path);
+
+    /// @brief Serves the frozen copy of the `network`
+    InferenceServer& network(const neural_network::ONeural& network);
+
+    /**
+     * @brief Serves the latest snapshot of the `model` (hot swap), ex. published by the optimizer while it trains.
+     * Every batch uses the snapshot published before it started, the snapshots must keep the number of
+     * the inputs and outputs of the first one. The model must outlive the server
+    */
+    InferenceServer& published(neural_network::PublishedModel& model);
+
+    /// @brief Path of the unix domain socket
+    InferenceServer& socket(const std::string& path);
+
+    /// @brief Maximum number of the requests computed together
+    InferenceServer& max_batch(size_t max_batch);
+
+    /// @brief How long the first request of the batch may wait for the others
+    InferenceServer& max_latency(std::chrono::microseconds max_latency);
+
+    /// @brief Maximum number of the waiting requests, the others are rejected
+    InferenceServer& queue_capacity(size_t capacity);
+
+    /// @brief Threads of the batched forward pass, 0 -> hardware concurrency
+    InferenceServer& threads(size_t threads);
+
+    /**
+     * @brief Starts listening and serving in the background
+     * @throw std::runtime_error if there is no model or the socket can't be created
+    */
+    void start();
+
+    /// @brief Stops accepting, answers the queued requests and closes all of the connections
+    void stop();
+
+    inline bool running() const {
+        return _running;
+    }
+
+    ServerStats stats() const;
+};
+
+END_NAMESPACE
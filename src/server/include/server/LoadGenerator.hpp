@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "namespaces.hpp"
+#include "InferenceClient.hpp"
+
+START_NAMESPACE_SERVER
+
+struct LoadReport{
+    size_t requests = 0;
+    /// @brief Requests answered with `Status::overloaded`
+    size_t rejected = 0;
+    /// @brief Requests answered with other errors, or lost with the connection
+    size_t errors = 0;
+    double seconds = 0.0;
+    /// @brief Latency percentiles of the answered requests, in microseconds
+    double p50 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+
+    /// @brief Answered requests per second
+    inline double throughput() const {
+        return seconds > 0.0 ? requests / seconds : 0.0;
+    }
+};
+
+/**
+ * @brief Load generator of the `InferenceServer`: `clients` connections, each sending `requests`
+ * requests back to back (closed loop) from its own thread. The samples are taken round robin.
+*/
+class LoadGenerator{
+    std::string _socket_path;
+    size_t _clients;
+    size_t _requests;
+    std::vector<float> _samples;
+    size_t _features;
+
+    public:
+    LoadGenerator();
+
+    /// @brief Path of the server's unix domain socket
+    LoadGenerator& socket(const std::string& path);
+
+    /// @brief Number of the concurrent connections
+    LoadGenerator& clients(size_t clients);
+
+    /// @brief Number of the requests sent by each client
+    LoadGenerator& requests(size_t requests);
+
+    /**
+     * @brief Samples sent to the server
+     * @param samples `count * features` values, sample after sample
+    */
+    LoadGenerator& samples(const std::vector<float>& samples, size_t features);
+
+    /**
+     * @brief Runs the clients and waits for them to finish
+     * @throw std::runtime_error if there are no samples or the server isn't running
+    */
+    LoadReport run();
+};
+
+END_NAMESPACE
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "namespaces.hpp"
+
+START_NAMESPACE_SERVER
+
+/**
+ * Wire format of the inference server, native byte order (the server is local only):
+ *  - request:  `RequestHeader`, then `inputs` floats
+ *  - response: `ResponseHeader`, then `outputs` floats (none if the status isn't `ok`)
+ * A connection sends the next request after it has read the response.
+*/
+
+constexpr uint32_t PROTOCOL_MAGIC = 0x46494c43; // "CLIF"
+
+enum class Status: uint32_t{
+    ok = 0,
+    /// @brief The request queue is full, try again later
+    overloaded = 1,
+    /// @brief Wrong magic or number of the inputs
+    bad_request = 2,
+    /// @brief The server is shutting down
+    unavailable = 3
+};
+
+struct RequestHeader{
+    uint32_t magic;
+    uint32_t inputs;
+};
+
+struct ResponseHeader{
+    uint32_t magic;
+    Status status;
+    uint32_t label;
+    uint32_t outputs;
+};
+
+/// @brief Human readable name of the `status`
+const char* status_name(Status status);
+
+/**
+ * @brief Reads exactly `size` bytes from the socket
+ * @return false if the peer closed the connection
+ * @throw std::runtime_error on the socket error
+*/
+bool read_all(int fd, void* data, size_t size);
+
+/**
+ * @brief Writes exactly `size` bytes to the socket, without raising SIGPIPE
+ * @return false if the peer closed the connection
+ * @throw std::runtime_error on the socket error
+*/
+bool write_all(int fd, const void* data, size_t size);
+
+/// @brief Creates a listening unix domain socket at `path` (the stale socket file is removed)
+int listen_unix(const std::string& path, int backlog = 64);
+
+/// @brief Connects to the unix domain socket at `path`
+int connect_unix(const std::string& path);
+
+END_NAMESPACE
@@ -0,0 +1,9 @@
+#pragma once
+
+#ifndef START_NAMESPACE_SERVER
+#   define START_NAMESPACE_SERVER namespace server{
+#endif
+
+#ifndef END_NAMESPACE
+#   define END_NAMESPACE }
+#endif
\ No newline at end of file
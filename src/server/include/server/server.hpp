@@ -0,0 +1,6 @@
+#pragma once
+
+#include "Protocol.hpp"
+#include "InferenceServer.hpp"
+#include "InferenceClient.hpp"
+#include "LoadGenerator.hpp"
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include <server/InferenceClient.hpp>
+
+#include <stdexcept>
+
+#include <unistd.h>
+
+START_NAMESPACE_SERVER
+
+InferenceClient::InferenceClient(): _fd(-1) {}
+
+InferenceClient::InferenceClient(const std::string& path): _fd(-1){
+    (void)connect(path);
+}
+
+InferenceClient::~InferenceClient(){
+    close();
+}
+
+InferenceClient& InferenceClient::connect(const std::string& path){
+    close();
+    _fd = connect_unix(path);
+    return *this;
+}
+
+void InferenceClient::close(){
+    if (_fd >= 0){
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+const Response& InferenceClient::classify(const float* inputs, size_t size){
+    if (_fd < 0){
+        throw std::runtime_error("InferenceClient: not connected");
+    }
+
+    RequestHeader header{PROTOCOL_MAGIC, static_cast<uint32_t>(size)};
+    ResponseHeader response;
+    if (!write_all(_fd, &header, sizeof(header)) || !write_all(_fd, inputs, size * sizeof(float)) ||
+        !read_all(_fd, &response, sizeof(response))){
+        close();
+        throw std::runtime_error("InferenceClient: connection closed by the server");
+    }
+    if (response.magic != PROTOCOL_MAGIC){
+        close();
+        throw std::runtime_error("InferenceClient: invalid response");
+    }
+
+    _response.status = response.status;
+    _response.label = response.label;
+    _response.outputs.resize(response.outputs);
+    if (!read_all(_fd, _response.outputs.data(), response.outputs * sizeof(float))){
+        close();
+        throw std::runtime_error("InferenceClient: connection closed by the server");
+    }
+    return _response;
+}
+
+END_NAMESPACE
@@ -0,0 +1,291 @@
+#include <server/InferenceServer.hpp>
+#include <backend/FileManager.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+START_NAMESPACE_SERVER
+
+namespace {
+    // How often the acceptor checks if the server was stopped
+    constexpr int ACCEPT_POLL_MS = 100;
+}
+
+InferenceServer::InferenceServer():
+    _published(nullptr), _socket_path("/tmp/clife.sock"), _max_batch(64), _max_latency(500),
+    _queue_capacity(1024), _threads(0), _listen_fd(-1), _running(false) {}
+
+InferenceServer::~InferenceServer(){
+    stop();
+}
+
+InferenceServer& InferenceServer::model(const std::string& path){
+    std::unique_ptr<neural_network::ONeural> network(db::FileManager(path).from_file());
+    return this->network(*network);
+}
+
+InferenceServer& InferenceServer::network(const neural_network::ONeural& network){
+    _plan = network.freeze();
+    _published = nullptr;
+    return *this;
+}
+
+InferenceServer& InferenceServer::published(neural_network::PublishedModel& model){
+    _published = &model;
+    return *this;
+}
+
+InferenceServer& InferenceServer::socket(const std::string& path){
+    _socket_path = path;
+    return *this;
+}
+
+InferenceServer& InferenceServer::max_batch(size_t max_batch){
+    _max_batch = std::max<size_t>(1, max_batch);
+    return *this;
+}
+
+InferenceServer& InferenceServer::max_latency(std::chrono::microseconds max_latency){
+    _max_latency = max_latency;
+    return *this;
+}
+
+InferenceServer& InferenceServer::queue_capacity(size_t capacity){
+    _queue_capacity = std::max<size_t>(1, capacity);
+    return *this;
+}
+
+InferenceServer& InferenceServer::threads(size_t threads){
+    _threads = threads;
+    return *this;
+}
+
+void InferenceServer::start(){
+    if (_running){
+        return;
+    }
+    if (_published != nullptr){
+        // the first snapshot sets the size of the requests
+        neural_network::PublishedModel::Reader reader(*_published);
+        _plan = reader.plan();
+    }
+    if (_plan.empty()){
+        throw std::runtime_error("InferenceServer: no model to serve");
+    }
+    _listen_fd = listen_unix(_socket_path);
+    _running = true;
+    _acceptor = std::thread(&InferenceServer::_accept, this);
+    _batcher = std::thread(&InferenceServer::_batch, this);
+}
+
+void InferenceServer::stop(){
+    {
+        std::lock_guard<std::mutex> lock(_queue_mutex);
+        if (!_running){
+            return;
+        }
+        _running = false;
+    }
+    _queued.notify_all();
+
+    // no new connections, the batcher answers the already queued requests
+    _acceptor.join();
+    ::close(_listen_fd);
+    ::unlink(_socket_path.c_str());
+    _listen_fd = -1;
+    _batcher.join();
+
+    // wakes up the connections blocked on reading the next request
+    {
+        std::lock_guard<std::mutex> lock(_connections_mutex);
+        for (auto& connection : _connections){
+            if (!connection.closed){
+                ::shutdown(connection.fd, SHUT_RDWR);
+            }
+        }
+    }
+    _collect_connections(true);
+}
+
+ServerStats InferenceServer::stats() const {
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    return _stats;
+}
+
+void InferenceServer::_collect_connections(bool all){
+    std::list<_Connection> finished;
+    {
+        std::lock_guard<std::mutex> lock(_connections_mutex);
+        for (auto it = _connections.begin(); it != _connections.end();){
+            auto next = std::next(it);
+            if (all || it->closed){
+                finished.splice(finished.end(), _connections, it);
+            }
+            it = next;
+        }
+    }
+    for (auto& connection : finished){
+        connection.thread.join();
+    }
+}
+
+void InferenceServer::_accept(){
+    pollfd listening{_listen_fd, POLLIN, 0};
+    while (_running){
+        if (::poll(&listening, 1, ACCEPT_POLL_MS) <= 0){
+            continue;
+        }
+        int fd = ::accept(_listen_fd, nullptr, nullptr);
+        if (fd < 0){
+            continue;
+        }
+
+        _collect_connections(false);
+        std::lock_guard<std::mutex> lock(_connections_mutex);
+        _connections.emplace_back();
+        _Connection* connection = &_connections.back();
+        connection->fd = fd;
+        connection->thread = std::thread(&InferenceServer::_serve, this, connection);
+    }
+}
+
+void InferenceServer::_serve(_Connection* connection){
+    const int fd = connection->fd;
+    std::vector<float> inputs(_plan.inputs()), outputs(_plan.outputs());
+    _Request request;
+    request.inputs = inputs.data();
+    request.outputs = outputs.data();
+
+    try{
+        RequestHeader header;
+        while (read_all(fd, &header, sizeof(header))){
+            ResponseHeader response{PROTOCOL_MAGIC, Status::ok, 0, 0};
+            if (header.magic != PROTOCOL_MAGIC){
+                // can't find the start of the next request
+                response.status = Status::bad_request;
+                write_all(fd, &response, sizeof(response));
+                break;
+            }
+            if (header.inputs != inputs.size()){
+                // skips the inputs, so the connection stays usable
+                float skipped[256];
+                for (size_t left = header.inputs; left > 0;){
+                    size_t n = std::min<size_t>(left, 256);
+                    if (!read_all(fd, skipped, n * sizeof(float))){
+                        break;
+                    }
+                    left -= n;
+                }
+                response.status = Status::bad_request;
+            } else {
+                if (!read_all(fd, inputs.data(), inputs.size() * sizeof(float))){
+                    break;
+                }
+                response.status = _submit(request);
+            }
+
+            if (response.status == Status::ok){
+                response.label = static_cast<uint32_t>(request.label);
+                response.outputs = static_cast<uint32_t>(outputs.size());
+            }
+            if (!write_all(fd, &response, sizeof(response)) ||
+                !write_all(fd, outputs.data(), response.outputs * sizeof(float))){
+                break;
+            }
+        }
+    } catch (const std::exception&){
+        // broken connection, only this client is affected
+    }
+
+    std::lock_guard<std::mutex> lock(_connections_mutex);
+    ::close(fd);
+    connection->closed = true;
+}
+
+Status InferenceServer::_submit(_Request& request){
+    request.done = false;
+    request.arrival = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(_queue_mutex);
+        if (!_running){
+            return Status::unavailable;
+        }
+        if (_queue.size() >= _queue_capacity){
+            std::lock_guard<std::mutex> stats_lock(_stats_mutex);
+            _stats.rejected++;
+            return Status::overloaded;
+        }
+        _queue.push_back(&request);
+    }
+    _queued.notify_one();
+
+    std::unique_lock<std::mutex> lock(request.mutex);
+    request.finished.wait(lock, [&request](){ return request.done; });
+    return request.status;
+}
+
+void InferenceServer::_batch(){
+    const size_t in = _plan.inputs(), out = _plan.outputs();
+    std::vector<float> inputs(_max_batch * in), outputs(_max_batch * out);
+    std::vector<_Request*> batch;
+    batch.reserve(_max_batch);
+
+    std::unique_ptr<neural_network::PublishedModel::Reader> reader;
+    if (_published != nullptr){
+        reader = std::make_unique<neural_network::PublishedModel::Reader>(*_published);
+    }
+
+    while (true){
+        {
+            std::unique_lock<std::mutex> lock(_queue_mutex);
+            _queued.wait(lock, [this](){ return !_queue.empty() || !_running; });
+            if (_queue.empty()){
+                return;
+            }
+
+            // waits for more requests, at most `max_latency` since the first one arrived
+            auto deadline = _queue.front()->arrival + _max_latency;
+            _queued.wait_until(lock, deadline, [this](){ return _queue.size() >= _max_batch || !_running; });
+
+            size_t n = std::min(_max_batch, _queue.size());
+            batch.assign(_queue.begin(), _queue.begin() + n);
+            _queue.erase(_queue.begin(), _queue.begin() + n);
+        }
+
+        // the latest snapshot, a single atomic load if nothing was published
+        const neural_network::InferencePlan& plan = reader ? reader->plan() : _plan;
+        const bool valid = plan.inputs() == in && plan.outputs() == out;
+        if (valid){
+            for (size_t i = 0; i < batch.size(); i++){
+                std::copy(batch[i]->inputs, batch[i]->inputs + in, inputs.begin() + i * in);
+            }
+            plan.predict(inputs.data(), batch.size(), outputs.data(), _threads);
+        }
+
+        for (size_t i = 0; i < batch.size(); i++){
+            const float* y = outputs.data() + i * out;
+            _Request& request = *batch[i];
+            request.status = valid ? Status::ok : Status::bad_request;
+            if (valid){
+                std::copy(y, y + out, request.outputs);
+                request.label = std::max_element(y, y + out) - y;
+            }
+            {
+                std::lock_guard<std::mutex> lock(request.mutex);
+                request.done = true;
+            }
+            request.finished.notify_one();
+        }
+
+        std::lock_guard<std::mutex> lock(_stats_mutex);
+        _stats.requests += batch.size();
+        _stats.batches++;
+    }
+}
+
+END_NAMESPACE
@@ -0,0 +1,116 @@
+#include <server/LoadGenerator.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+START_NAMESPACE_SERVER
+
+namespace {
+    struct _ClientResult{
+        std::vector<float> latencies;
+        size_t rejected = 0;
+        size_t errors = 0;
+    };
+
+    // Value at the `fraction` of the sorted `values`
+    double percentile(const std::vector<float>& values, double fraction){
+        if (values.empty()){
+            return 0.0;
+        }
+        size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+        return values[index];
+    }
+}
+
+LoadGenerator::LoadGenerator():
+    _socket_path("/tmp/clife.sock"), _clients(8), _requests(1000), _features(0) {}
+
+LoadGenerator& LoadGenerator::socket(const std::string& path){
+    _socket_path = path;
+    return *this;
+}
+
+LoadGenerator& LoadGenerator::clients(size_t clients){
+    _clients = std::max<size_t>(1, clients);
+    return *this;
+}
+
+LoadGenerator& LoadGenerator::requests(size_t requests){
+    _requests = requests;
+    return *this;
+}
+
+LoadGenerator& LoadGenerator::samples(const std::vector<float>& samples, size_t features){
+    _samples = samples;
+    _features = features;
+    return *this;
+}
+
+LoadReport LoadGenerator::run(){
+    if (_features == 0 || _samples.size() < _features){
+        throw std::runtime_error("LoadGenerator: no samples");
+    }
+    const size_t sample_count = _samples.size() / _features;
+
+    // connect first, so the connection time isn't measured
+    std::vector<std::unique_ptr<InferenceClient>> connections;
+    for (size_t c = 0; c < _clients; c++){
+        connections.push_back(std::make_unique<InferenceClient>(_socket_path));
+    }
+
+    std::vector<_ClientResult> results(_clients);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < _clients; c++){
+        threads.emplace_back([&, c](){
+            InferenceClient& client = *connections[c];
+            _ClientResult& result = results[c];
+            result.latencies.reserve(_requests);
+
+            for (size_t r = 0; r < _requests; r++){
+                const float* sample = _samples.data() + ((c + r * _clients) % sample_count) * _features;
+                auto sent = std::chrono::steady_clock::now();
+                try{
+                    const Response& response = client.classify(sample, _features);
+                    if (response.status == Status::ok){
+                        result.latencies.push_back(std::chrono::duration<float, std::micro>(
+                            std::chrono::steady_clock::now() - sent
+                        ).count());
+                    } else if (response.status == Status::overloaded){
+                        result.rejected++;
+                    } else {
+                        result.errors++;
+                    }
+                } catch (const std::exception&){
+                    // the connection is lost, so are the rest of the requests
+                    result.errors += _requests - r;
+                    return;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads){
+        thread.join();
+    }
+
+    LoadReport report;
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<float> latencies;
+    for (const auto& result : results){
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        report.rejected += result.rejected;
+        report.errors += result.errors;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    report.requests = latencies.size();
+    report.p50 = percentile(latencies, 0.5);
+    report.p99 = percentile(latencies, 0.99);
+    report.max = latencies.empty() ? 0.0 : latencies.back();
+    return report;
+}
+
+END_NAMESPACE
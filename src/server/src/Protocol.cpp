@@ -0,0 +1,128 @@
+#include <server/Protocol.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+START_NAMESPACE_SERVER
+
+namespace {
+    std::runtime_error socket_error(const std::string& what){
+        return std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    sockaddr_un unix_address(const std::string& path){
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path)){
+            throw std::runtime_error("Socket path too long: " + path);
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return address;
+    }
+
+    int unix_socket(){
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0){
+            throw socket_error("Can't create a socket");
+        }
+#if defined(SO_NOSIGPIPE)
+        int on = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        return fd;
+    }
+}
+
+const char* status_name(Status status){
+    switch (status)
+    {
+    case Status::ok:
+        return "ok";
+    case Status::overloaded:
+        return "overloaded";
+    case Status::bad_request:
+        return "bad request";
+    case Status::unavailable:
+        return "unavailable";
+    default:
+        return "unknown";
+    }
+}
+
+bool read_all(int fd, void* data, size_t size){
+    char* p = static_cast<char*>(data);
+    while (size > 0){
+        ssize_t n = ::recv(fd, p, size, 0);
+        if (n == 0){
+            return false;
+        }
+        if (n < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            if (errno == ECONNRESET){
+                return false;
+            }
+            throw socket_error("Socket read failed");
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool write_all(int fd, const void* data, size_t size){
+#if defined(MSG_NOSIGNAL)
+    constexpr int flags = MSG_NOSIGNAL;
+#else
+    constexpr int flags = 0;
+#endif
+    const char* p = static_cast<const char*>(data);
+    while (size > 0){
+        ssize_t n = ::send(fd, p, size, flags);
+        if (n < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            if (errno == EPIPE || errno == ECONNRESET){
+                return false;
+            }
+            throw socket_error("Socket write failed");
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+int listen_unix(const std::string& path, int backlog){
+    sockaddr_un address = unix_address(path);
+    int fd = unix_socket();
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, backlog) < 0){
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        throw socket_error("Can't listen on " + path);
+    }
+    return fd;
+}
+
+int connect_unix(const std::string& path){
+    sockaddr_un address = unix_address(path);
+    int fd = unix_socket();
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0){
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        throw socket_error("Can't connect to " + path);
+    }
+    return fd;
+}
+
+END_NAMESPACE
@@ -30,11 +30,19 @@ void renderNetworkGuess(
 
     auto minSize = std::min(windowSize.x, windowSize.y);
 
+    // classify all of the points at once
+    auto plan = network->freeze();
+    std::vector<float> inputs(data->size() * plan.inputs());
+    std::vector<size_t> guesses(data->size());
     for (size_t i = 0; i < data->size(); i++){
-        auto dataPoint = (*data)[i];
-        network->input(dataPoint);
-        (void)network->outputs();
-        auto color = network->correct()
+        const auto& input = (*data)[i].input;
+        std::copy(input.begin(), input.begin() + plan.inputs(), inputs.begin() + i * plan.inputs());
+    }
+    plan.classify(inputs.data(), data->size(), guesses.data());
+
+    for (size_t i = 0; i < data->size(); i++){
+        const auto& dataPoint = (*data)[i];
+        auto color = dataPoint.expect[guesses[i]] == 1
             ? sf::Color(0x02d30940) // green
             : sf::Color(0xd3130240); // red
 
@@ -72,7 +80,6 @@ void renderPoints(
         drawNode(window, radius, x, y, color);
 
         network->input(dataPoint);
-        network->outputs();
         auto netColor = network->classify() == 0
             ? sf::Color(0x02d30940) // green
             : sf::Color(0xd3130240); // red
@@ -136,9 +143,10 @@ void neuralNetworkPointTest(){
                 auto dataPoint = (*data)[rand() % data->size()];
                 net.input(dataPoint);
                 auto outputs = net.outputs();
+                size_t guess = std::max_element(outputs.begin(), outputs.end()) - outputs.begin();
                 printf(
                     "Cost: %f Loss: %f Output0: %f Output1: %f classify: %lu x: %f y: %f\n",
-                     net.cost(), net.loss(), outputs[0], outputs[1], net.classify(),
+                     net.cost(), net.loss(), outputs[0], outputs[1], guess,
                     dataPoint.input[0] * (MAX- MIN), dataPoint.input[1] * (MAX - MIN)
                 );
             }
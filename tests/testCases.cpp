@@ -0,0 +1,438 @@
+#include "testCases.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+START_NAMESPACE_TESTS
+
+    namespace {
+        using namespace neural_network;
+
+        constexpr double TOLERANCE = 1e-10;
+
+        Tensor random_input(size_t channels, size_t size, std::mt19937& engine)
+        {
+            std::uniform_real_distribution<double> dist(-1.0, 1.0);
+            Tensor input({channels, size, size});
+            for (size_t i = 0; i < input.size(); i++)
+                input.data()[i] = dist(engine);
+            return input;
+        }
+
+        bool close(const Tensor& a, const Tensor& b)
+        {
+            if (a.shape() != b.shape())
+                return false;
+            vector_t x = a.to_vector(), y = b.to_vector();
+            for (size_t i = 0; i < x.size(); i++){
+                if (std::abs(x[i] - y[i]) > TOLERANCE)
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    void ConvolutionTest::test()
+    {
+        std::mt19937 engine(42);
+
+        for (int channels : {1, 3, 8})
+        for (int kernels : {1, 5, 16})
+        for (int padding : {0, 1})
+        for (int size : {5, 28, 29}){
+            ConvLayer layer(3, kernels, channels, 1, padding);
+            layer.initialize();
+            auto input = random_input(channels, size, engine);
+            auto expected = layer.forward_direct(input);
+
+            assertTrue(close(layer.algorithm(ConvAlgorithm::im2col).forward(input), expected));
+            assertTrue(close(layer.algorithm(ConvAlgorithm::fft).forward(input), expected));
+            assertTrue(close(layer.algorithm(ConvAlgorithm::winograd).forward(input), expected));
+
+            // the weight gradient, and the cached Winograd kernels after the update
+            auto partial_dervis = random_input(kernels, expected.dim(1), engine);
+            layer.backprop(partial_dervis, input);
+            vector_t gradient = layer._gradient_weights;
+            std::fill(layer._gradient_weights.begin(), layer._gradient_weights.end(), 0.0);
+            layer.backprop_direct(partial_dervis, input);
+            for (size_t i = 0; i < gradient.size(); i++){
+                assertTrue(std::abs(gradient[i] - layer._gradient_weights[i]) < TOLERANCE);
+            }
+
+            layer.apply_gradients(0.1, 1);
+            assertTrue(close(layer.forward(input), layer.forward_direct(input)));
+            assertTrue(close(layer.algorithm(ConvAlgorithm::fft).forward(input), layer.forward_direct(input)));
+        }
+
+        // other kernels and strides, FFT with the cached spectra of another input size
+        for (int kernel_size : {1, 2, 5, 9})
+        for (int stride : {1, 2, 3}){
+            ConvLayer layer(kernel_size, 4, 2, stride, kernel_size / 2);
+            layer.initialize();
+            for (int size : {28, 13}){
+                auto input = random_input(2, size, engine);
+                auto expected = layer.forward_direct(input);
+                assertTrue(close(layer.algorithm(ConvAlgorithm::automatic).forward(input), expected));
+                assertTrue(close(layer.algorithm(ConvAlgorithm::im2col).forward(input), expected));
+                if (stride == 1){
+                    assertTrue(close(layer.algorithm(ConvAlgorithm::fft).forward(input), expected));
+                }
+            }
+        }
+
+        // a non-contiguous view, the inside of a larger image
+        ConvLayer layer(3, 4, 2, 1, 1);
+        layer.initialize();
+        Tensor crop = random_input(2, 14, engine).slice(1, 1, 13).slice(2, 1, 13);
+        assertTrue(!crop.is_contiguous());
+        assertTrue(close(layer.forward(crop), layer.forward_direct(crop.clone())));
+        assertThrow<std::runtime_error>([&](){ layer.forward(random_input(3, 12, engine)); });
+
+        // channels last, the same convolution and gradient in the other layout
+        for (int stride : {1, 2})
+        for (int channels : {1, 3, 16}){
+            ConvLayer layer(3, 8, channels, stride, 1);
+            layer.initialize();
+            auto input = random_input(channels, 15, engine);
+            auto expected = layer.forward_direct(input);
+            auto partial_dervis = random_input(8, expected.dim(1), engine);
+            layer.backprop_direct(partial_dervis, input);
+            vector_t gradient = layer._gradient_weights;
+            std::fill(layer._gradient_weights.begin(), layer._gradient_weights.end(), 0.0);
+
+            layer.layout(Layout::channels_last);
+            assertTrue(close(layer.forward(to_channels_last(input)), to_channels_last(expected)));
+            layer.backprop(to_channels_last(partial_dervis), to_channels_last(input));
+            for (size_t i = 0; i < gradient.size(); i++){
+                assertTrue(std::abs(gradient[i] - layer._gradient_weights[i]) < TOLERANCE);
+            }
+            assertThrow<std::runtime_error>([&](){ layer.forward(input); });
+        }
+
+        ConvLayer strided(3, 1, 1, 2, 1);
+        strided.algorithm(ConvAlgorithm::winograd);
+        assertThrow<std::runtime_error>([&](){ strided.forward(random_input(1, 8, engine)); });
+        strided.algorithm(ConvAlgorithm::fft);
+        assertThrow<std::runtime_error>([&](){ strided.forward(random_input(1, 8, engine)); });
+    }
+
+    void TensorTest::test()
+    {
+        Tensor image({2, 3, 4}, vector_t{
+            0, 1, 2, 3,    4, 5, 6, 7,    8, 9, 10, 11,
+            12, 13, 14, 15,    16, 17, 18, 19,    20, 21, 22, 23
+        });
+        assertTrue(image.rank() == 3 && image.size() == 24 && image.is_contiguous());
+        assertTrue(image.strides() == Tensor::shape_t({12, 4, 1}));
+        assertTrue(image(1, 2, 3) == 23.0);
+
+        // the views share the storage
+        Tensor channel = image[1];
+        assertTrue(channel.shape() == Tensor::shape_t({3, 4}) && channel(0, 1) == 13.0);
+        channel(0, 1) = -1.0;
+        assertTrue(image(1, 0, 1) == -1.0);
+
+        Tensor flat = image.flatten();
+        assertTrue(flat.data() == image.data() && flat(13) == -1.0);
+        assertTrue(image.reshape({6, 4})(3, 1) == -1.0);
+
+        // an inner slice isn't contiguous, reshaping it copies the values
+        Tensor columns = image.slice(2, 1, 3);
+        assertTrue(!columns.is_contiguous() && columns.shape() == Tensor::shape_t({2, 3, 2}));
+        assertTrue(columns.to_vector() == vector_t({1, 2, 5, 6, 9, 10, -1, 14, 17, 18, 21, 22}));
+        Tensor copy = columns.flatten();
+        assertTrue(copy.is_contiguous() && copy(6) == -1.0);
+        copy(6) = 0.0;
+        assertTrue(image(1, 0, 1) == -1.0);
+
+        columns.fill(7.0);
+        assertTrue(image(0, 0, 1) == 7.0 && image(1, 2, 2) == 7.0 && image(1, 2, 3) == 23.0 && image(0, 0, 0) == 0.0);
+
+        Tensor clone = image.clone();
+        clone(0, 0, 0) = 5.0;
+        assertTrue(image(0, 0, 0) == 0.0);
+
+        // permuted axes, the channels last copy and back
+        Tensor transposed = image.permute({2, 0, 1});
+        assertTrue(transposed.shape() == Tensor::shape_t({4, 2, 3}) && transposed(3, 1, 2) == image(1, 2, 3));
+        Tensor last = to_channels_last(image);
+        assertTrue(last.is_contiguous() && last.shape() == Tensor::shape_t({3, 4, 2}) && last(2, 3, 1) == 23.0);
+        assertTrue(close(to_channels_first(last), image));
+
+        assertTrue(Tensor().empty() && Tensor().to_vector().empty());
+        assertThrow<std::runtime_error>([&](){ image.permute({0, 0, 1}); });
+        assertThrow<std::runtime_error>([&](){ image.reshape({5, 5}); });
+        assertThrow<std::runtime_error>([&](){ image.slice(1, 2, 4); });
+        assertThrow<std::runtime_error>([&](){ Tensor({2, 2}, vector_t(3)); });
+    }
+
+    void MaxPoolingTest::test()
+    {
+        std::mt19937 engine(7);
+
+        // windows (kernel size, stride, padding), also overlapping and with the padding
+        const int windows[3][3] = {{2, 2, 0}, {3, 2, 1}, {2, 1, 0}};
+
+        for (auto& window : windows)
+        for (int channels : {1, 4, 16})
+        for (int size : {8, 9}){
+            MaxPoolingLayer pool(window[0], channels, window[1], window[2]);
+            auto input = random_input(channels, size, engine);
+            auto output = pool.forward(input);
+            auto partial_dervis = random_input(channels, output.dim(1), engine);
+            auto gradient = pool.backprop(partial_dervis);
+
+            pool.layout(Layout::channels_last);
+            assertTrue(close(pool.forward(to_channels_last(input)), to_channels_last(output)));
+            auto gradient_last = to_channels_first(pool.backprop(to_channels_last(partial_dervis)));
+
+            // every channel on its own
+            MaxPoolingLayer single(window[0], 1, window[1], window[2]);
+            for (int channel = 0; channel < channels; channel++){
+                (void)single.forward(input.slice(0, channel, channel + 1));
+                auto expected = single.backprop(partial_dervis.slice(0, channel, channel + 1));
+                assertTrue(close(gradient.slice(0, channel, channel + 1), expected));
+                assertTrue(close(gradient_last.slice(0, channel, channel + 1), expected));
+            }
+        }
+
+        // the fused convolution + ReLU + pooling against the separate layers, more than one band of the rows
+        for (auto& window : windows)
+        for (Layout layout : {Layout::channels_first, Layout::channels_last})
+        for (int kernels : {1, 32})
+        for (int size : {64, 13}){
+            ConvLayer layer(3, kernels, 2, 1, 1);
+            layer.initialize();
+            layer.layout(layout);
+            MaxPoolingLayer pool(window[0], kernels, window[1], window[2]);
+            pool.layout(layout);
+
+            auto input = random_input(2, size, engine);
+            if (layout == Layout::channels_last)
+                input = to_channels_last(input);
+            auto convolved = layer.forward(input);
+            for (size_t i = 0; i < convolved.size(); i++)
+                convolved.data()[i] = std::max(convolved.data()[i], 0.0);
+            auto expected = pool.forward(convolved);
+            auto indexes = pool.get_max_indexes();
+
+            assertTrue(close(layer.forward_pooled(input, pool), expected));
+            for (size_t i = 0; i < indexes.size(); i++){
+                // ties of the zeros after the ReLU may pick another index
+                assertTrue(indexes[i] == pool.get_max_indexes()[i] || expected.data()[i] == 0.0);
+            }
+        }
+
+        // Winograd and FFT (the default of the 3x3 kernels) in the fused pass
+        for (auto& window : windows)
+        for (ConvAlgorithm algorithm : {ConvAlgorithm::automatic, ConvAlgorithm::winograd, ConvAlgorithm::fft}){
+            ConvLayer layer(3, 8, 4, 1, 1);
+            layer.initialize();
+            layer.algorithm(algorithm);
+            MaxPoolingLayer pool(window[0], 8, window[1], window[2]);
+
+            auto input = random_input(4, 14, engine);
+            assertTrue(algorithm != ConvAlgorithm::automatic || layer.get_algorithm(14) == ConvAlgorithm::winograd);
+            auto convolved = layer.forward(input);
+            for (size_t i = 0; i < convolved.size(); i++)
+                convolved.data()[i] = std::max(convolved.data()[i], 0.0);
+            auto expected = pool.forward(convolved);
+            assertTrue(close(layer.forward_pooled(input, pool), expected));
+        }
+
+        MaxPoolingLayer other(2, 3, 2, 0);
+        ConvLayer layer(3, 4, 1, 1, 1);
+        assertThrow<std::runtime_error>([&](){ layer.forward_pooled(random_input(1, 8, engine), other); });
+    }
+
+    void LinearModelTest::test()
+    {
+        constexpr size_t ROWS = 200, BATCH_SIZE = 20;
+        std::mt19937 engine(11);
+        std::uniform_real_distribution<double> dist(-1.0, 1.0);
+
+        // y = 2 * a - b + 0.5
+        data::Table table;
+        table.columns = 2;
+        for (size_t i = 0; i < ROWS; i++){
+            double a = dist(engine), b = dist(engine);
+            table.values.push_back(a);
+            table.values.push_back(b);
+            table.targets.push_back(2 * a - b + 0.5);
+        }
+
+        LinearModel model(2);
+        for (int epoch = 0; epoch < 300; epoch++){
+            for (size_t begin = 0; begin < ROWS; begin += BATCH_SIZE)
+                model.batch_learn(table, 0.1, begin, begin + BATCH_SIZE);
+        }
+        for (size_t i = 0; i < ROWS; i += 17){
+            model.set_inputs(vector_t(table.sample(i), table.sample(i) + 2));
+            assertTrue(std::abs(model.output() - table.targets[i]) < 1e-3);
+        }
+
+        data::Table narrow;
+        narrow.columns = 1;
+        narrow.values = {1.0, 2.0};
+        narrow.targets = {1.0, 2.0};
+        assertThrow<std::runtime_error>([&](){ model.batch_learn(narrow, 0.1); });
+    }
+
+    void SamplerTest::test()
+    {
+        constexpr size_t SIZE = 1000, CLASSES = 10;
+        std::mt19937 engine(7);
+
+        // imbalanced: most samples in the class 0, few in each of the others, the last class is empty
+        std::vector<uint16_t> labels(SIZE);
+        std::vector<size_t> counts(CLASSES, 0);
+        std::uniform_int_distribution<size_t> dist(0, 49);
+        for (auto& label : labels){
+            size_t u = dist(engine);
+            label = static_cast<uint16_t>(u < 40 ? 0 : 1 + u % (CLASSES - 2));
+            counts[label]++;
+        }
+
+        auto order = [](data::Sampler& sampler, uint64_t seed){
+            sampler.start(seed);
+            std::vector<size_t> indexes(sampler.size());
+            for (size_t p = 0; p < sampler.size(); p++)
+                indexes[p] = sampler(p);
+            return indexes;
+        };
+
+        data::StratifiedSampler stratified(labels.data(), SIZE, CLASSES);
+        for (uint64_t seed : {1, 2, 3}){
+            auto indexes = order(stratified, seed);
+            assertTrue(indexes.size() == SIZE);
+
+            // every sample exactly once
+            std::vector<size_t> visits(SIZE, 0);
+            for (size_t index : indexes)
+                visits[index]++;
+            assertTrue(std::all_of(visits.begin(), visits.end(), [](size_t v){ return v == 1; }));
+
+            // every batch holds the classes in proportion, within +-1
+            for (size_t batch_size : {16, 32, 100})
+            for (size_t begin = 0; begin + batch_size <= SIZE; begin += batch_size){
+                std::vector<size_t> batch(CLASSES, 0);
+                for (size_t p = begin; p < begin + batch_size; p++)
+                    batch[labels[indexes[p]]]++;
+                for (size_t c = 0; c < CLASSES; c++){
+                    double expected = double(batch_size) * counts[c] / SIZE;
+                    assertTrue(batch[c] + 1 >= std::floor(expected) && batch[c] <= std::ceil(expected) + 1);
+                }
+            }
+        }
+
+        std::vector<double> weights = {1.0, 2.0, 3.0, 4.0, 5.0, 1.0, 2.0, 3.0, 4.0, 5.0};
+        data::WeightedSampler weighted(labels.data(), SIZE, CLASSES, weights);
+        auto indexes = order(weighted, 1);
+        assertTrue(indexes.size() == SIZE);
+
+        // the visits follow the weights of the classes with samples, and add up to the size
+        std::vector<size_t> visits(CLASSES, 0);
+        for (size_t index : indexes)
+            visits[labels[index]]++;
+        double sum = 0.0;
+        for (size_t c = 0; c < CLASSES; c++)
+            sum += counts[c] > 0 ? weights[c] : 0.0;
+        size_t total = 0;
+        for (size_t c = 0; c < CLASSES; c++){
+            double expected = counts[c] == 0 ? 0.0 : SIZE * weights[c] / sum;
+            assertTrue(visits[c] == weighted.visits(c) && std::abs(visits[c] - expected) < 1.0);
+            total += visits[c];
+        }
+        assertTrue(total == SIZE);
+
+        // the seed reproduces the order
+        assertTrue(order(stratified, 5) == order(stratified, 5));
+        assertTrue(order(stratified, 5) != order(stratified, 6));
+        assertTrue(order(weighted, 5) == order(weighted, 5));
+        data::ShuffledSampler shuffled(SIZE);
+        assertTrue(order(shuffled, 5) == order(shuffled, 5));
+
+        std::vector<uint16_t> invalid = {0, CLASSES};
+        assertThrow<std::runtime_error>([&](){ data::StratifiedSampler(invalid.data(), invalid.size(), CLASSES); });
+    }
+
+    void ShardsTest::test()
+    {
+        namespace fs = std::filesystem;
+        constexpr size_t CLASSES = 10, PER_CLASS = 200, SIZE = 4, BATCH_SIZE = 32;
+
+        fs::path directory = fs::temp_directory_path() / "clife-shards-test";
+        fs::remove_all(directory);
+        fs::create_directories(directory);
+
+        // category ordered input, every shard holds a single class
+        {
+            data::ShardWriter writer(directory.string(), SIZE, SIZE, CLASSES, PER_CLASS);
+            std::vector<uint8_t> sample(SIZE * SIZE);
+            for (size_t label = 0; label < CLASSES; label++){
+                for (size_t i = 0; i < PER_CLASS; i++){
+                    std::fill(sample.begin(), sample.end(), static_cast<uint8_t>(i));
+                    writer.add(sample.data(), label);
+                }
+            }
+        }
+
+        // the budget holds 8 shards, the window 4 of them
+        const size_t shard_bytes = PER_CLASS * (SIZE * SIZE + sizeof(uint16_t));
+        data::ShardStream stream(directory.string(), 8 * shard_bytes);
+        assertTrue(stream.size() == CLASSES * PER_CLASS);
+
+        const std::thread::id consumer = std::this_thread::get_id();
+        for (uint64_t seed : {1, 2}){
+            std::vector<size_t> visits(stream.size(), 0);
+            // the batches are built (and staged) in the background
+            std::atomic<bool> staged_by_consumer(false);
+            stream.start(seed, BATCH_SIZE, [&](data::QuantizedBatch&, const std::vector<size_t>& indexes, uint64_t){
+                staged_by_consumer = staged_by_consumer || std::this_thread::get_id() == consumer;
+                for (size_t index : indexes)
+                    visits[index]++;
+            });
+
+            size_t batches = 0;
+            while (const data::Dataset* batch = stream.next()){
+                std::vector<size_t> counts(CLASSES, 0);
+                for (size_t i = 0; i < batch->size(); i++)
+                    counts[batch->label(i)]++;
+                size_t present = std::count_if(counts.begin(), counts.end(), [](size_t c){ return c > 0; });
+                assertTrue(batch->size() == BATCH_SIZE && present > 1);
+                batches++;
+            }
+            stream.stop();
+
+            // the last, incomplete batch is skipped
+            assertTrue(batches == stream.size() / BATCH_SIZE);
+            size_t visited = 0;
+            for (size_t count : visits){
+                assertTrue(count <= 1);
+                visited += count;
+            }
+            assertTrue(visited == batches * BATCH_SIZE);
+            assertTrue(!staged_by_consumer);
+        }
+
+        // a damaged shard is reported with its path
+        const std::string damaged = (directory / "shard-00003.bin").string();
+        std::ofstream(damaged, std::ios::trunc) << "damaged";
+        std::string message;
+        stream.start(1, BATCH_SIZE);
+        try {
+            while (stream.next() != nullptr){}
+        } catch (const std::runtime_error& e){
+            message = e.what();
+        }
+        stream.stop();
+        assertTrue(message.find(damaged) != std::string::npos);
+
+        fs::remove_all(directory);
+    }
+
+END_NAMESPACE
\ No newline at end of file
@@ -5,10 +5,73 @@
 #include <memory>
 
 #include <core/core.hpp>
+#include <data/data.hpp>
 #include <backend/backend.hpp>
 #include <test-creator/TestCreator.hpp>
 
 START_NAMESPACE_TESTS
 
+    /**
+     * @brief Every `ConvLayer` algorithm (im2col, Winograd, FFT) against the direct convolution
+    */
+    class ConvolutionTest : public TestCase
+    {
+    public:
+        ConvolutionTest() : TestCase("ConvolutionTest") {}
+        void test() override;
+    };
+
+    /**
+     * @brief `Tensor` views (index, slice, reshape, flatten) share the storage, copies don't
+    */
+    class TensorTest : public TestCase
+    {
+    public:
+        TensorTest() : TestCase("TensorTest") {}
+        void test() override;
+    };
+
+    /**
+     * @brief `MaxPoolingLayer` in both layouts against the single channel one, and `ConvLayer::forward_pooled`
+     * against the separate layers
+    */
+    class MaxPoolingTest : public TestCase
+    {
+    public:
+        MaxPoolingTest() : TestCase("MaxPoolingTest") {}
+        void test() override;
+    };
+
+    /**
+     * @brief `LinearModel` learns a linear function from a `data::Table`, and rejects a table of another width
+    */
+    class LinearModelTest : public TestCase
+    {
+    public:
+        LinearModelTest() : TestCase("LinearModelTest") {}
+        void test() override;
+    };
+
+    /**
+     * @brief `StratifiedSampler` visits every sample once and keeps the class proportions in every batch,
+     * `WeightedSampler` follows the class weights, the same seed gives the same order
+    */
+    class SamplerTest : public TestCase
+    {
+    public:
+        SamplerTest() : TestCase("SamplerTest") {}
+        void test() override;
+    };
+
+    /**
+     * @brief `ShardStream` visits every sample once per epoch, and mixes the classes of the shards
+     * written class by class in every batch
+    */
+    class ShardsTest : public TestCase
+    {
+    public:
+        ShardsTest() : TestCase("ShardsTest") {}
+        void test() override;
+    };
 
 END_NAMESPACE
\ No newline at end of file
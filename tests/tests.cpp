@@ -2,7 +2,21 @@
 
 START_NAMESPACE_TESTS
 
-    void root()
+    bool root()
     {
+        TensorTest tensor;
+        tensor.run();
+        ConvolutionTest convolution;
+        convolution.run();
+        MaxPoolingTest pooling;
+        pooling.run();
+        LinearModelTest linear;
+        linear.run();
+        SamplerTest sampler;
+        sampler.run();
+        ShardsTest shards;
+        shards.run();
+        return !tensor.failed() && !convolution.failed() && !pooling.failed()
+            && !linear.failed() && !sampler.failed() && !shards.failed();
     }
 END_NAMESPACE
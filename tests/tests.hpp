@@ -3,6 +3,7 @@
 #include "testCases.hpp"
 
 START_NAMESPACE_TESTS
-    void root();
+    // Runs all of the tests, returns false if any failed
+    bool root();
 END_NAMESPACE
 
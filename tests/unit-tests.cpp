@@ -2,5 +2,5 @@
 #include <gtest/gtest.h>
 
 int main(){
-    tests::root();
+    return tests::root() ? 0 : 1;
 }
\ No newline at end of file